@@ -220,6 +220,7 @@ FLAG_NOPAGING_IO                      = 0x0020 # do not try to retrieve memory f
 FLAG_NOCACHEPUT                       = 0x0100 # do not write back to the data cache upon successful read from memory acquisition device.
 FLAG_CACHE_RECENT_ONLY                = 0x0200 # only fetch from the most recent active cache region when reading.
 FLAG_NO_PREDICTIVE_READ               = 0x0400 # do not perform additional predictive page reads (default on smaller requests).
+FLAG_CACHE_STALE_OK                   = 0x0800 # allow fetching stale cached data from older (refreshed) cache generations when reading.
 
 # NTSTATUS values. (Used/Returned by Write file plugin callbacks).
 STATUS_SUCCESS                        = 0x00000000
@@ -289,6 +290,11 @@ OPT_CONFIG_VMM_VERSION_MINOR          = 0x2000000A00000000  # R
 OPT_CONFIG_VMM_VERSION_REVISION       = 0x2000000B00000000  # R
 OPT_CONFIG_STATISTICS_FUNCTIONCALL    = 0x2000000C00000000  # RW - enable function call statistics (.status/statistics_fncall file)
 OPT_CONFIG_IS_PAGING_ENABLED          = 0x2000000D00000000  # RW - 1/0
+OPT_CONFIG_CACHE_MB                   = 0x2000000E00000000  # RW - memory cache budget (in MB)
+OPT_CONFIG_CACHE2_MB                  = 0x2000000F00000000  # RW - compressed memory cache budget (in MB)
+OPT_CONFIG_CACHE_REVALIDATE           = 0x2000001000000000  # RW - 1/0 - re-validate hot cache pages on refresh (live memory)
+OPT_CONFIG_CACHE_DEDUP                = 0x2000001100000000  # RW - 1/0 - share cached physical pages with identical contents
+OPT_CONFIG_PHYS2VIRT_INDEX            = 0x2000001200000000  # RW - 1/0 - maintain global reverse physical to virtual index
 
 OPT_WIN_VERSION_MAJOR                 = 0x2000010100000000  # R
 OPT_WIN_VERSION_MINOR                 = 0x2000010200000000  # R
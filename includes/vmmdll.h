@@ -177,6 +177,11 @@ VOID VMMDLL_MemFree(_Frees_ptr_opt_ PVOID pvMem);
 #define VMMDLL_OPT_CONFIG_VMM_VERSION_REVISION          0x2000000B00000000  // R
 #define VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL       0x2000000C00000000  // RW - enable function call statistics (.status/statistics_fncall file)
 #define VMMDLL_OPT_CONFIG_IS_PAGING_ENABLED             0x2000000D00000000  // RW - 1/0
+#define VMMDLL_OPT_CONFIG_CACHE_MB                      0x2000000E00000000  // RW - memory cache budget (in MB)
+#define VMMDLL_OPT_CONFIG_CACHE2_MB                     0x2000000F00000000  // RW - compressed memory cache budget (in MB)
+#define VMMDLL_OPT_CONFIG_CACHE_REVALIDATE              0x2000001000000000  // RW - 1/0 - re-validate hot cache pages on refresh (live memory)
+#define VMMDLL_OPT_CONFIG_CACHE_DEDUP                   0x2000001100000000  // RW - 1/0 - share cached physical pages with identical contents
+#define VMMDLL_OPT_CONFIG_PHYS2VIRT_INDEX               0x2000001200000000  // RW - 1/0 - maintain global reverse physical to virtual index
 
 #define VMMDLL_OPT_WIN_VERSION_MAJOR                    0x2000010100000000  // R
 #define VMMDLL_OPT_WIN_VERSION_MINOR                    0x2000010200000000  // R
@@ -593,6 +598,7 @@ typedef struct tdVMMDLL_PLUGIN_REGINFO {
 #define VMMDLL_FLAG_NOCACHEPUT                      0x0100  // do not write back to the data cache upon successful read from memory acquisition device.
 #define VMMDLL_FLAG_CACHE_RECENT_ONLY               0x0200  // only fetch from the most recent active cache region when reading.
 #define VMMDLL_FLAG_NO_PREDICTIVE_READ              0x0400  // do not perform additional predictive page reads (default on smaller requests).
+#define VMMDLL_FLAG_CACHE_STALE_OK                  0x0800  // allow fetching stale cached data from older (refreshed) cache generations when reading.
 
 /*
 * Read memory in various non-contigious locations specified by the pointers to
@@ -645,6 +651,29 @@ BOOL VMMDLL_MemRead(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE p
 EXPORTED_FUNCTION _Success_(return)
 BOOL VMMDLL_MemReadEx(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_opt_ PDWORD pcbReadOpt, _In_ ULONG64 flags);
 
+/*
+* Pin a single 4096-byte page of memory for zero-copy read-only access. The
+* page data is referenced directly inside the memory cache and remains valid
+* and unchanged until the pin is released with VMMDLL_MemReadPinRelease.
+* Pins should be released as soon as possible after use.
+* NB! the page data must never be written to!
+* NB! the page data is invalid after VMMDLL_Close even if the pin is held.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA = address within the page to pin.
+* -- flags = flags as in VMMDLL_FLAG_*
+* -- phPin = receives the pin handle to release with VMMDLL_MemReadPinRelease.
+* -- return = read-only pointer to the 4096-byte page on success, NULL on fail.
+*/
+EXPORTED_FUNCTION _Success_(return != NULL)
+PBYTE VMMDLL_MemReadPin(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_ ULONG64 flags, _Out_ PHANDLE phPin);
+
+/*
+* Release a page pinned by VMMDLL_MemReadPin.
+* -- hPin
+*/
+EXPORTED_FUNCTION
+VOID VMMDLL_MemReadPinRelease(_In_opt_ HANDLE hPin);
+
 /*
 * Prefetch a number of addresses (specified in the pA array) into the memory
 * cache. This function is to be used to batch larger known reads into local
@@ -684,6 +713,45 @@ BOOL VMMDLL_MemWrite(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_reads_(cb) PBYTE pb
 EXPORTED_FUNCTION _Success_(return)
 BOOL VMMDLL_MemVirt2Phys(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqwPA);
 
+/*
+* Translate multiple virtual addresses to physical addresses by walking the
+* page tables of the specified process. Page tables are fetched in batches -
+* this is much faster than calling VMMDLL_MemVirt2Phys once per address.
+* -- dwPID
+* -- cVA = number of addresses.
+* -- pqwVA = virtual addresses to translate.
+* -- pqwPA = resulting physical addresses (0 on fail).
+* -- pfSuccess = optional per-address result of the translation.
+* -- return = TRUE if at least one address was successfully translated.
+*/
+EXPORTED_FUNCTION _Success_(return)
+BOOL VMMDLL_MemVirt2PhysBatch(_In_ DWORD dwPID, _In_ DWORD cVA, _In_reads_(cVA) PULONG64 pqwVA, _Out_writes_(cVA) PULONG64 pqwPA, _Out_writes_opt_(cVA) PBOOL pfSuccess);
+
+typedef struct tdVMMDLL_MEM_EXTENT {
+    ULONG64 va;
+    ULONG64 pa;         // physical address if known (hardware/transition/resolved prototype).
+    ULONG64 cb;
+    DWORD tp;           // VMMDLL_PTE_TP
+    DWORD _FutureUse1;
+} VMMDLL_MEM_EXTENT, *PVMMDLL_MEM_EXTENT;
+
+/*
+* Translate a virtual address range of the specified process into a compact
+* list of (va, pa, cb, tp) extents ordered by virtual address. Physically
+* contiguous pages and large pages are merged into single extents. Not present
+* pages are reported with their type (transition/prototype/pagefile/..) if the
+* PTE is non-zero. Unmapped pages are not reported.
+* If pExtents is NULL the number of extents is returned in pcExtents.
+* -- dwPID
+* -- qwVA
+* -- cb
+* -- pExtents
+* -- pcExtents = number of extents (in: buffer size, out: number of extents).
+* -- return = success/fail. Fail if buffer is too small (*pcExtents = required).
+*/
+EXPORTED_FUNCTION _Success_(return)
+BOOL VMMDLL_MemVirt2PhysRange(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _In_ ULONG64 cb, _Out_writes_opt_(*pcExtents) PVMMDLL_MEM_EXTENT pExtents, _Inout_ PDWORD pcExtents);
+
 
 
 //-----------------------------------------------------------------------------
@@ -752,6 +752,7 @@ VOID FcInitialize_ThreadProc(_In_ PVOID pvContext)
     if(!ctxVmm->Work.fEnabled) { goto fail; }
     if(!(hEventAsyncLogJSON = CreateEvent(NULL, TRUE, FALSE, NULL))) { goto fail; }
     PluginManager_Notify(VMMDLL_PLUGIN_NOTIFY_FORENSIC_INIT, NULL, 0);
+    VmmTlbSpiderAll();                  // batched page table load of all processes
     VmmMap_GetEvil(NULL, &pObEvilMap);  // start findevil (in 'async' mode)
     Ob_DECREF_NULL(&pObEvilMap);
     PluginManager_FcInitialize();       // 0-10%
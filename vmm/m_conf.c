@@ -35,7 +35,7 @@
 NTSTATUS MConf_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_writes_to_(cb, *pcbRead) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
 {
     DWORD cchBuffer;
-    CHAR szBuffer[0x800];
+    CHAR szBuffer[0x1000];
     DWORD cbCallStatistics = 0;
     LPSTR szCallStatistics = NULL;
     QWORD cPageReadTotal, cPageFailTotal;
@@ -76,13 +76,18 @@ NTSTATUS MConf_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_writes_to_(cb, *pcbRea
     if(!_stricmp(ctx->uszPath, "statistics.txt")) {
         cPageReadTotal = ctxVmm->stat.page.cPrototype + ctxVmm->stat.page.cTransition + ctxVmm->stat.page.cDemandZero + ctxVmm->stat.page.cVAD + ctxVmm->stat.page.cCacheHit + ctxVmm->stat.page.cPageFile + ctxVmm->stat.page.cCompressed;
         cPageFailTotal = ctxVmm->stat.page.cFailCacheHit + ctxVmm->stat.page.cFailVAD + ctxVmm->stat.page.cFailPageFile + ctxVmm->stat.page.cFailCompressed + ctxVmm->stat.page.cFail;
-        cchBuffer = snprintf(szBuffer, 0x800,
+        cchBuffer = snprintf(szBuffer, sizeof(szBuffer),
             "VMM STATISTICS   (4kB PAGES / COUNTS - HEXADECIMAL)\n" \
             "===================================================\n" \
             "PHYSICAL MEMORY:                      \n" \
             "  READ CACHE HIT:               %16llx\n" \
+            "  READ CACHE HIT COMPRESSED:    %16llx\n" \
             "  READ RETRIEVED:               %16llx\n" \
             "  READ FAIL:                    %16llx\n" \
+            "    Cache:                      %16llx\n" \
+            "  READ-AHEAD:                   %16llx\n" \
+            "  READ-AHEAD USED:              %16llx\n" \
+            "  READ COALESCED:               %16llx\n" \
             "  WRITE:                        %16llx\n" \
             "PAGED VIRTUAL MEMORY:                 \n" \
             "  READ SUCCESS:                 %16llx\n" \
@@ -100,17 +105,25 @@ NTSTATUS MConf_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_writes_to_(cb, *pcbRea
             "    Compressed:                 %16llx\n" \
             "TLB (PAGE TABLES):                    \n" \
             "  CACHE HIT:                    %16llx\n" \
+            "  CACHE HIT COMPRESSED:         %16llx\n" \
             "  RETRIEVED:                    %16llx\n" \
             "  FAILED:                       %16llx\n" \
+            "  VIRT2PHYS SOFTWARE TLB HIT:   %16llx\n" \
+            "  VIRT2PHYS KERNEL SHARED:      %16llx\n" \
             "PHYSICAL MEMORY REFRESH:        %16llx\n" \
             "TLB MEMORY REFRESH:             %16llx\n" \
+            "CACHE RE-VALIDATE:              %16llx\n" \
+            "CACHE RE-VALIDATE UNCHANGED:    %16llx\n" \
+            "CACHE MISS COALESCED:           %16llx\n" \
+            "PHYS CACHE SHARED ZERO PAGES:   %16llx\n" \
+            "PHYS CACHE SHARED DUPLICATES:   %16llx\n" \
             "PROCESS PARTIAL REFRESH:        %16llx\n" \
             "PROCESS FULL REFRESH:           %16llx\n",
-            ctxVmm->stat.cPhysCacheHit, ctxVmm->stat.cPhysReadSuccess, ctxVmm->stat.cPhysReadFail, ctxVmm->stat.cPhysWrite,
+            ctxVmm->stat.cPhysCacheHit, ctxVmm->stat.cPhysCache2Hit, ctxVmm->stat.cPhysReadSuccess, ctxVmm->stat.cPhysReadFail, ctxVmm->stat.cPhysReadFailCacheHit, ctxVmm->stat.cPhysReadAhead, ctxVmm->stat.cPhysReadAheadUsed, ctxVmm->stat.cPhysReadCoalesced, ctxVmm->stat.cPhysWrite,
             cPageReadTotal, ctxVmm->stat.page.cPrototype, ctxVmm->stat.page.cTransition, ctxVmm->stat.page.cDemandZero, ctxVmm->stat.page.cVAD, ctxVmm->stat.page.cCacheHit, ctxVmm->stat.page.cPageFile, ctxVmm->stat.page.cCompressed,
             cPageFailTotal, ctxVmm->stat.page.cFailCacheHit, ctxVmm->stat.page.cFailVAD, ctxVmm->stat.page.cFailPageFile, ctxVmm->stat.page.cFailCompressed,
-            ctxVmm->stat.cTlbCacheHit, ctxVmm->stat.cTlbReadSuccess, ctxVmm->stat.cTlbReadFail,
-            ctxVmm->stat.cPhysRefreshCache, ctxVmm->stat.cTlbRefreshCache, ctxVmm->stat.cProcessRefreshPartial, ctxVmm->stat.cProcessRefreshFull
+            ctxVmm->stat.cTlbCacheHit, ctxVmm->stat.cTlbCache2Hit, ctxVmm->stat.cTlbReadSuccess, ctxVmm->stat.cTlbReadFail, ctxVmm->stat.cTlbVirt2PhysHit, ctxVmm->stat.cTlbVirt2PhysKernelShared,
+            ctxVmm->stat.cPhysRefreshCache, ctxVmm->stat.cTlbRefreshCache, ctxVmm->stat.cCacheRevalidate, ctxVmm->stat.cCacheRevalidateUnchanged, ctxVmm->stat.cCacheMissCoalesced, ctxVmm->stat.cPhysDedupZero, ctxVmm->stat.cPhysDedupShared, ctxVmm->stat.cProcessRefreshPartial, ctxVmm->stat.cProcessRefreshFull
         );
         return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
     }
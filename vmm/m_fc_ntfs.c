@@ -780,32 +780,39 @@ typedef struct tdFCOB_MAP_NTFS {
 _Success_(return)
 BOOL FcNtfs_GetMftResidentData(_In_ PFC_MAP_NTFSENTRY pNtfsEntry, _Out_writes_opt_(cbData) PBYTE pbData, _In_ DWORD cbData, _Out_opt_ PDWORD pcbDataRead)
 {
+    BOOL fResult = FALSE;
     DWORD oA;
     PNTFS_ATTR pa;
     PNTFS_FILE_RECORD pr;
-    BYTE pbMftEntry[0x400];
-    if(!VmmRead(NULL, pNtfsEntry->pa, pbMftEntry, 0x400)) { return FALSE; }
+    PBYTE pbMftEntry;
+    BYTE pbMftEntryBuffer[0x400];
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pbMftEntry = VmmReadPinEx(NULL, pNtfsEntry->pa, 0x400, 0, pbMftEntryBuffer, &pObPin))) { return FALSE; }
     pr = (PNTFS_FILE_RECORD)pbMftEntry;
     // Check MFT record number is within the correct location inside the page.
-    if((((pNtfsEntry->pa >> 10) & 0x3) != (0x3 & pr->MftRecordNumber)) || (pr->MftRecordNumber == 0)) { return FALSE; }
+    if((((pNtfsEntry->pa >> 10) & 0x3) != (0x3 & pr->MftRecordNumber)) || (pr->MftRecordNumber == 0)) { goto finish; }
     // Extract attributes loop.
     oA = pr->FirstAttributeOffset;
     while((oA + sizeof(NTFS_ATTR) < 0x400)) {
         pa = (PNTFS_ATTR)(pbMftEntry + oA);
-        if((pa->Type == 0xffffffff) || (pa->Length < sizeof(NTFS_ATTR))) { return FALSE; }
+        if((pa->Type == 0xffffffff) || (pa->Length < sizeof(NTFS_ATTR))) { goto finish; }
         if(pa->Type == NTFS_ATTR_TYPE_DATA) {
             if(pcbDataRead) {
                 *pcbDataRead = pa->AttrLength;
             }
-            if(cbData != pa->AttrLength) { return FALSE; }
+            if(cbData != pa->AttrLength) { goto finish; }
+            if((QWORD)oA + pa->AttrOffset + pa->AttrLength > 0x400) { goto finish; }
             if(pbData) {
                 memcpy(pbData, (pbMftEntry + oA + pa->AttrOffset), pa->AttrLength);
             }
-            return TRUE;
+            fResult = TRUE;
+            goto finish;
         }
         oA += pa->Length;
     }
-    return FALSE;
+finish:
+    Ob_DECREF(pObPin);
+    return fResult;
 }
 
 #define FCNTFS_SQL_SELECT_FIELDS " sz, id, id_parent, addr_phys, inode, mft_flags, depth, name_seq, time_create, time_modify, time_read, size_file, size_fileres, oln_u, oln_j "
@@ -16,6 +16,7 @@ LPCSTR szMPHYS2VIRT_README =
     "'virt' (per process).                                                        \n" \
     "The phys2virt module may take time to execute  - especially if using the root\n" \
     "module (scan all process page tables) instead of individual processes.       \n" \
+    "If the reverse index is enabled (-phys2virt-index) lookups are near instant. \n" \
     "For more information please visit: https://github.com/ufrisk/MemProcFS/wiki  \n";
 
 typedef struct tdM_PHYS2VIRT_MULTIENTRY {
@@ -57,12 +58,17 @@ _Success_(return)
 BOOL Phys2Virt_GetUpdateAll(_Out_opt_ PM_PHYS2VIRT_MULTIENTRY_CONTEXT *ppMultiEntry, _Out_opt_ PDWORD pcMultiEntry)
 {
     PM_PHYS2VIRT_MULTIENTRY_CONTEXT ctx = NULL;
+    PVMMOB_PHYS2VIRT_INDEX pObIndex = NULL;
     SIZE_T cPIDs = 0;
     VmmProcessListPIDs(NULL, &cPIDs, 0);
     ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(M_PHYS2VIRT_MULTIENTRY_CONTEXT) + cPIDs * 4 * sizeof(M_PHYS2VIRT_MULTIENTRY));
     if(!ctx) { return FALSE; }
     ctx->pa = ctxVmm->paPluginPhys2VirtRoot;
     ctx->cMax = (DWORD)cPIDs * 4;
+    if(!(pObIndex = VmmPhys2VirtIndex_Get())) {
+        VmmTlbSpiderAll();  // no reverse index - process page tables will be walked
+    }
+    Ob_DECREF_NULL(&pObIndex);
     VmmProcessActionForeachParallel(ctx, VmmProcessActionForeachParallel_CriteriaActiveOnly, Phys2Virt_GetUpdateAll_CallbackAction);
     ctx->c = min(ctx->c, ctx->cMax - 1);
     if(pcMultiEntry) { *pcMultiEntry = ctx->c; }
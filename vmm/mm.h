@@ -28,6 +28,18 @@ VOID MmX86PAE_Initialize();
 */
 VOID MmX64_Initialize();
 
+/*
+* Page table walkers of the memory models - normally called through the memory
+* model function table (pfnVirt2Phys); exported for the memory model specific
+* virtual memory read loops in vmm.c.
+*/
+_Success_(return)
+BOOL MmX86_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift);
+_Success_(return)
+BOOL MmX86PAE_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift);
+_Success_(return)
+BOOL MmX64_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift);
+
 /*
 * Initialize the paging sub-system for Windows in a limited or full fashion.
 * In full mode Win10 memory decompression will be initialized.
@@ -42,6 +54,14 @@ VOID MmWin_PagingInitialize(_In_ BOOL fModeFull);
 */
 VOID MmWin_PagingClose();
 
+/*
+* Check whether a software PTE is the marker of VAD-backed virtual memory (the
+* actual PTE is the prototype PTE of the VAD).
+* -- pte
+* -- return
+*/
+BOOL MmWin_PteIsVadBacked(_In_ QWORD pte);
+
 /*
 * Initialize / Ensure that a VAD map is initialized for the specific process.
 * -- pProcess
@@ -62,6 +82,19 @@ BOOL MmVad_MapInitialize(_In_ PVMM_PROCESS pProcess, _In_ VMM_VADMAP_TP tp, _In_
 */
 QWORD MmVad_PrototypePte(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_opt_ PBOOL pfInRange, _In_ QWORD fVmmRead);
 
+/*
+* Try to read multiple prototype page table entries (PTEs). The VAD and its
+* prototype pte array are only looked up once for a run of addresses within
+* the same VAD - addresses should preferably be sorted.
+* -- pProcess
+* -- cva
+* -- pva
+* -- ppte = receives the prototype ptes (zero on fail).
+* -- pfInRange = receives whether the address is within a VAD.
+* -- fVmmRead = VMM_FLAGS_* flags.
+*/
+VOID MmVad_PrototypePteScatter(_In_ PVMM_PROCESS pProcess, _In_ DWORD cva, _In_reads_(cva) PQWORD pva, _Out_writes_(cva) PQWORD ppte, _Out_writes_(cva) PBOOL pfInRange, _In_ QWORD fVmmRead);
+
 /*
 * Interprete VAD protection flags into string p[mgn]rwxc.
 * -- pVad
@@ -478,272 +478,293 @@ BOOL MmVad_Spider_PoolTagAny(_In_ DWORD dwPoolTag, _In_ DWORD cPoolTag, ...)
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_XP(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwReserved)
 {
-    _MMVAD32_XP v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD32_XP), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD32_XP vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD32_XP*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD32_XP), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR32_8(v.LeftChild)) {
-        ObSet_Push(psAll, v.LeftChild - 8);
-        ObSet_Push(psTry1, v.LeftChild - 8);
-    }
-    if(VMM_KADDR32_8(v.RightChild)) {
-        ObSet_Push(psAll, v.RightChild - 8);
-        ObSet_Push(psTry1, v.RightChild - 8);
-    }
-    e->vaStart = (QWORD)v.StartingVpn << 12;
-    e->vaEnd = ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = v.CommitCharge;
-    e->MemCommit = v.MemCommit;
+    if(VMM_KADDR32_8(pv->LeftChild)) {
+        ObSet_Push(psAll, pv->LeftChild - 8);
+        ObSet_Push(psTry1, pv->LeftChild - 8);
+    }
+    if(VMM_KADDR32_8(pv->RightChild)) {
+        ObSet_Push(psAll, pv->RightChild - 8);
+        ObSet_Push(psTry1, pv->RightChild - 8);
+    }
+    e->vaStart = (QWORD)pv->StartingVpn << 12;
+    e->vaEnd = ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = pv->CommitCharge;
+    e->MemCommit = pv->MemCommit;
     e->VadType = 0;
-    e->Protection = v.Protection;
-    e->fPrivateMemory = v.PrivateMemory;
-    if(VMM_POOLTAG(v.PoolTag, MMVAD_POOLTAG_VADL)) { e->VadType = VadLargePages; }
+    e->Protection = pv->Protection;
+    e->fPrivateMemory = pv->PrivateMemory;
+    if(VMM_POOLTAG(pv->PoolTag, MMVAD_POOLTAG_VADL)) { e->VadType = VadLargePages; }
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->vaSubsection = v.ControlArea;
-    if(VMM_KADDR32_4(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte + MMVAD_PTESIZE);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->vaSubsection = pv->ControlArea;
+    if(VMM_KADDR32_4(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte + MMVAD_PTESIZE);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_7(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwReserved)
 {
-    _MMVAD32_7 v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD32_7), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD32_7 vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD32_7*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD32_7), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR32_8(v.LeftChild)) {
-        ObSet_Push(psAll, v.LeftChild - 8);
-        ObSet_Push(psTry1, v.LeftChild - 8);
-    }
-    if(VMM_KADDR32_8(v.RightChild)) {
-        ObSet_Push(psAll, v.RightChild - 8);
-        ObSet_Push(psTry1, v.RightChild - 8);
-    }
-    e->vaStart = (QWORD)v.StartingVpn << 12;
-    e->vaEnd = ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = v.CommitCharge;
-    e->MemCommit = v.MemCommit;
-    e->VadType = v.VadType;
-    e->Protection = v.Protection;
-    e->fPrivateMemory = v.PrivateMemory;
+    if(VMM_KADDR32_8(pv->LeftChild)) {
+        ObSet_Push(psAll, pv->LeftChild - 8);
+        ObSet_Push(psTry1, pv->LeftChild - 8);
+    }
+    if(VMM_KADDR32_8(pv->RightChild)) {
+        ObSet_Push(psAll, pv->RightChild - 8);
+        ObSet_Push(psTry1, pv->RightChild - 8);
+    }
+    e->vaStart = (QWORD)pv->StartingVpn << 12;
+    e->vaEnd = ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = pv->CommitCharge;
+    e->MemCommit = pv->MemCommit;
+    e->VadType = pv->VadType;
+    e->Protection = pv->Protection;
+    e->fPrivateMemory = pv->PrivateMemory;
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->vaSubsection = v.Subsection;
-    if(VMM_KADDR32_4(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte + MMVAD_PTESIZE);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->vaSubsection = pv->Subsection;
+    if(VMM_KADDR32_4(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte + MMVAD_PTESIZE);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD64_7(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwReserved)
 {
-    _MMVAD64_7 v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD64_7), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD64_7 vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD64_7*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD64_7), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.LeftChild)) {
-        ObSet_Push(psAll, v.LeftChild - 0x10);
-        ObSet_Push(psTry1, v.LeftChild - 0x10);
-    }
-    if(VMM_KADDR64_16(v.RightChild)) {
-        ObSet_Push(psAll, v.RightChild - 0x10);
-        ObSet_Push(psTry1, v.RightChild - 0x10);
-    }
-    e->vaStart = (QWORD)v.StartingVpn << 12;
-    e->vaEnd = ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = (DWORD)v.CommitCharge;
-    e->MemCommit = (DWORD)v.MemCommit;
-    e->VadType = (DWORD)v.VadType;
-    e->Protection = (DWORD)v.Protection;
-    e->fPrivateMemory = (DWORD)v.PrivateMemory;
+    if(VMM_KADDR64_16(pv->LeftChild)) {
+        ObSet_Push(psAll, pv->LeftChild - 0x10);
+        ObSet_Push(psTry1, pv->LeftChild - 0x10);
+    }
+    if(VMM_KADDR64_16(pv->RightChild)) {
+        ObSet_Push(psAll, pv->RightChild - 0x10);
+        ObSet_Push(psTry1, pv->RightChild - 0x10);
+    }
+    e->vaStart = (QWORD)pv->StartingVpn << 12;
+    e->vaEnd = ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = (DWORD)pv->CommitCharge;
+    e->MemCommit = (DWORD)pv->MemCommit;
+    e->VadType = (DWORD)pv->VadType;
+    e->Protection = (DWORD)pv->Protection;
+    e->fPrivateMemory = (DWORD)pv->PrivateMemory;
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->vaSubsection = v.Subsection;
-    if(VMM_KADDR64_8(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte + 8);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->vaSubsection = pv->Subsection;
+    if(VMM_KADDR64_8(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte + 8);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_80(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwReserved)
 {
-    _MMVAD32_80 v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD32_80), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD32_80 vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD32_80*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD32_80), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.LeftChild)) {
-        ObSet_Push(psAll, v.LeftChild - 8);
-        ObSet_Push(psTry1, v.LeftChild - 8);
-    }
-    if(VMM_KADDR64_16(v.RightChild)) {
-        ObSet_Push(psAll, v.RightChild - 8);
-        ObSet_Push(psTry1, v.RightChild - 8);
-    }
-    e->vaStart = (QWORD)v.StartingVpn << 12;
-    e->vaEnd = ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = (DWORD)v.CommitCharge;
-    e->MemCommit = (DWORD)v.MemCommit;
-    e->VadType = (DWORD)v.VadType;
-    e->Protection = (DWORD)v.Protection;
-    e->fPrivateMemory = (DWORD)v.PrivateMemory;
+    if(VMM_KADDR64_16(pv->LeftChild)) {
+        ObSet_Push(psAll, pv->LeftChild - 8);
+        ObSet_Push(psTry1, pv->LeftChild - 8);
+    }
+    if(VMM_KADDR64_16(pv->RightChild)) {
+        ObSet_Push(psAll, pv->RightChild - 8);
+        ObSet_Push(psTry1, pv->RightChild - 8);
+    }
+    e->vaStart = (QWORD)pv->StartingVpn << 12;
+    e->vaEnd = ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = (DWORD)pv->CommitCharge;
+    e->MemCommit = (DWORD)pv->MemCommit;
+    e->VadType = (DWORD)pv->VadType;
+    e->Protection = (DWORD)pv->Protection;
+    e->fPrivateMemory = (DWORD)pv->PrivateMemory;
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->flags[2] = v.u2;
-    e->vaSubsection = v.Subsection;
-    if(VMM_KADDR32_8(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte + 8);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->flags[2] = pv->u2;
+    e->vaSubsection = pv->Subsection;
+    if(VMM_KADDR32_8(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte + 8);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD64_80(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwReserved)
 {
-    _MMVAD64_80 v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD64_80), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD64_80 vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD64_80*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD64_80), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.LeftChild)) {
-        ObSet_Push(psAll, v.LeftChild - 0x10);
-        ObSet_Push(psTry1, v.LeftChild - 0x10);
-    }
-    if(VMM_KADDR64_16(v.RightChild)) {
-        ObSet_Push(psAll, v.RightChild - 0x10);
-        ObSet_Push(psTry1, v.RightChild - 0x10);
-    }
-    e->vaStart = (QWORD)v.StartingVpn << 12;
-    e->vaEnd = ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = v.CommitCharge;
-    e->MemCommit = v.MemCommit;
-    e->VadType = v.VadType;
-    e->Protection = v.Protection;
-    e->fPrivateMemory = v.PrivateMemory;
+    if(VMM_KADDR64_16(pv->LeftChild)) {
+        ObSet_Push(psAll, pv->LeftChild - 0x10);
+        ObSet_Push(psTry1, pv->LeftChild - 0x10);
+    }
+    if(VMM_KADDR64_16(pv->RightChild)) {
+        ObSet_Push(psAll, pv->RightChild - 0x10);
+        ObSet_Push(psTry1, pv->RightChild - 0x10);
+    }
+    e->vaStart = (QWORD)pv->StartingVpn << 12;
+    e->vaEnd = ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = pv->CommitCharge;
+    e->MemCommit = pv->MemCommit;
+    e->VadType = pv->VadType;
+    e->Protection = pv->Protection;
+    e->fPrivateMemory = pv->PrivateMemory;
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->flags[2] = (DWORD)v.u2;
-    e->vaSubsection = v.Subsection;
-    if(VMM_KADDR64_8(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->flags[2] = (DWORD)pv->u2;
+    e->vaSubsection = pv->Subsection;
+    if(VMM_KADDR64_8(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_10(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwFlagsBitMask)
 {
-    _MMVAD32_10 v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD32_10), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD32_10 vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD32_10*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD32_10), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR32_8(v.Children[0])) {
-        ObSet_Push(psAll, v.Children[0] - 8);
-        ObSet_Push(psTry1, v.Children[0] - 8);
-    }
-    if(VMM_KADDR32_8(v.Children[1])) {
-        ObSet_Push(psAll, v.Children[1] - 8);
-        ObSet_Push(psTry1, v.Children[1] - 8);
-    }
-    e->vaStart = (QWORD)v.StartingVpn << 12;
-    e->vaEnd = ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = v.CommitCharge;
-    e->MemCommit = v.MemCommit;
-    e->VadType = 0x07 & (v.u >> (dwFlagsBitMask & 0xff));
-    e->Protection = 0x1f & (v.u >> ((dwFlagsBitMask >> 8) & 0xff));
-    e->fPrivateMemory = 0x01 & (v.u >> ((dwFlagsBitMask >> 16) & 0xff));
+    if(VMM_KADDR32_8(pv->Children[0])) {
+        ObSet_Push(psAll, pv->Children[0] - 8);
+        ObSet_Push(psTry1, pv->Children[0] - 8);
+    }
+    if(VMM_KADDR32_8(pv->Children[1])) {
+        ObSet_Push(psAll, pv->Children[1] - 8);
+        ObSet_Push(psTry1, pv->Children[1] - 8);
+    }
+    e->vaStart = (QWORD)pv->StartingVpn << 12;
+    e->vaEnd = ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = pv->CommitCharge;
+    e->MemCommit = pv->MemCommit;
+    e->VadType = 0x07 & (pv->u >> (dwFlagsBitMask & 0xff));
+    e->Protection = 0x1f & (pv->u >> ((dwFlagsBitMask >> 8) & 0xff));
+    e->fPrivateMemory = 0x01 & (pv->u >> ((dwFlagsBitMask >> 16) & 0xff));
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->flags[2] = v.u2;
-    e->vaSubsection = v.Subsection;
-    if(VMM_KADDR32_4(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->flags[2] = pv->u2;
+    e->vaSubsection = pv->Subsection;
+    if(VMM_KADDR32_4(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
 PVMM_MAP_VADENTRY MmVad_Spider_MMVAD64_10(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _In_ PVMMOB_MAP_VAD pmVad, _In_ POB_SET psAll, _In_ POB_SET psTry1, _In_opt_ POB_SET psTry2, _In_ QWORD fVmmRead, _In_ DWORD dwFlagsBitMask)
 {
-    _MMVAD64_10 v = { 0 };
-    PVMM_MAP_VADENTRY e;
-    if(!VmmRead2(pSystemProcess, va, (PBYTE)&v, sizeof(_MMVAD64_10), fVmmRead | VMM_FLAG_FORCECACHE_READ)) {
+    _MMVAD64_10 vBuffer, *pv;
+    PVMM_MAP_VADENTRY e = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
+    if(!(pv = (_MMVAD64_10*)VmmReadPinEx(pSystemProcess, va, sizeof(_MMVAD64_10), fVmmRead | VMM_FLAG_FORCECACHE_READ, (PBYTE)&vBuffer, &pObPin))) {
         ObSet_Push(psTry2, va);
         return NULL;
     }
-    if((v.EndingVpnHigh < v.StartingVpnHigh) || (v.EndingVpn < v.StartingVpn) || !MmVad_Spider_PoolTagAny(v.PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
-        return NULL;
+    if((pv->EndingVpnHigh < pv->StartingVpnHigh) || (pv->EndingVpn < pv->StartingVpn) || !MmVad_Spider_PoolTagAny(pv->PoolTag, 5, MMVAD_POOLTAG_VADS, MMVAD_POOLTAG_VAD, MMVAD_POOLTAG_VADL, MMVAD_POOLTAG_VADM, MMVAD_POOLTAG_VADF)) {
+        goto finish;
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.Children[0])) {
-        ObSet_Push(psAll, v.Children[0] - 0x10);
-        ObSet_Push(psTry1, v.Children[0] - 0x10);
-    }
-    if(VMM_KADDR64_16(v.Children[1])) {
-        ObSet_Push(psAll, v.Children[1] - 0x10);
-        ObSet_Push(psTry1, v.Children[1] - 0x10);
-    }
-    e->vaStart = ((QWORD)v.StartingVpnHigh << (32 + 12)) | ((QWORD)v.StartingVpn << 12);
-    e->vaEnd = ((QWORD)v.EndingVpnHigh << (32 + 12)) | ((QWORD)v.EndingVpn << 12) | 0xfff;
-    e->CommitCharge = (DWORD)v.CommitCharge;
-    e->MemCommit = (DWORD)v.MemCommit;
-    e->VadType = 0x07 & (v.u >> (dwFlagsBitMask & 0xff));
-    e->Protection = 0x1f & (v.u >> ((dwFlagsBitMask >> 8) & 0xff));
-    e->fPrivateMemory = 0x01 & (v.u >> ((dwFlagsBitMask >> 16) & 0xff));
+    if(VMM_KADDR64_16(pv->Children[0])) {
+        ObSet_Push(psAll, pv->Children[0] - 0x10);
+        ObSet_Push(psTry1, pv->Children[0] - 0x10);
+    }
+    if(VMM_KADDR64_16(pv->Children[1])) {
+        ObSet_Push(psAll, pv->Children[1] - 0x10);
+        ObSet_Push(psTry1, pv->Children[1] - 0x10);
+    }
+    e->vaStart = ((QWORD)pv->StartingVpnHigh << (32 + 12)) | ((QWORD)pv->StartingVpn << 12);
+    e->vaEnd = ((QWORD)pv->EndingVpnHigh << (32 + 12)) | ((QWORD)pv->EndingVpn << 12) | 0xfff;
+    e->CommitCharge = (DWORD)pv->CommitCharge;
+    e->MemCommit = (DWORD)pv->MemCommit;
+    e->VadType = 0x07 & (pv->u >> (dwFlagsBitMask & 0xff));
+    e->Protection = 0x1f & (pv->u >> ((dwFlagsBitMask >> 8) & 0xff));
+    e->fPrivateMemory = 0x01 & (pv->u >> ((dwFlagsBitMask >> 16) & 0xff));
     // full vad
-    if(v.PoolTag == MMVAD_POOLTAG_VADS) { return e; }
-    e->flags[2] = (DWORD)v.u2;
-    e->vaSubsection = v.Subsection;
-    if(VMM_KADDR64_8(v.FirstPrototypePte)) {
-        e->vaPrototypePte = v.FirstPrototypePte;
-        e->cbPrototypePte = (DWORD)(v.LastContiguousPte - v.FirstPrototypePte + 8);
-    }
+    if(pv->PoolTag == MMVAD_POOLTAG_VADS) { goto finish; }
+    e->flags[2] = (DWORD)pv->u2;
+    e->vaSubsection = pv->Subsection;
+    if(VMM_KADDR64_8(pv->FirstPrototypePte)) {
+        e->vaPrototypePte = pv->FirstPrototypePte;
+        e->cbPrototypePte = (DWORD)(pv->LastContiguousPte - pv->FirstPrototypePte + 8);
+    }
+finish:
+    Ob_DECREF(pObPin);
     return e;
 }
 
@@ -1129,6 +1150,28 @@ POB_DATA MmVad_PrototypePteArray_Get(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_V
 // IMPLEMENTATION OF VAD RELATED GENERAL FUNCTIONALITY BELOW:
 // ----------------------------------------------------------------------------
 
+/*
+* Retrieve the prototype pte of an address from the prototype pte array of its VAD.
+* -- pVad
+* -- pObPteArray
+* -- va
+* -- return = prototype pte or zero if outside the array.
+*/
+QWORD MmVad_PrototypePte_FromArray(_In_ PVMM_MAP_VADENTRY pVad, _In_ POB_DATA pObPteArray, _In_ QWORD va)
+{
+    QWORD iPrototypePte = (va - pVad->vaStart) >> 12;
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) {
+        if(pObPteArray->ObHdr.cbData > (iPrototypePte * 4)) {
+            return pObPteArray->pdw[iPrototypePte];
+        }
+    } else {
+        if(pObPteArray->ObHdr.cbData > (iPrototypePte * 8)) {
+            return pObPteArray->pqw[iPrototypePte];
+        }
+    }
+    return 0;
+}
+
 /*
 * Try to read a prototype page table entry (PTE).
 * -- pProcess
@@ -1139,26 +1182,50 @@ POB_DATA MmVad_PrototypePteArray_Get(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_V
 */
 QWORD MmVad_PrototypePte(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_opt_ PBOOL pfInRange, _In_ QWORD fVmmRead)
 {
-    QWORD iPrototypePte, qwPrototypePte = 0;
+    QWORD qwPrototypePte = 0;
     POB_DATA pObPteArray = NULL;
     PVMM_MAP_VADENTRY pVad = NULL;
     if(MmVad_MapInitialize(pProcess, FALSE, fVmmRead) && (pVad = VmmMap_GetVadEntry(pProcess->Map.pObVad, va)) && (pObPteArray = MmVad_PrototypePteArray_Get(pProcess, pVad, fVmmRead))) {
-        iPrototypePte = (va - pVad->vaStart) >> 12;
-        if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) {
-            if(pObPteArray->ObHdr.cbData > (iPrototypePte * 4)) {
-                qwPrototypePte = pObPteArray->pdw[iPrototypePte];
-            }
-        } else {
-            if(pObPteArray->ObHdr.cbData > (iPrototypePte * 8)) {
-                qwPrototypePte = pObPteArray->pqw[iPrototypePte];
-            }
-        }
+        qwPrototypePte = MmVad_PrototypePte_FromArray(pVad, pObPteArray, va);
         Ob_DECREF(pObPteArray);
     }
     if(pfInRange) { *pfInRange = pVad ? TRUE : FALSE; }
     return qwPrototypePte;
 }
 
+/*
+* Try to read multiple prototype page table entries (PTEs). The VAD and its
+* prototype pte array are only looked up once for a run of addresses within
+* the same VAD - addresses should preferably be sorted.
+* -- pProcess
+* -- cva
+* -- pva
+* -- ppte = receives the prototype ptes (zero on fail).
+* -- pfInRange = receives whether the address is within a VAD.
+* -- fVmmRead = VMM_FLAGS_* flags.
+*/
+VOID MmVad_PrototypePteScatter(_In_ PVMM_PROCESS pProcess, _In_ DWORD cva, _In_reads_(cva) PQWORD pva, _Out_writes_(cva) PQWORD ppte, _Out_writes_(cva) PBOOL pfInRange, _In_ QWORD fVmmRead)
+{
+    DWORD i;
+    POB_DATA pObPteArray = NULL;
+    PVMM_MAP_VADENTRY pVad = NULL;
+    ZeroMemory(ppte, cva * sizeof(QWORD));
+    ZeroMemory(pfInRange, cva * sizeof(BOOL));
+    if(!MmVad_MapInitialize(pProcess, FALSE, fVmmRead)) { return; }
+    for(i = 0; i < cva; i++) {
+        if(!pVad || (pva[i] < pVad->vaStart) || (pva[i] > pVad->vaEnd)) {
+            Ob_DECREF_NULL(&pObPteArray);
+            if(!(pVad = VmmMap_GetVadEntry(pProcess->Map.pObVad, pva[i]))) { continue; }
+            pObPteArray = MmVad_PrototypePteArray_Get(pProcess, pVad, fVmmRead);
+        }
+        pfInRange[i] = TRUE;
+        if(pObPteArray) {
+            ppte[i] = MmVad_PrototypePte_FromArray(pVad, pObPteArray, pva[i]);
+        }
+    }
+    Ob_DECREF(pObPteArray);
+}
+
 _Success_(return)
 BOOL MmVad_MapInitialize_Core(_In_ PVMM_PROCESS pProcess, _In_ QWORD fVmmRead)
 {
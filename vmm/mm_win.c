@@ -9,10 +9,18 @@
 #include "pe.h"
 #include "statistics.h"
 #include "util.h"
+#ifdef _WIN32
+#include <io.h>
+#endif /* _WIN32 */
 
 #define MM_LOOP_PROTECT_ADD(flags)                  ((flags & ~0x00ff0000) | ((((flags >> 16) & 0xff) + 1) << 16))
 #define MM_LOOP_PROTECT_MAX(flags)                  (((flags >> 16) & 0xff) > 4)
 
+#define MMWIN_MEMCOMPRESS_PAGECACHE_MAX             0x800       // max # of cached SMKM metadata pages.
+#define MMWIN_MEMCOMPRESS_SCATTER_MAX               0x40        // max # of compressed pages resolved per batch.
+#define MMWIN_MEMCOMPRESS_DECOMPRESS_PARALLEL_MIN   8           // min # of compressed pages to decompress in parallel.
+#define MMWIN_MEMCOMPRESS_DECOMPRESS_WORKERS_MAX    4
+#define MMWIN_PAGEFILE_MERGE_MAX                    0x20        // max # of adjacent page file pages merged into one read.
 #define PTE_SWIZZLE_BIT                             0x10        // nt!_MMPTE_SOFTWARE.SwizzleBit
 #define PTE_SWIZZLE_MASK                            (((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.dwInvalidPteMask)
 
@@ -62,14 +70,102 @@ typedef struct tdMMWIN_MEMCOMPRESS_CONTEXT {
     QWORD vaSmGlobals;
     QWORD vaKeyToStoreTree;
     MMWIN_MEMCOMPRESS_OFFSET O;
+    POB_CACHEMAP pObCacheMapPage;   // SMKM metadata pages (b-tree nodes, stores, chunk/region arrays) - valid until next mem refresh.
 } MMWIN_MEMCOMPRESS_CONTEXT, *PMMWIN_MEMCOMPRESS_CONTEXT;
 
+typedef struct tdMMWIN_PAGEFILE {
+    FILE *hFile;
+    QWORD cb;
+    PBYTE pbMap;                            // read-only memory mapped view of the page file (if possible).
+#ifdef _WIN32
+    HANDLE hMap;
+#endif /* _WIN32 */
+} MMWIN_PAGEFILE, *PMMWIN_PAGEFILE;
+
+typedef struct tdMMWIN_PAGEFILE_SCATTER {
+    QWORD qwKey;                            // sort key: (page file number << 32) | page file offset.
+    QWORD pte;
+    PMEM_SCATTER pMEM;
+} MMWIN_PAGEFILE_SCATTER, *PMMWIN_PAGEFILE_SCATTER;
+
+typedef struct tdMMWIN_PAGED_SCATTER {
+    QWORD va;
+    QWORD pte;
+    QWORD flags;                            // per page VMM_FLAG_* (VMM_FLAG_NOVAD once resolved through the VAD).
+    BOOL fDone;
+} MMWIN_PAGED_SCATTER, *PMMWIN_PAGED_SCATTER;
+
 typedef struct tdMMWIN_CONTEXT {
-    CRITICAL_SECTION Lock;
-    FILE *pPageFile[10];
+    MMWIN_PAGEFILE PageFile[10];
     MMWIN_MEMCOMPRESS_CONTEXT MemCompress;
 } MMWIN_CONTEXT, *PMMWIN_CONTEXT;
 
+//-----------------------------------------------------------------------------
+// MEMCOMPRESSION METADATA CACHE FUNCTIONALITY BELOW:
+//-----------------------------------------------------------------------------
+
+BOOL MmWin_MemCompress_PageCache_ValidEntry(_Inout_ PQWORD qwContext, _In_ QWORD qwKey, _In_ PVOID pvObject)
+{
+    return *qwContext == ctxVmm->tcRefreshMEM;
+}
+
+/*
+* Retrieve a kernel page containing memory compression metadata; i.e. b-tree
+* nodes, SMKM store metadata or chunk/region pointer arrays. The pages are kept
+* in a cache until the next memory refresh to avoid re-walking the metadata of
+* the compressed stores on each compressed page read.
+* CALLER DECREF: return
+* -- pSystemProcess
+* -- vaPage = page aligned kernel virtual address.
+* -- fVmmRead = flags to VmmRead function calls.
+* -- return
+*/
+_Success_(return != NULL)
+POB_DATA MmWin_MemCompress_GetPage(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD vaPage, _In_ QWORD fVmmRead)
+{
+    POB_DATA pObPage;
+    POB_CACHEMAP pcm = ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.pObCacheMapPage;
+    BOOL fCache = pcm && !(VMM_FLAG_NOCACHE & (fVmmRead | ctxVmm->flags));
+    if(fCache && (pObPage = ObCacheMap_GetByKey(pcm, vaPage))) { return pObPage; }
+    if(!(pObPage = Ob_Alloc(OB_TAG_CORE_DATA, 0, sizeof(OB) + 0x1000, NULL, NULL))) { return NULL; }
+    if(!VmmRead2(pSystemProcess, vaPage, pObPage->pb, 0x1000, fVmmRead)) {
+        Ob_DECREF(pObPage);
+        return NULL;
+    }
+    if(fCache) {
+        ObCacheMap_Push(pcm, vaPage, pObPage, ctxVmm->tcRefreshMEM);
+    }
+    return pObPage;
+}
+
+/*
+* Read memory compression metadata through the metadata page cache.
+* -- pSystemProcess
+* -- va
+* -- pb
+* -- cb
+* -- fVmmRead = flags to VmmRead function calls.
+* -- return
+*/
+_Success_(return)
+BOOL MmWin_MemCompress_Read(_In_ PVMM_PROCESS pSystemProcess, _In_ QWORD va, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _In_ QWORD fVmmRead)
+{
+    DWORD o, cbPage;
+    POB_DATA pObPage;
+    while(cb) {
+        o = (DWORD)(va & 0xfff);
+        cbPage = min(cb, 0x1000 - o);
+        if(!(pObPage = MmWin_MemCompress_GetPage(pSystemProcess, va - o, fVmmRead))) { return FALSE; }
+        memcpy(pb, pObPage->pb + o, cbPage);
+        Ob_DECREF(pObPage);
+        va += cbPage;
+        pb += cbPage;
+        cb -= cbPage;
+    }
+    return TRUE;
+}
+
+
 //-----------------------------------------------------------------------------
 // BTREE FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
@@ -259,46 +355,50 @@ _Success_(return)
 BOOL MmWin_BTree32_Search(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaTree, _In_ DWORD dwKey, _Out_ PDWORD pdwValue, _In_ QWORD fVmmRead)
 {
     BOOL f;
-    BYTE pbBuffer[0x1000];
-    P_BTREE32 pT = (P_BTREE32)pbBuffer;
-    // 1: read tree
+    P_BTREE32 pT;
+    POB_DATA pObNode = NULL;
+    // 1: read tree (node page is cached)
     f = !MM_LOOP_PROTECT_MAX(fVmmRead) &&
         VMM_KADDR32_PAGE(vaTree) &&
-        VmmRead2(pProcess, vaTree, pbBuffer, 0x1000, fVmmRead) &&
-        pT->cEntries;
-    if(!f) { return FALSE; }
-    if(pT->fLeaf) {
-        // Leaf
-        if(pT->cEntries > 0x1ff) { return FALSE; }
-        return MmWin_BTree32_SearchLeaf(pProcess, pT, dwKey, pdwValue, fVmmRead);
-    } else {
-        // Node
-        if(pT->cEntries > 0x1ff) { return FALSE; }
-        return MmWin_BTree32_SearchNode(pProcess, pT, dwKey, pdwValue, fVmmRead);
+        (pObNode = MmWin_MemCompress_GetPage(pProcess, vaTree, fVmmRead)) &&
+        ((P_BTREE32)pObNode->pb)->cEntries;
+    if(f) {
+        pT = (P_BTREE32)pObNode->pb;
+        if(pT->fLeaf) {
+            // Leaf
+            f = (pT->cEntries <= 0x1ff) && MmWin_BTree32_SearchLeaf(pProcess, pT, dwKey, pdwValue, fVmmRead);
+        } else {
+            // Node
+            f = (pT->cEntries <= 0x1ff) && MmWin_BTree32_SearchNode(pProcess, pT, dwKey, pdwValue, fVmmRead);
+        }
     }
+    Ob_DECREF(pObNode);
+    return f;
 }
 
 _Success_(return)
 BOOL MmWin_BTree64_Search(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaTree, _In_ DWORD dwKey, _Out_ PDWORD pdwValue, _In_ QWORD fVmmRead)
 {
     BOOL f;
-    BYTE pbBuffer[0x1000];
-    P_BTREE64 pT = (P_BTREE64)pbBuffer;
-    // 1: read tree
+    P_BTREE64 pT;
+    POB_DATA pObNode = NULL;
+    // 1: read tree (node page is cached)
     f = !MM_LOOP_PROTECT_MAX(fVmmRead) &&
         VMM_KADDR64_PAGE(vaTree) &&
-        VmmRead2(pProcess, vaTree, pbBuffer, 0x1000, fVmmRead) &&
-        pT->cEntries;
-    if(!f) { return FALSE; }
-    if(pT->fLeaf) {
-        // Leaf
-        if(pT->cEntries > 0x1ff) { return FALSE; }
-        return MmWin_BTree64_SearchLeaf(pProcess, pT, dwKey, pdwValue, fVmmRead);
-    } else {
-        // Node
-        if(pT->cEntries > 0xff) { return FALSE; }
-        return MmWin_BTree64_SearchNode(pProcess, pT, dwKey, pdwValue, fVmmRead);
+        (pObNode = MmWin_MemCompress_GetPage(pProcess, vaTree, fVmmRead)) &&
+        ((P_BTREE64)pObNode->pb)->cEntries;
+    if(f) {
+        pT = (P_BTREE64)pObNode->pb;
+        if(pT->fLeaf) {
+            // Leaf
+            f = (pT->cEntries <= 0x1ff) && MmWin_BTree64_SearchLeaf(pProcess, pT, dwKey, pdwValue, fVmmRead);
+        } else {
+            // Node
+            f = (pT->cEntries <= 0xff) && MmWin_BTree64_SearchNode(pProcess, pT, dwKey, pdwValue, fVmmRead);
+        }
     }
+    Ob_DECREF(pObNode);
+    return f;
 }
 
 _Success_(return)
@@ -652,6 +752,7 @@ typedef struct tdMMWINX64_COMPRESS_CONTEXT {
     PVMM_PROCESS pProcess;
     PVMM_PROCESS pSystemProcess;
     PVMM_PROCESS pProcessMemCompress;
+    PMEM_SCATTER pMEM;                      // scatter read only: target page.
     // per page items
     struct {
         QWORD va;
@@ -758,10 +859,10 @@ BOOL MmWin_MemCompress2_SmkmStoreMetadata32(_In_ PMMWINX64_COMPRESS_CONTEXT ctx)
     DWORD va;
     _SMKM_STORE_METADATA32 MetaData;
     // 1: 1st level fetch virtual address to 2nd level of 32x32 array
-    if(!VmmRead2(ctx->pSystemProcess, ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.vaSmGlobals + (ctx->e.iSmkm >> 5) * sizeof(DWORD), (PBYTE)&va, sizeof(DWORD), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#21 Read"); }
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.vaSmGlobals + (ctx->e.iSmkm >> 5) * sizeof(DWORD), (PBYTE)&va, sizeof(DWORD), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#21 Read"); }
     if(!VMM_KADDR32_8(va)) { return MmWin_MemCompress_LogError(ctx, "#22 NoKADDR"); }
     // 2: 2nd fetch values (_SMKM_STORE_METADATA) from 2nd level of 32x32 array.
-    if(!VmmRead2(ctx->pSystemProcess, va + (ctx->e.iSmkm & 0x1f) * sizeof(_SMKM_STORE_METADATA32), (PBYTE)&MetaData, sizeof(_SMKM_STORE_METADATA32), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#23 Read"); }
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, va + (ctx->e.iSmkm & 0x1f) * sizeof(_SMKM_STORE_METADATA32), (PBYTE)&MetaData, sizeof(_SMKM_STORE_METADATA32), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#23 Read"); }
     if(MetaData.vaEPROCESS && !VMM_KADDR32_8(MetaData.vaEPROCESS)) { return MmWin_MemCompress_LogError(ctx, "#24 NoKADDR"); }
     if(!VMM_KADDR32_PAGE(MetaData.vaSmkmStore)) { return MmWin_MemCompress_LogError(ctx, "#25 NoKADDR"); }
     ctx->e.vaSmkmStore = MetaData.vaSmkmStore;
@@ -775,10 +876,10 @@ BOOL MmWin_MemCompress2_SmkmStoreMetadata64(_In_ PMMWINX64_COMPRESS_CONTEXT ctx)
     QWORD va;
     _SMKM_STORE_METADATA64 MetaData;
     // 1: 1st level fetch virtual address to 2nd level of 32x32 array
-    if(!VmmRead2(ctx->pSystemProcess, ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.vaSmGlobals + (ctx->e.iSmkm >> 5) * sizeof(QWORD), (PBYTE)&va, sizeof(QWORD), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#21 Read"); }
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.vaSmGlobals + (ctx->e.iSmkm >> 5) * sizeof(QWORD), (PBYTE)&va, sizeof(QWORD), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#21 Read"); }
     if(!VMM_KADDR64_16(va)) { return MmWin_MemCompress_LogError(ctx, "#22 NoKADDR"); }
     // 2: 2nd fetch values (_SMKM_STORE_METADATA) from 2nd level of 32x32 array.
-    if(!VmmRead2(ctx->pSystemProcess, va + (ctx->e.iSmkm & 0x1f) * sizeof(_SMKM_STORE_METADATA64), (PBYTE)&MetaData, sizeof(_SMKM_STORE_METADATA64), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#23 Read"); }
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, va + (ctx->e.iSmkm & 0x1f) * sizeof(_SMKM_STORE_METADATA64), (PBYTE)&MetaData, sizeof(_SMKM_STORE_METADATA64), ctx->fVmmRead)) { return MmWin_MemCompress_LogError(ctx, "#23 Read"); }
     if(MetaData.vaEPROCESS && !VMM_KADDR64_16(MetaData.vaEPROCESS)) { return MmWin_MemCompress_LogError(ctx, "#24 NoKADDR"); }
     if(!VMM_KADDR64_PAGE(MetaData.vaSmkmStore)) { return MmWin_MemCompress_LogError(ctx, "#25 NoKADDR"); }
     ctx->e.vaSmkmStore = MetaData.vaSmkmStore;
@@ -799,7 +900,7 @@ BOOL MmWin_MemCompress3_SmkmStoreAndPageRecord32(_In_ PMMWINX64_COMPRESS_CONTEXT
     P_SMHP_CHUNK_METADATA32 pc;
     PMMWIN_MEMCOMPRESS_OFFSET po = &((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.O;
     // 1: Load SmkmStore
-    if(!VmmRead2(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
         return MmWin_MemCompress_LogError(ctx, "#31 ReadSmkmStore");
     }
     // 2: Validate
@@ -832,11 +933,11 @@ BOOL MmWin_MemCompress3_SmkmStoreAndPageRecord32(_In_ PMMWINX64_COMPRESS_CONTEXT
         return MmWin_MemCompress_LogError(ctx, "#36 ChunkPtrNoKADDR");
     }
     if(pc->avaChunkPtr[iChunkPtr] & 0xfff) {
-        if(!VmmRead2(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] - 4, (PBYTE)&dwPoolHdr, 4, ctx->fVmmRead) || (dwPoolHdr != 'ABms')) {
+        if(!MmWin_MemCompress_Read(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] - 4, (PBYTE)&dwPoolHdr, 4, ctx->fVmmRead) || (dwPoolHdr != 'ABms')) {
             return MmWin_MemCompress_LogError(ctx, "#37 ChunkBadPoolHdr");
         }
     }
-    if(!VmmRead2(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] + 0x0cULL * iChunkArray, (PBYTE)&vaPageRecordArray, sizeof(DWORD), ctx->fVmmRead) || !VMM_KADDR32_PAGE(vaPageRecordArray)) {
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] + 0x0cULL * iChunkArray, (PBYTE)&vaPageRecordArray, sizeof(DWORD), ctx->fVmmRead) || !VMM_KADDR32_PAGE(vaPageRecordArray)) {
         return MmWin_MemCompress_LogError(ctx, "#38 PageRecordArray");
     }
     ctx->e.vaPageRecord = (DWORD)((QWORD)vaPageRecordArray + pc->dwChunkPageHeaderSize + ((QWORD)pc->dwPageRecordSize * (ctx->e.dwRegionKey & pc->dwPageRecordsPerChunkMask)));
@@ -861,7 +962,7 @@ BOOL MmWin_MemCompress3_SmkmStoreAndPageRecord64(_In_ PMMWINX64_COMPRESS_CONTEXT
     P_SMHP_CHUNK_METADATA64 pc;
     PMMWIN_MEMCOMPRESS_OFFSET po = &((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.O;
     // 1: Load SmkmStore
-    if(!VmmRead2(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
         return MmWin_MemCompress_LogError(ctx, "#31 ReadSmkmStore");
     }
     // 2: Validate
@@ -894,11 +995,11 @@ BOOL MmWin_MemCompress3_SmkmStoreAndPageRecord64(_In_ PMMWINX64_COMPRESS_CONTEXT
         return MmWin_MemCompress_LogError(ctx, "#36 ChunkPtrNoKADDR");
     }
     if(pc->avaChunkPtr[iChunkPtr] & 0xfff) {
-        if(!VmmRead2(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] - 12, (PBYTE)&dwPoolHdr, 4, ctx->fVmmRead) || (dwPoolHdr != 'ABms')) {
+        if(!MmWin_MemCompress_Read(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] - 12, (PBYTE)&dwPoolHdr, 4, ctx->fVmmRead) || (dwPoolHdr != 'ABms')) {
             return MmWin_MemCompress_LogError(ctx, "#37 ChunkBadPoolHdr");
         }
     }
-    if(!VmmRead2(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] + 0x10ULL * iChunkArray, (PBYTE)&vaPageRecordArray, sizeof(QWORD), ctx->fVmmRead) || !VMM_KADDR64_PAGE(vaPageRecordArray)) {
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, pc->avaChunkPtr[iChunkPtr] + 0x10ULL * iChunkArray, (PBYTE)&vaPageRecordArray, sizeof(QWORD), ctx->fVmmRead) || !VMM_KADDR64_PAGE(vaPageRecordArray)) {
         return MmWin_MemCompress_LogError(ctx, "#38 PageRecordArray");
     }
     ctx->e.vaPageRecord = (QWORD)(vaPageRecordArray + pc->dwChunkPageHeaderSize + ((QWORD)pc->dwPageRecordSize * (ctx->e.dwRegionKey & pc->dwPageRecordsPerChunkMask)));
@@ -923,7 +1024,7 @@ BOOL MmWin_MemCompress4_CompressedRegionData(_In_ PMMWINX64_COMPRESS_CONTEXT ctx
     _ST_PAGE_RECORD PageRecord;
     PMMWIN_MEMCOMPRESS_OFFSET po = &((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.O;
     // 1: Read page record
-    if(!VmmRead2(ctx->pSystemProcess, ctx->e.vaPageRecord, (PBYTE)&PageRecord, sizeof(PageRecord), ctx->fVmmRead)) {
+    if(!MmWin_MemCompress_Read(ctx->pSystemProcess, ctx->e.vaPageRecord, (PBYTE)&PageRecord, sizeof(PageRecord), ctx->fVmmRead)) {
         return MmWin_MemCompress_LogError(ctx, "#41 ReadPageRecord");
     }
     if(PageRecord.Key == 0xffffffff) {
@@ -937,7 +1038,7 @@ BOOL MmWin_MemCompress4_CompressedRegionData(_In_ PMMWINX64_COMPRESS_CONTEXT ctx
         dwRegionIndex = PageRecord.Key >> dwRegionIndexMask;
         vaRegionPtr = *(PDWORD)(ctx->e.pbSmkm + po->SMKM_STORE.CompressedRegionPtrArray) + dwRegionIndex * sizeof(DWORD);
         // 3: Get region and offset (32-bit)
-        if(!VmmRead2(ctx->pSystemProcess, vaRegionPtr, (PBYTE)&ctx->e.vaRegion, sizeof(DWORD), ctx->fVmmRead)) {
+        if(!MmWin_MemCompress_Read(ctx->pSystemProcess, vaRegionPtr, (PBYTE)&ctx->e.vaRegion, sizeof(DWORD), ctx->fVmmRead)) {
             return MmWin_MemCompress_LogError(ctx, "#43 ReadRegionVA");
         }
         if(!ctx->e.vaRegion || (ctx->e.vaRegion & 0x8000ffff)) {
@@ -949,7 +1050,7 @@ BOOL MmWin_MemCompress4_CompressedRegionData(_In_ PMMWINX64_COMPRESS_CONTEXT ctx
         dwRegionIndex = PageRecord.Key >> dwRegionIndexMask;
         vaRegionPtr = *(PQWORD)(ctx->e.pbSmkm + po->SMKM_STORE.CompressedRegionPtrArray) + dwRegionIndex * sizeof(QWORD);
         // 3: Get region and offset (64-bit)
-        if(!VmmRead2(ctx->pSystemProcess, vaRegionPtr, (PBYTE)&ctx->e.vaRegion, sizeof(QWORD), ctx->fVmmRead)) {
+        if(!MmWin_MemCompress_Read(ctx->pSystemProcess, vaRegionPtr, (PBYTE)&ctx->e.vaRegion, sizeof(QWORD), ctx->fVmmRead)) {
             return MmWin_MemCompress_LogError(ctx, "#45 ReadRegionVA");
         }
         if(!ctx->e.vaRegion || (ctx->e.vaRegion & 0xffff80000000ffff)) {
@@ -961,22 +1062,16 @@ BOOL MmWin_MemCompress4_CompressedRegionData(_In_ PMMWINX64_COMPRESS_CONTEXT ctx
 }
 
 /*
-* Decompress a compressed page
+* Decompress already read compressed data (ctx->e.pbCompressedData).
 * -- ctx
 * -- pbDecompressedPage
 * -- return
 */
 _Success_(return)
-BOOL MmWin_MemCompress5_DecompressPage(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out_writes_(4096) PBYTE pbDecompressedPage)
+BOOL MmWin_MemCompress5_Decompress(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out_writes_(4096) PBYTE pbDecompressedPage)
 {
     DWORD cbDecompressed = 0;
     NTSTATUS nt = VMM_STATUS_UNSUCCESSFUL;
-    // 1: Read compressed data
-    if(!VmmRead2(ctx->pProcessMemCompress, ctx->e.vaRegion + ctx->e.cbRegionOffset, ctx->e.pbCompressedData, ctx->e.cbCompressedData, ctx->fVmmRead)) {
-        MmWin_MemCompress_LogError(ctx, "#51 Read");
-        return FALSE;
-    }
-    // 2: Decompress data
     if(ctx->e.cbCompressedData == 0x1000) {
         memcpy(pbDecompressedPage, ctx->e.pbCompressedData, 0x1000);
     } else {
@@ -991,6 +1086,24 @@ BOOL MmWin_MemCompress5_DecompressPage(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out
     return TRUE;
 }
 
+/*
+* Decompress a compressed page
+* -- ctx
+* -- pbDecompressedPage
+* -- return
+*/
+_Success_(return)
+BOOL MmWin_MemCompress5_DecompressPage(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out_writes_(4096) PBYTE pbDecompressedPage)
+{
+    // 1: Read compressed data
+    if(!VmmRead2(ctx->pProcessMemCompress, ctx->e.vaRegion + ctx->e.cbRegionOffset, ctx->e.pbCompressedData, ctx->e.cbCompressedData, ctx->fVmmRead)) {
+        MmWin_MemCompress_LogError(ctx, "#51 Read");
+        return FALSE;
+    }
+    // 2: Decompress data
+    return MmWin_MemCompress5_Decompress(ctx, pbDecompressedPage);
+}
+
 /*
 * Decompress a page.
 * -- pProcess
@@ -1044,42 +1157,271 @@ fail:
     return fResult;
 }
 
+VOID MmWin_MemCompress_DecompressUnit(_In_ PMMWINX64_COMPRESS_CONTEXT pCtxs, _In_ DWORD i)
+{
+    if(pCtxs[i].e.cbCompressedData) {
+        pCtxs[i].pMEM->f = MmWin_MemCompress5_Decompress(pCtxs + i, pCtxs[i].pMEM->pb);
+    }
+}
+
+/*
+* Decompress the read compressed data of a batch of pages - in parallel on the
+* worker threads if the batch is large enough.
+* -- c
+* -- pCtxs
+*/
+VOID MmWin_MemCompress_DecompressParallel(_In_ DWORD c, _Inout_updates_(c) PMMWINX64_COMPRESS_CONTEXT pCtxs)
+{
+    DWORD cWorker = min(c / MMWIN_MEMCOMPRESS_DECOMPRESS_PARALLEL_MIN, MMWIN_MEMCOMPRESS_DECOMPRESS_WORKERS_MAX);
+    VmmWorkParallelFor(c, cWorker, pCtxs, (VOID(*)(PVOID, DWORD))MmWin_MemCompress_DecompressUnit);
+}
+
+/*
+* Decompress a batch of pages. The metadata of all pages is resolved first, the
+* compressed data of all pages is then read from the MemCompression process in
+* one scatter read and finally decompressed (in parallel if possible). Result
+* is returned in the f member of each page MEM.
+* -- pProcess
+* -- c
+* -- pCtxs = contexts with pMEM, e.va and e.PTE set; max MMWIN_MEMCOMPRESS_SCATTER_MAX.
+* -- fVmmRead = flags to VmmRead function calls.
+*/
+VOID MmWin_MemCompressScatter(_In_ PVMM_PROCESS pProcess, _In_ DWORD c, _Inout_updates_(c) PMMWINX64_COMPRESS_CONTEXT pCtxs, _In_ QWORD fVmmRead)
+{
+    BOOL f;
+    QWORD va;
+    DWORD i, j, cPage, cMEMs = 0;
+    PBYTE pbBuffer = NULL;
+    PMEM_SCATTER pMEMs;
+    PPMEM_SCATTER ppMEMs;
+    PMMWINX64_COMPRESS_CONTEXT ctx;
+    PVMM_PROCESS pObSystemProcess = NULL, pObMemCompressProcess = NULL;
+    QWORD tm = Statistics_CallStart();
+    fVmmRead &= ~VMM_FLAG_ALTADDR_VA_PTE;
+    if(!(pObSystemProcess = VmmProcessGet(4))) { goto fail; }
+    if(!(pObMemCompressProcess = VmmProcessGet(((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.dwPid))) { goto fail; }
+    if(!(pbBuffer = LocalAlloc(LMEM_ZEROINIT, 2 * c * (0x1000 + sizeof(MEM_SCATTER) + sizeof(PMEM_SCATTER))))) { goto fail; }
+    pMEMs = (PMEM_SCATTER)(pbBuffer + 2 * c * 0x1000);
+    ppMEMs = (PPMEM_SCATTER)(pbBuffer + 2 * c * (0x1000 + sizeof(MEM_SCATTER)));
+    // 1: resolve metadata (cached) of all pages and set up the compressed data reads.
+    for(i = 0; i < c; i++) {
+        ctx = pCtxs + i;
+        ctx->fVmmRead = fVmmRead;
+        ctx->pProcess = pProcess;
+        ctx->pSystemProcess = pObSystemProcess;
+        ctx->pProcessMemCompress = pObMemCompressProcess;
+        if(ctxVmm->f32) {
+            ctx->e.dwPageKey = MMWINX86PAE_PTE_PAGE_KEY_COMPRESSED(ctx->e.PTE);
+            f = MmWin_MemCompress1_SmkmStoreIndex(ctx) &&
+                MmWin_MemCompress2_SmkmStoreMetadata32(ctx) &&
+                MmWin_MemCompress3_SmkmStoreAndPageRecord32(ctx) &&
+                MmWin_MemCompress4_CompressedRegionData(ctx);
+        } else {
+            ctx->e.dwPageKey = MMWINX64_PTE_PAGE_KEY_COMPRESSED(ctx->e.PTE);
+            f = MmWin_MemCompress1_SmkmStoreIndex(ctx) &&
+                MmWin_MemCompress2_SmkmStoreMetadata64(ctx) &&
+                MmWin_MemCompress3_SmkmStoreAndPageRecord64(ctx) &&
+                MmWin_MemCompress4_CompressedRegionData(ctx);
+        }
+        if(!f || !ctx->e.cbCompressedData) {
+            ctx->e.cbCompressedData = 0;
+            continue;
+        }
+        va = ctx->e.vaRegion + ctx->e.cbRegionOffset;
+        cPage = (DWORD)(((va & 0xfff) + ctx->e.cbCompressedData + 0xfff) >> 12);
+        for(j = 0; j < cPage; j++) {
+            ppMEMs[cMEMs] = pMEMs + cMEMs;
+            pMEMs[cMEMs].version = MEM_SCATTER_VERSION;
+            pMEMs[cMEMs].qwA = (va & ~0xfffULL) + ((QWORD)j << 12);
+            pMEMs[cMEMs].cb = 0x1000;
+            pMEMs[cMEMs].pb = pbBuffer + ((2ULL * i + j) << 12);
+            cMEMs++;
+        }
+    }
+    // 2: read the compressed data of all pages in one scatter read.
+    if(cMEMs) {
+        VmmReadScatterVirtual(pObMemCompressProcess, ppMEMs, cMEMs, MM_LOOP_PROTECT_ADD(fVmmRead));
+    }
+    for(i = 0, j = 0; i < c; i++) {
+        ctx = pCtxs + i;
+        if(!ctx->e.cbCompressedData) { continue; }
+        va = ctx->e.vaRegion + ctx->e.cbRegionOffset;
+        cPage = (DWORD)(((va & 0xfff) + ctx->e.cbCompressedData + 0xfff) >> 12);
+        f = pMEMs[j].f && ((cPage == 1) || pMEMs[j + 1].f);
+        j += cPage;
+        if(!f) {
+            MmWin_MemCompress_LogError(ctx, "#51 Read");
+            ctx->e.cbCompressedData = 0;
+            continue;
+        }
+        memcpy(ctx->e.pbCompressedData, pbBuffer + (2ULL * i << 12) + (va & 0xfff), ctx->e.cbCompressedData);
+    }
+    // 3: decompress.
+    MmWin_MemCompress_DecompressParallel(c, pCtxs);
+fail:
+    LocalFree(pbBuffer);
+    Ob_DECREF(pObSystemProcess);
+    Ob_DECREF(pObMemCompressProcess);
+    Statistics_CallEnd(STATISTICS_ID_VMM_PagedCompressedMemory, tm);
+}
+
 
 //-----------------------------------------------------------------------------
 // PAGE FILE FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
 
+/*
+* Open a page file and map it read-only into memory. If the page file cannot be
+* mapped reads will fall back to positional (thread safe) file reads.
+* -- pPf
+* -- szPageFile
+* -- return
+*/
 _Success_(return)
-BOOL MmWin_PfReadFile(_In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+BOOL MmWin_PfOpen(_Out_ PMMWIN_PAGEFILE pPf, _In_ LPSTR szPageFile)
+{
+    if(fopen_s(&pPf->hFile, szPageFile, "rb")) { return FALSE; }
+    if(!_fseeki64(pPf->hFile, 0, SEEK_END)) {
+        pPf->cb = _ftelli64(pPf->hFile);
+    }
+    if(!pPf->cb || (pPf->cb == (QWORD)-1)) {
+        pPf->cb = 0;
+        return TRUE;
+    }
+#ifdef _WIN32
+    if((pPf->hMap = CreateFileMappingA((HANDLE)_get_osfhandle(_fileno(pPf->hFile)), NULL, PAGE_READONLY, 0, 0, NULL))) {
+        pPf->pbMap = MapViewOfFile(pPf->hMap, FILE_MAP_READ, 0, 0, 0);
+    }
+#endif /* _WIN32 */
+#ifdef LINUX
+    pPf->pbMap = mmap(NULL, pPf->cb, PROT_READ, MAP_SHARED, fileno(pPf->hFile), 0);
+    if(pPf->pbMap == MAP_FAILED) {
+        pPf->pbMap = NULL;
+    } else {
+        madvise(pPf->pbMap, pPf->cb, MADV_RANDOM);
+    }
+#endif /* LINUX */
+    return TRUE;
+}
+
+VOID MmWin_PfClose(_Inout_ PMMWIN_PAGEFILE pPf)
+{
+#ifdef _WIN32
+    if(pPf->pbMap) { UnmapViewOfFile(pPf->pbMap); }
+    if(pPf->hMap) { CloseHandle(pPf->hMap); }
+#endif /* _WIN32 */
+#ifdef LINUX
+    if(pPf->pbMap) { munmap(pPf->pbMap, pPf->cb); }
+#endif /* LINUX */
+    if(pPf->hFile) { fclose(pPf->hFile); }
+    ZeroMemory(pPf, sizeof(MMWIN_PAGEFILE));
+}
+
+/*
+* Read one or more adjacent pages from a page file. Memory mapped page files are
+* copied directly from the mapping, otherwise a positional read is issued. No
+* lock is taken - page files may be read concurrently by multiple threads.
+* -- dwPfNumber
+* -- dwPfOffset
+* -- cPages
+* -- pb
+* -- return
+*/
+_Success_(return)
+BOOL MmWin_PfReadFileEx(_In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _In_ DWORD cPages, _Out_writes_(cPages * 4096) PBYTE pb)
 {
     PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
-    DWORD cb = 0;
-    if(!ctx || !ctx->pPageFile[dwPfNumber]) { return FALSE; }
-    EnterCriticalSection(&ctx->Lock);
-    if(!_fseeki64(ctx->pPageFile[dwPfNumber], (QWORD)dwPfOffset << 12, SEEK_SET)) {
-        cb = (DWORD)fread(pbPage, 1, 0x1000, ctx->pPageFile[dwPfNumber]);
-    }
-    LeaveCriticalSection(&ctx->Lock);
-    return cb == 0x1000;
+    PMMWIN_PAGEFILE pPf;
+    QWORD qwOffset = (QWORD)dwPfOffset << 12;
+    DWORD cb = cPages << 12, cbRead = 0;
+#ifdef _WIN32
+    OVERLAPPED ov = { 0 };
+#endif /* _WIN32 */
+#ifdef LINUX
+    ssize_t cbReadLinux;
+#endif /* LINUX */
+    if(!ctx || (dwPfNumber >= 10)) { return FALSE; }
+    pPf = ctx->PageFile + dwPfNumber;
+    if(!pPf->hFile) { return FALSE; }
+    // page file size may be unknown (cb == 0) - let the file read report short reads.
+    if(pPf->cb && (qwOffset + cb > pPf->cb)) { return FALSE; }
+    if(pPf->pbMap) {
+        memcpy(pb, pPf->pbMap + qwOffset, cb);
+        return TRUE;
+    }
+#ifdef _WIN32
+    ov.Offset = (DWORD)qwOffset;
+    ov.OffsetHigh = (DWORD)(qwOffset >> 32);
+    if(!ReadFile((HANDLE)_get_osfhandle(_fileno(pPf->hFile)), pb, cb, &cbRead, &ov)) { return FALSE; }
+#endif /* _WIN32 */
+#ifdef LINUX
+    cbReadLinux = pread(fileno(pPf->hFile), pb, cb, qwOffset);
+    cbRead = (cbReadLinux > 0) ? (DWORD)cbReadLinux : 0;
+#endif /* LINUX */
+    return cbRead == cb;
 }
 
 _Success_(return)
-BOOL MmWin_PfRead(_In_ PVMM_PROCESS pProcess, _In_opt_ QWORD va, _In_ QWORD pte, _In_ QWORD fVmmRead, _In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+BOOL MmWin_PfReadFile(_In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+{
+    return MmWin_PfReadFileEx(dwPfNumber, dwPfOffset, 1, pbPage);
+}
+
+/*
+* Retrieve a page file / compressed store page from the paging cache.
+* -- pte
+* -- pbPage
+* -- pfResult = result of the cached read (page read or known failed).
+* -- return = TRUE if the pte is cached (as read or as failed).
+*/
+_Success_(return)
+BOOL MmWin_PfRead_CacheGet(_In_ QWORD pte, _Out_writes_(4096) PBYTE pbPage, _Out_ PBOOL pfResult)
 {
-    BOOL fResult;
     PVMMOB_CACHE_MEM pObCacheEntry;
     // cached page?
     if((pObCacheEntry = VmmCacheGet(VMM_CACHE_TAG_PAGING, pte))) {
         memcpy(pbPage, pObCacheEntry->pb, 0x1000);
         Ob_DECREF(pObCacheEntry);
         InterlockedIncrement64(&ctxVmm->stat.page.cCacheHit);
+        *pfResult = TRUE;
         return TRUE;
     }
     // cached failed page?
     if(ObSet_Exists(ctxVmm->Cache.PAGING_FAILED, pte)) {
         InterlockedIncrement64(&ctxVmm->stat.page.cFailCacheHit);
-        return FALSE;
+        *pfResult = FALSE;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+* Put the result of a page file / compressed store read into the paging cache.
+* -- pte
+* -- pbPage
+* -- fResult
+*/
+VOID MmWin_PfRead_CachePut(_In_ QWORD pte, _In_reads_(4096) PBYTE pbPage, _In_ BOOL fResult)
+{
+    PVMMOB_CACHE_MEM pObCacheEntry;
+    if(fResult) {
+        if((pObCacheEntry = VmmCacheReserve(VMM_CACHE_TAG_PAGING))) {
+            pObCacheEntry->h.f = TRUE;
+            pObCacheEntry->h.qwA = pte;
+            memcpy(pObCacheEntry->pb, pbPage, 0x1000);
+            VmmCacheReserveReturn(pObCacheEntry);
+        }
+    } else {
+        ObSet_Push(ctxVmm->Cache.PAGING_FAILED, pte);
     }
+}
+
+_Success_(return)
+BOOL MmWin_PfRead(_In_ PVMM_PROCESS pProcess, _In_opt_ QWORD va, _In_ QWORD pte, _In_ QWORD fVmmRead, _In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+{
+    BOOL fResult;
+    // cached page / cached failed page?
+    if(MmWin_PfRead_CacheGet(pte, pbPage, &fResult)) { return fResult; }
     // check flags: NoPagingIo, ForceCache and santity checks.
     if(fVmmRead & (VMM_FLAG_NOPAGING_IO | VMM_FLAG_FORCECACHE_READ)) { return FALSE; }
     if(!ctxVmm->pMmContext || (dwPfNumber >= 10)) { return FALSE; }
@@ -1100,17 +1442,8 @@ BOOL MmWin_PfRead(_In_ PVMM_PROCESS pProcess, _In_opt_ QWORD va, _In_ QWORD pte,
         }
     }
     // update cache
-    if(fResult) {
-        if((pObCacheEntry = VmmCacheReserve(VMM_CACHE_TAG_PAGING))) {
-            pObCacheEntry->h.f = TRUE;
-            pObCacheEntry->h.qwA = pte;
-            memcpy(pObCacheEntry->pb, pbPage, 0x1000);
-            VmmCacheReserveReturn(pObCacheEntry);
-        }
-        return TRUE;
-    }
-    ObSet_Push(ctxVmm->Cache.PAGING_FAILED, pte);
-    return FALSE;
+    MmWin_PfRead_CachePut(pte, pbPage, fResult);
+    return fResult;
 }
 
 
@@ -1444,6 +1777,278 @@ fail:
 }
 
 
+//-----------------------------------------------------------------------------
+// SCATTER PAGED READ BELOW:
+//-----------------------------------------------------------------------------
+
+/*
+* Check whether a pte is a software pte pointing directly into a page file or
+* into the compressed store (i.e. not hardware/transition/prototype/vad/demand
+* zero) and retrieve its page file number and offset.
+* -- pte
+* -- flags
+* -- pdwPfNumber
+* -- pdwPfOffset
+* -- return
+*/
+_Success_(return)
+BOOL MmWin_ReadPagedScatter_PfPte(_In_ QWORD pte, _In_ QWORD flags, _Out_ PDWORD pdwPfNumber, _Out_ PDWORD pdwPfOffset)
+{
+    if(!pte || !ctxVmm->pMmContext || MM_LOOP_PROTECT_MAX(flags)) { return FALSE; }
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) {
+        if(MMWINX64_PTE_IS_HARDWARE(pte) || MMWINX64_PTE_PROTOTYPE(pte) || MMWINX64_PTE_TRANSITION(pte)) { return FALSE; }
+        *pdwPfNumber = (DWORD)MMWINX64_PTE_PAGE_FILE_NUMBER(pte);
+        *pdwPfOffset = (DWORD)MMWINX64_PTE_PAGE_FILE_OFFSET(pte);
+    } else if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86PAE) {
+        if(MMWINX86PAE_PTE_IS_HARDWARE(pte) || MMWINX86PAE_PTE_PROTOTYPE(pte) || MMWINX86PAE_PTE_TRANSITION(pte)) { return FALSE; }
+        *pdwPfNumber = (DWORD)MMWINX86PAE_PTE_PAGE_FILE_NUMBER(pte);
+        *pdwPfOffset = (DWORD)MMWINX86PAE_PTE_PAGE_FILE_OFFSET(pte);
+    } else {
+        return FALSE;
+    }
+    return (*pdwPfOffset != 0xffffffff) && (*pdwPfNumber || *pdwPfOffset);
+}
+
+/*
+* Resolve a batch of compressed pages and update the paging cache and stats.
+* -- pProcess
+* -- c
+* -- pCtxs
+* -- flags
+*/
+VOID MmWin_ReadPagedScatter_Compressed(_In_ PVMM_PROCESS pProcess, _In_ DWORD c, _Inout_updates_(c) PMMWINX64_COMPRESS_CONTEXT pCtxs, _In_ QWORD flags)
+{
+    DWORD i;
+    MmWin_MemCompressScatter(pProcess, c, pCtxs, flags);
+    for(i = 0; i < c; i++) {
+        if(pCtxs[i].pMEM->f) {
+            InterlockedIncrement64(&ctxVmm->stat.page.cCompressed);
+        } else {
+            InterlockedIncrement64(&ctxVmm->stat.page.cFailCompressed);
+        }
+        MmWin_PfRead_CachePut(pCtxs[i].e.PTE, pCtxs[i].pMEM->pb, pCtxs[i].pMEM->f);
+    }
+}
+
+/*
+* Read a batch of page file pages. The pages are sorted on page file offset and
+* adjacent pages are merged into one read (if the page file isn't mapped).
+* -- c
+* -- pe
+*/
+VOID MmWin_ReadPagedScatter_PageFile(_In_ DWORD c, _Inout_updates_(c) PMMWIN_PAGEFILE_SCATTER pe)
+{
+    BOOL fMerge;
+    DWORD i, j, k;
+    PBYTE pbMerge = NULL;
+    PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
+    qsort(pe, c, sizeof(MMWIN_PAGEFILE_SCATTER), Util_qsort_QWORD);
+    for(i = 0; i < c; i = j) {
+        for(j = i + 1; (j < c) && (j - i < MMWIN_PAGEFILE_MERGE_MAX) && (pe[j].qwKey == pe[j - 1].qwKey + 1); j++);
+        fMerge =
+            (j - i > 1) && !ctx->PageFile[pe[i].qwKey >> 32].pbMap &&
+            (pbMerge || (pbMerge = LocalAlloc(0, MMWIN_PAGEFILE_MERGE_MAX << 12))) &&
+            MmWin_PfReadFileEx((DWORD)(pe[i].qwKey >> 32), (DWORD)pe[i].qwKey, j - i, pbMerge);
+        for(k = i; k < j; k++) {
+            if(fMerge) {
+                memcpy(pe[k].pMEM->pb, pbMerge + ((QWORD)(k - i) << 12), 0x1000);
+                pe[k].pMEM->f = TRUE;
+            } else {
+                pe[k].pMEM->f = MmWin_PfReadFile((DWORD)(pe[k].qwKey >> 32), (DWORD)pe[k].qwKey, pe[k].pMEM->pb);
+            }
+            if(pe[k].pMEM->f) {
+                InterlockedIncrement64(&ctxVmm->stat.page.cPageFile);
+            } else {
+                InterlockedIncrement64(&ctxVmm->stat.page.cFailPageFile);
+            }
+            MmWin_PfRead_CachePut(pe[k].pte, pe[k].pMEM->pb, pe[k].pMEM->f);
+        }
+    }
+    LocalFree(pbMerge);
+}
+
+/*
+* Resolve prototype ptes and VAD backed ptes of a batch of paged pages. All
+* prototype ptes are fetched in one read, VAD prototype pte arrays are looked
+* up once per VAD. The resolved ptes replace the ptes of the batch entries.
+* -- pProcess
+* -- c
+* -- pe
+* -- flags
+*/
+VOID MmWin_ReadPagedScatter_Prototype(_In_ PVMM_PROCESS pProcess, _In_ DWORD c, _Inout_updates_(c) PMMWIN_PAGED_SCATTER pe, _In_ QWORD flags)
+{
+    BOOL f64 = (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64);
+    DWORD i, j, cva = 0;
+    QWORD vaPrototypePte, pte;
+    PBYTE pbBuffer = NULL;
+    PQWORD pva, ppte;
+    PBOOL pfInRange;
+    PDWORD piEntry;
+    POB_SET psObPrototypePte = NULL;
+    PVMM_PROCESS pObSystemProcess = NULL;
+    if(MM_LOOP_PROTECT_MAX(flags)) { return; }
+    flags = MM_LOOP_PROTECT_ADD(flags);
+    // 1: prototype ptes [ nt!_MMPTE_PROTOTYPE ] - prefetch all, then resolve.
+    if(!(flags & VMM_FLAG_NOPAGING_IO) && (psObPrototypePte = ObSet_New())) {
+        for(i = 0; i < c; i++) {
+            if((vaPrototypePte = (f64 ? MMWINX64_PTE_PROTOTYPE(pe[i].pte) : MMWINX86PAE_PTE_PROTOTYPE(pe[i].pte)))) {
+                ObSet_Push(psObPrototypePte, vaPrototypePte);
+            }
+        }
+        if(ObSet_Size(psObPrototypePte) > 1 && (pObSystemProcess = VmmProcessGet(4))) {
+            VmmCachePrefetchPages3(pObSystemProcess, psObPrototypePte, 8, flags);
+            Ob_DECREF(pObSystemProcess);
+        }
+        if(ObSet_Size(psObPrototypePte)) {
+            for(i = 0; i < c; i++) {
+                if(f64 ? MMWINX64_PTE_PROTOTYPE(pe[i].pte) : MMWINX86PAE_PTE_PROTOTYPE(pe[i].pte)) {
+                    InterlockedIncrement64(&ctxVmm->stat.page.cPrototype);
+                    pe[i].pte = f64 ? MmWinX64_Prototype(pe[i].pte, flags) : MmWinX86PAE_Prototype(pe[i].pte, flags);
+                }
+            }
+        }
+        Ob_DECREF(psObPrototypePte);
+    }
+    // 2: potentially VAD-backed virtual memory - resolve all in one batch.
+    for(i = 0; i < c; i++) {
+        pte = pe[i].pte;
+        if(!pe[i].va || VMM_KADDR(pe[i].va) || (pe[i].flags & VMM_FLAG_NOVAD)) { continue; }
+        if(f64 ? (MMWINX64_PTE_IS_HARDWARE(pte) || MMWINX64_PTE_TRANSITION(pte)) : (MMWINX86PAE_PTE_IS_HARDWARE(pte) || MMWINX86PAE_PTE_TRANSITION(pte))) { continue; }
+        if(!pte || ((f64 ? MMWINX64_PTE_PAGE_FILE_OFFSET(pte) : MMWINX86PAE_PTE_PAGE_FILE_OFFSET(pte)) == 0xffffffff)) {
+            if(!pbBuffer && !(pbBuffer = LocalAlloc(0, c * (2 * sizeof(QWORD) + sizeof(BOOL) + sizeof(DWORD))))) { return; }
+            pva = (PQWORD)pbBuffer;
+            piEntry = (PDWORD)(pbBuffer + c * 2 * sizeof(QWORD) + c * sizeof(BOOL));
+            pva[cva] = pe[i].va;
+            piEntry[cva] = i;
+            cva++;
+        }
+    }
+    if(!cva) { return; }
+    pva = (PQWORD)pbBuffer;
+    ppte = (PQWORD)(pbBuffer + c * sizeof(QWORD));
+    pfInRange = (PBOOL)(pbBuffer + c * 2 * sizeof(QWORD));
+    piEntry = (PDWORD)(pbBuffer + c * 2 * sizeof(QWORD) + c * sizeof(BOOL));
+    MmVad_PrototypePteScatter(pProcess, cva, pva, ppte, pfInRange, flags);
+    for(j = 0; j < cva; j++) {
+        i = piEntry[j];
+        if(!ppte[j]) {
+            if(pfInRange[j]) { InterlockedIncrement64(&ctxVmm->stat.page.cFailVAD); }
+            pe[i].fDone = TRUE;
+            continue;
+        }
+        InterlockedIncrement64(&ctxVmm->stat.page.cVAD);
+        pe[i].pte = ppte[j];
+        pe[i].flags |= VMM_FLAG_NOVAD;
+    }
+    LocalFree(pbBuffer);
+}
+
+/*
+* Read multiple paged pages. Prototype and VAD backed ptes are resolved in one
+* batch. Pages residing in the compressed store are resolved in batches - the
+* compressed data is read in one scatter read and decompressed in parallel.
+* Pages residing in page files are read in one batch with adjacent pages merged.
+* All other pages are dispatched to the single page paged read.
+* Upon entry the top of each MEM stack holds the pte; upon exit it holds the
+* physical address to read (or zero). The f member is set on completed read.
+* -- pProcess
+* -- cpMEMs
+* -- ppMEMs
+* -- flags = VMM_FLAG_* (VMM_FLAG_ALTADDR_VA_PTE = no virtual address).
+*/
+VOID MmWin_ReadPagedScatter(_In_ PVMM_PROCESS pProcess, _In_ DWORD cpMEMs, _Inout_updates_(cpMEMs) PPMEM_SCATTER ppMEMs, _In_ QWORD flags)
+{
+    BOOL fResult;
+    DWORD i, c = 0, cPf = 0, dwPfNumber, dwPfOffset;
+    QWORD qwPA;
+    PMEM_SCATTER pMEM;
+    PMMWIN_PAGED_SCATTER pe, peAll = NULL;
+    PMMWINX64_COMPRESS_CONTEXT pCtxs = NULL;
+    PMMWIN_PAGEFILE_SCATTER pePf = NULL;
+    PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
+    BOOL fAltAddrPte = VMM_FLAG_ALTADDR_VA_PTE & flags;
+    BOOL fPfIo = !(flags & (VMM_FLAG_NOPAGING_IO | VMM_FLAG_FORCECACHE_READ));
+    if(!(peAll = LocalAlloc(LMEM_ZEROINIT, cpMEMs * sizeof(MMWIN_PAGED_SCATTER)))) {
+        for(i = 0; i < cpMEMs; i++) {
+            pMEM = ppMEMs[i];
+            qwPA = 0;
+            pMEM->f = ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, (fAltAddrPte ? 0 : pMEM->qwA), MEM_SCATTER_STACK_PEEK(pMEM, 1), pMEM->pb, &qwPA, NULL, flags);
+            MEM_SCATTER_STACK_SET(pMEM, 1, qwPA);
+        }
+        return;
+    }
+    for(i = 0; i < cpMEMs; i++) {
+        peAll[i].va = fAltAddrPte ? 0 : ppMEMs[i]->qwA;
+        peAll[i].pte = MEM_SCATTER_STACK_PEEK(ppMEMs[i], 1);
+        peAll[i].flags = flags;
+    }
+    MmWin_ReadPagedScatter_Prototype(pProcess, cpMEMs, peAll, flags);
+    for(i = 0; i < cpMEMs; i++) {
+        pMEM = ppMEMs[i];
+        pe = peAll + i;
+        qwPA = 0;
+        if(pe->fDone) {
+            MEM_SCATTER_STACK_SET(pMEM, 1, 0);
+            continue;
+        }
+        if(!MmWin_ReadPagedScatter_PfPte(pe->pte, flags, &dwPfNumber, &dwPfOffset) || (dwPfNumber >= 10)) {
+            pMEM->f = ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, pe->va, pe->pte, pMEM->pb, &qwPA, NULL, pe->flags);
+        } else if(MmWin_PfRead_CacheGet(pe->pte, pMEM->pb, &fResult)) {
+            pMEM->f = fResult;
+        } else if(fPfIo && ctx->MemCompress.fValid && (dwPfNumber == ctx->MemCompress.dwPageFileNumber) && (pCtxs || (pCtxs = LocalAlloc(0, MMWIN_MEMCOMPRESS_SCATTER_MAX * sizeof(MMWINX64_COMPRESS_CONTEXT))))) {
+            // compressed store
+            ZeroMemory(pCtxs + c, sizeof(MMWINX64_COMPRESS_CONTEXT));
+            pCtxs[c].pMEM = pMEM;
+            pCtxs[c].e.va = pe->va;
+            pCtxs[c].e.PTE = pe->pte;
+            if(++c == MMWIN_MEMCOMPRESS_SCATTER_MAX) {
+                MmWin_ReadPagedScatter_Compressed(pProcess, c, pCtxs, MM_LOOP_PROTECT_ADD(flags));
+                c = 0;
+            }
+        } else if(fPfIo && ctx->PageFile[dwPfNumber].hFile && (pePf || (pePf = LocalAlloc(0, cpMEMs * sizeof(MMWIN_PAGEFILE_SCATTER))))) {
+            // page file
+            pePf[cPf].qwKey = ((QWORD)dwPfNumber << 32) | dwPfOffset;
+            pePf[cPf].pte = pe->pte;
+            pePf[cPf].pMEM = pMEM;
+            cPf++;
+        } else {
+            pMEM->f = ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, pe->va, pe->pte, pMEM->pb, &qwPA, NULL, pe->flags);
+        }
+        MEM_SCATTER_STACK_SET(pMEM, 1, qwPA);
+    }
+    if(c) {
+        MmWin_ReadPagedScatter_Compressed(pProcess, c, pCtxs, MM_LOOP_PROTECT_ADD(flags));
+    }
+    if(cPf) {
+        MmWin_ReadPagedScatter_PageFile(cPf, pePf);
+    }
+    LocalFree(peAll);
+    LocalFree(pCtxs);
+    LocalFree(pePf);
+}
+
+/*
+* Check whether a software PTE is the marker of VAD-backed virtual memory, i.e.
+* whether its page file offset is all ones and the actual PTE is the prototype
+* PTE of the VAD. Hardware, prototype and transition PTEs are not checked.
+* -- pte
+* -- return
+*/
+BOOL MmWin_PteIsVadBacked(_In_ QWORD pte)
+{
+    switch(ctxVmm->tpMemoryModel) {
+        case VMM_MEMORYMODEL_X86:
+            return MMWINX86_PTE_PAGE_FILE_OFFSET((DWORD)pte) == 0x000fffff;
+        case VMM_MEMORYMODEL_X86PAE:
+            return MMWINX86PAE_PTE_PAGE_FILE_OFFSET(pte) == 0xffffffff;
+        case VMM_MEMORYMODEL_X64:
+            return MMWINX64_PTE_PAGE_FILE_OFFSET(pte) == 0xffffffff;
+        default:
+            return FALSE;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // INITIALIZATION FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
@@ -1455,10 +2060,9 @@ VOID MmWin_PagingClose()
     if(ctx) {
         ctxVmm->pMmContext = NULL;
         for(i = 0; i < 10; i++) {
-            if(ctx->pPageFile[i]) {
-                fclose(ctx->pPageFile[i]);
-            }
+            MmWin_PfClose(ctx->PageFile + i);
         }
+        Ob_DECREF(ctx->MemCompress.pObCacheMapPage);
         LocalFree(ctx);
     }
 }
@@ -1471,9 +2075,11 @@ VOID MmWin_PagingInitialize(_In_ BOOL fModeFull)
     switch(ctxVmm->tpMemoryModel) {
         case VMM_MEMORYMODEL_X64:
             ctxVmm->fnMemoryModel.pfnPagedRead = MmWinX64_ReadPaged;
+            ctxVmm->fnMemoryModel.pfnPagedReadScatter = MmWin_ReadPagedScatter;
             break;
         case VMM_MEMORYMODEL_X86PAE:
             ctxVmm->fnMemoryModel.pfnPagedRead = (BOOL(*)(PVMM_PROCESS, QWORD, QWORD, PBYTE, PQWORD, PVMM_PTE_TP, QWORD))MmWinX86PAE_ReadPaged;
+            ctxVmm->fnMemoryModel.pfnPagedReadScatter = MmWin_ReadPagedScatter;
             break;
         case VMM_MEMORYMODEL_X86:
             ctxVmm->fnMemoryModel.pfnPagedRead = (BOOL(*)(PVMM_PROCESS, QWORD, QWORD, PBYTE, PQWORD, PVMM_PTE_TP, QWORD))MmWinX86_ReadPaged;
@@ -1485,13 +2091,13 @@ VOID MmWin_PagingInitialize(_In_ BOOL fModeFull)
     if(!ctx) {
         ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(MMWIN_CONTEXT));
         if(!ctx) { return; }
-        InitializeCriticalSection(&ctx->Lock);
+        ctx->MemCompress.pObCacheMapPage = ObCacheMap_New(MMWIN_MEMCOMPRESS_PAGECACHE_MAX, MmWin_MemCompress_PageCache_ValidEntry, OB_CACHEMAP_FLAGS_OBJECT_OB);
         for(i = 0; i < 10; i++) {
             if(ctxMain->cfg.szPageFile[i][0]) {
-                if(fopen_s(&ctx->pPageFile[i], ctxMain->cfg.szPageFile[i], "rb")) {
+                if(!MmWin_PfOpen(ctx->PageFile + i, ctxMain->cfg.szPageFile[i])) {
                     vmmprintfv("WARNING: CANNOT OPEN PAGE FILE #%i '%s'\n", i, ctxMain->cfg.szPageFile[i]);
                 } else {
-                    vmmprintfvv("Successfully opened page file #%i '%s'\n", i, ctxMain->cfg.szPageFile[i]);
+                    vmmprintfvv("Successfully opened page file #%i '%s' (%s)\n", i, ctxMain->cfg.szPageFile[i], (ctx->PageFile[i].pbMap ? "mapped" : "file"));
                 }
             }
         }
@@ -10,6 +10,109 @@
 #define MMX64_PTE_IS_TRANSITION(pte, iPML)          ((((pte & 0x0c01) == 0x0800) && (iPML == 1) && ctxVmm && (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64)) ? ((pte & 0xffffdffffffff000) | 0x005) : 0)
 #define MMX64_PTE_IS_VALID(pte, iPML)               (pte & 0x01)
 
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define MMX64_SIMD_SSE2
+#endif /* _M_X64 || __x86_64__ */
+
+/*
+* Scan a page table page for present entries located above the max physical
+* address and for an entry referencing the page itself. Entries above the max
+* physical address are set in the returned 512-bit bitmap. SSE2 (always present
+* on x64) is used to check two entries at a time; otherwise a scalar fallback.
+* -- ptes
+* -- pa = physical address of the page table page.
+* -- paMax
+* -- pqwBad = 512-bit bitmap of bad entries.
+* -- return = page contains a self-referencing entry.
+*/
+BOOL MmX64_PageScan_Verify(_In_reads_(512) PQWORD ptes, _In_ QWORD pa, _In_ QWORD paMax, _Out_writes_(8) PQWORD pqwBad)
+{
+#ifdef MMX64_SIMD_SSE2
+    DWORD i;
+    BOOL fSelfRef = FALSE;
+    __m128i v, w, gt, eq, bad, self;
+    const __m128i mAddr = _mm_set_epi32(0x000fffff, 0xffffffff, 0x000fffff, 0xffffffff);
+    const __m128i mSign = _mm_set1_epi32(0x80000000);
+    const __m128i mMaxU = _mm_set1_epi64x((long long)paMax);
+    const __m128i mMaxS = _mm_xor_si128(mMaxU, mSign);
+    const __m128i mPageAddr = _mm_set1_epi64x(0x0000fffffffff000);
+    const __m128i mPa = _mm_set1_epi64x((long long)pa);
+    __m128i accSelf = _mm_setzero_si128();
+    ZeroMemory(pqwBad, 8 * sizeof(QWORD));
+    for(i = 0; i < 512; i += 2) {
+        v = _mm_loadu_si128((const __m128i*)(ptes + i));
+        // 64-bit unsigned (pte & 0x000fffffffffffff) > paMax from 32-bit compares:
+        // hi > max.hi || (hi == max.hi && lo > max.lo) - result in sign bit of lane.
+        w = _mm_and_si128(v, mAddr);
+        gt = _mm_cmpgt_epi32(_mm_xor_si128(w, mSign), mMaxS);
+        eq = _mm_cmpeq_epi32(w, mMaxU);
+        gt = _mm_or_si128(gt, _mm_and_si128(eq, _mm_slli_epi64(gt, 32)));
+        bad = _mm_and_si128(gt, _mm_slli_epi64(v, 63));     // present bit -> sign bit
+        pqwBad[i >> 6] |= (QWORD)_mm_movemask_pd(_mm_castsi128_pd(bad)) << (i & 0x3f);
+        // self reference: (pte & 0x0000fffffffff000) == pa
+        self = _mm_cmpeq_epi32(_mm_and_si128(v, mPageAddr), mPa);
+        accSelf = _mm_or_si128(accSelf, _mm_and_si128(self, _mm_shuffle_epi32(self, _MM_SHUFFLE(2, 3, 0, 1))));
+    }
+    fSelfRef = _mm_movemask_epi8(accSelf) ? TRUE : FALSE;
+    return fSelfRef;
+#else /* MMX64_SIMD_SSE2 */
+    DWORD i;
+    QWORD pte;
+    BOOL fSelfRef = FALSE;
+    ZeroMemory(pqwBad, 8 * sizeof(QWORD));
+    for(i = 0; i < 512; i++) {
+        pte = ptes[i];
+        if((pte & 0x01) && ((0x000fffffffffffff & pte) > paMax)) {
+            pqwBad[i >> 6] |= 1ULL << (i & 0x3f);
+        }
+        if(pa == (0x0000fffffffff000 & pte)) {
+            fSelfRef = TRUE;
+        }
+    }
+    return fSelfRef;
+#endif /* MMX64_SIMD_SSE2 */
+}
+
+/*
+* Scan a page table page (PML4, PDPT, PD) for entries pointing to a next level
+* page table - i.e. present, not a large page and user accessible if fUserOnly.
+* The matching entries are set in the 512-bit bitmap pqwNext.
+* -- ptes
+* -- fUserOnly
+* -- pqwNext
+* -- return = number of bitmap qwords with matching entries (0 = no entries).
+*/
+DWORD MmX64_PageScan_NextLevel(_In_reads_(512) PQWORD ptes, _In_ BOOL fUserOnly, _Out_writes_(8) PQWORD pqwNext)
+{
+    DWORD i, c = 0;
+#ifdef MMX64_SIMD_SSE2
+    __m128i v;
+    const __m128i mFlags = _mm_set1_epi64x(fUserOnly ? 0x85 : 0x81);
+    const __m128i mMatch = _mm_set1_epi64x(fUserOnly ? 0x05 : 0x01);
+    ZeroMemory(pqwNext, 8 * sizeof(QWORD));
+    for(i = 0; i < 512; i += 2) {
+        v = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*)(ptes + i)), mFlags), mMatch);
+        v = _mm_slli_epi64(v, 32);                          // low dword compare -> sign bit
+        pqwNext[i >> 6] |= (QWORD)_mm_movemask_pd(_mm_castsi128_pd(v)) << (i & 0x3f);
+    }
+#else /* MMX64_SIMD_SSE2 */
+    QWORD pte;
+    ZeroMemory(pqwNext, 8 * sizeof(QWORD));
+    for(i = 0; i < 512; i++) {
+        pte = ptes[i];
+        if(!(pte & 0x01)) { continue; }  // not valid
+        if(pte & 0x80) { continue; }     // not valid ptr to (PDPT || PD || PT)
+        if(fUserOnly && !(pte & 0x04)) { continue; } // supervisor page when fUserOnly -> not valid
+        pqwNext[i >> 6] |= 1ULL << (i & 0x3f);
+    }
+#endif /* MMX64_SIMD_SSE2 */
+    for(i = 0; i < 8; i++) {
+        if(pqwNext[i]) { c++; }
+    }
+    return c;
+}
+
 /*
 * Tries to verify that a loaded page table is correct. If just a bit strange
 * bytes/ptes supplied in pb will be altered to look better.
@@ -17,27 +120,24 @@
 BOOL MmX64_TlbPageTableVerify(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRefReq)
 {
     DWORD i;
-    QWORD *ptes, c = 0, pte, paMax;
+    QWORD *ptes, c = 0, paMax, qwBad[8];
     BOOL fSelfRef = FALSE;
     if(!pb) { return FALSE; }
     ptes = (PQWORD)pb;
     paMax = max(0xffffffff, ctxMain->dev.paMax);
+    fSelfRef = MmX64_PageScan_Verify(ptes, pa, paMax, qwBad);
     for(i = 0; i < 512; i++) {
-        pte = *(ptes + i);
-        if((pte & 0x01) && ((0x000fffffffffffff & pte) > paMax)) {
-            // A bad PTE, or memory allocated above the physical address max
-            // limit. This may be just trash in the page table in which case
-            // we clear this faulty entry. If too may bad PTEs are found this
-            // is most probably not a page table - zero it out but let it
-            // remain in cache to prevent performance degrading reloads...
-            vmmprintfvv_fn("VMM: BAD PTE %016llx at PA: %016llx i: %i\n", *(ptes + i), pa, i);
-            *(ptes + i) = (QWORD)0;
-            c++;
-            if(c > 16) { break; }
-        }
-        if(pa == (0x0000fffffffff000 & pte)) {
-            fSelfRef = TRUE;
-        }
+        if(!qwBad[i >> 6]) { i |= 0x3f; continue; }
+        if(!(qwBad[i >> 6] & (1ULL << (i & 0x3f)))) { continue; }
+        // A bad PTE, or memory allocated above the physical address max
+        // limit. This may be just trash in the page table in which case
+        // we clear this faulty entry. If too may bad PTEs are found this
+        // is most probably not a page table - zero it out but let it
+        // remain in cache to prevent performance degrading reloads...
+        vmmprintfvv_fn("VMM: BAD PTE %016llx at PA: %016llx i: %i\n", *(ptes + i), pa, i);
+        *(ptes + i) = (QWORD)0;
+        c++;
+        if(c > 16) { break; }
     }
     if((c > 16) || (fSelfRefReq && !fSelfRef)) {
         if(ctxVmm) {
@@ -51,7 +151,7 @@ BOOL MmX64_TlbPageTableVerify(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRe
 
 VOID MmX64_TlbSpider_Stage(_In_ QWORD pa, _In_ BYTE iPML, _In_ BOOL fUserOnly, _In_ POB_SET pPageSet)
 {
-    QWORD i, pe;
+    QWORD i, qwNext[8];
     PVMMOB_CACHE_MEM ptObMEM = NULL;
     // 1: retrieve from cache, add to staging if not found
     ptObMEM = VmmCacheGet(VMM_CACHE_TAG_TLB, pa);
@@ -63,40 +163,236 @@ VOID MmX64_TlbSpider_Stage(_In_ QWORD pa, _In_ BYTE iPML, _In_ BOOL fUserOnly, _
         Ob_DECREF(ptObMEM);
         return;
     }
-    // 2: walk trough all entries for PML4, PDPT, PD
-    for(i = 0; i < 512; i++) {
-        pe = ptObMEM->pqw[i];
-        if(!(pe & 0x01)) { continue; }  // not valid
-        if(pe & 0x80) { continue; }     // not valid ptr to (PDPT || PD || PT)
-        if(fUserOnly && !(pe & 0x04)) { continue; } // supervisor page when fUserOnly -> not valid
-        MmX64_TlbSpider_Stage(pe & 0x0000fffffffff000, iPML - 1, fUserOnly, pPageSet);
+    // 2: walk trough all entries for PML4, PDPT, PD pointing to a next level page table
+    if(MmX64_PageScan_NextLevel(ptObMEM->pqw, fUserOnly, qwNext)) {
+        for(i = 0; i < 512; i++) {
+            if(!qwNext[i >> 6]) { i |= 0x3f; continue; }
+            if(!(qwNext[i >> 6] & (1ULL << (i & 0x3f)))) { continue; }
+            MmX64_TlbSpider_Stage(ptObMEM->pqw[i] & 0x0000fffffffff000, iPML - 1, fUserOnly, pPageSet);
+        }
     }
     Ob_DECREF(ptObMEM);
 }
 
+#define MMX64_TLBSPIDER_UNITS_PER_PROCESS   8       // PML4 subtrees (of 64 entries each) per process.
+#define MMX64_TLBSPIDER_WORKERS_MAX         8
+
+typedef struct tdMMX64_TLBSPIDER_CONTEXT {
+    BOOL fKernelShared;     // kernel DTB is spidered - skip identical kernel PML4 entries of other processes.
+    POB_SET psPageSet;
+    PVMM_PROCESS *ppProcess;
+} MMX64_TLBSPIDER_CONTEXT, *PMMX64_TLBSPIDER_CONTEXT;
+
+/*
+* Stage a work unit (a PML4 subtree of a process) of the spider round.
+* -- ctx
+* -- iUnit
+*/
+VOID MmX64_TlbSpider_StageUnit(_In_ PMMX64_TLBSPIDER_CONTEXT ctx, _In_ DWORD iUnit)
+{
+    QWORD i, iMax, pe;
+    PVMM_PROCESS pProcess;
+    PVMMOB_CACHE_MEM pObPML4, pObPML4K;
+    pProcess = ctx->ppProcess[iUnit / MMX64_TLBSPIDER_UNITS_PER_PROCESS];
+    if((pObPML4 = VmmCacheGet(VMM_CACHE_TAG_TLB, pProcess->paDTB))) {
+        i = (iUnit % MMX64_TLBSPIDER_UNITS_PER_PROCESS) * (512 / MMX64_TLBSPIDER_UNITS_PER_PROCESS);
+        iMax = i + (512 / MMX64_TLBSPIDER_UNITS_PER_PROCESS);
+        // kernel half shared with the kernel DTB is spidered once (by the kernel DTB).
+        pObPML4K = NULL;
+        if(ctx->fKernelShared && (i >= 0x100) && (pProcess->paDTB != ctxVmm->kernel.paDTB)) {
+            pObPML4K = VmmCacheGet(VMM_CACHE_TAG_TLB, ctxVmm->kernel.paDTB);
+        }
+        for(; i < iMax; i++) {
+            pe = pObPML4->pqw[i];
+            if(!(pe & 0x01)) { continue; }  // not valid
+            if(pe & 0x80) { continue; }     // not valid ptr to PDPT
+            if(pProcess->fUserOnly && !(pe & 0x04)) { continue; } // supervisor page when fUserOnly -> not valid
+            if(pObPML4K && (pe == pObPML4K->pqw[i])) { continue; } // shared with kernel DTB
+            MmX64_TlbSpider_Stage(pe & 0x0000fffffffff000, 3, pProcess->fUserOnly, ctx->psPageSet);
+        }
+        Ob_DECREF(pObPML4K);
+        Ob_DECREF(pObPML4);
+    } else if(0 == (iUnit % MMX64_TLBSPIDER_UNITS_PER_PROCESS)) {
+        ObSet_Push(ctx->psPageSet, pProcess->paDTB);
+    }
+}
+
+/*
+* Stage the uncached page tables of all processes in parallel over the process
+* PML4 subtrees into one merged set.
+* -- cProcess
+* -- ppProcess
+* -- fKernelShared
+* -- psPageSet
+*/
+VOID MmX64_TlbSpider_StageParallel(_In_ DWORD cProcess, _In_reads_(cProcess) PVMM_PROCESS *ppProcess, _In_ BOOL fKernelShared, _In_ POB_SET psPageSet)
+{
+    MMX64_TLBSPIDER_CONTEXT ctx = { 0 };
+    ctx.psPageSet = psPageSet;
+    ctx.ppProcess = ppProcess;
+    ctx.fKernelShared = fKernelShared;
+    VmmWorkParallelFor(cProcess * MMX64_TLBSPIDER_UNITS_PER_PROCESS, MMX64_TLBSPIDER_WORKERS_MAX, &ctx, (VOID(*)(PVOID, DWORD))MmX64_TlbSpider_StageUnit);
+}
+
+/*
+* Spider the TLB of multiple processes at the same time. The processes PML4
+* subtrees are staged in parallel on the worker threads and the uncached page
+* tables of each level (PML4, PDPT, PD, PT) are merged into one prefetch over
+* all processes - resulting in few large device reads. Kernel PML4 entries
+* identical to the kernel DTB are only spidered once - by the kernel DTB.
+* -- cProcess
+* -- ppProcess
+*/
+VOID MmX64_TlbSpiderMultiple(_In_ DWORD cProcess, _In_reads_(cProcess) PVMM_PROCESS *ppProcess)
+{
+    DWORD i, cSpider = 0;
+    BOOL fKernelShared = FALSE;
+    POB_SET psObPageSet = NULL;
+    PVMM_PROCESS *ppSpider = NULL;
+    PVMM_PROCESS pObSystemProcess = NULL;
+    if(!(psObPageSet = ObSet_New())) { goto fail; }
+    if(!(ppSpider = LocalAlloc(0, cProcess * sizeof(PVMM_PROCESS)))) { goto fail; }
+    for(i = 0; i < cProcess; i++) {
+        if(!ppProcess[i]->fTlbSpiderDone) {
+            ppSpider[cSpider++] = ppProcess[i];
+            if(ctxVmm->kernel.paDTB && (ppProcess[i]->paDTB == ctxVmm->kernel.paDTB) && !ppProcess[i]->fUserOnly) {
+                fKernelShared = TRUE;
+            }
+            if(!VmmCacheExists(VMM_CACHE_TAG_TLB, ppProcess[i]->paDTB)) {
+                ObSet_Push(psObPageSet, ppProcess[i]->paDTB);
+            }
+        }
+    }
+    if(!cSpider) { goto fail; }
+    if(!fKernelShared && ctxVmm->kernel.paDTB && (pObSystemProcess = VmmProcessGet(4))) {
+        fKernelShared = pObSystemProcess->fTlbSpiderDone && (pObSystemProcess->paDTB == ctxVmm->kernel.paDTB) && !pObSystemProcess->fUserOnly;
+    }
+    VmmTlbPrefetch(psObPageSet);
+    for(i = 0; i < 3; i++) {
+        MmX64_TlbSpider_StageParallel(cSpider, ppSpider, fKernelShared, psObPageSet);
+        VmmTlbPrefetch(psObPageSet);
+    }
+    for(i = 0; i < cSpider; i++) {
+        ppSpider[i]->fTlbSpiderDone = TRUE;
+    }
+fail:
+    Ob_DECREF(pObSystemProcess);
+    LocalFree(ppSpider);
+    Ob_DECREF(psObPageSet);
+}
+
 /*
 * Iterate over PML4, PTPT, PD (3 times in total) to first stage uncached pages
 * and then commit them to the cache.
 */
 VOID MmX64_TlbSpider(_In_ PVMM_PROCESS pProcess)
 {
-    DWORD i;
-    POB_SET pObPageSet = NULL;
     if(pProcess->fTlbSpiderDone) { return; }
-    if(!(pObPageSet = ObSet_New())) { return; }
-    Ob_DECREF(VmmTlbGetPageTable(pProcess->paDTB, FALSE));
-    for(i = 0; i < 3; i++) {
-        MmX64_TlbSpider_Stage(pProcess->paDTB, 4, pProcess->fUserOnly, pObPageSet);
-        VmmTlbPrefetch(pObPageSet);
-    }
-    pProcess->fTlbSpiderDone = TRUE;
-    Ob_DECREF(pObPageSet);
+    MmX64_TlbSpiderMultiple(1, &pProcess);
 }
 
 const QWORD MMX64_PAGETABLEMAP_PML_REGION_SIZE[5] = { 0, 12, 21, 30, 39 };
 const QWORD MMX64_PAGETABLEMAP_PML_REGION_MASK_PG[5] = { 0, 0x0000fffffffff000, 0x0000ffffffe00000, 0x0000ffffc0000000, 0 };
 const QWORD MMX64_PAGETABLEMAP_PML_REGION_MASK_AD[5] = { 0, 0xfff, 0x1fffff, 0x3fffffff, 0 };
 
+/*
+* Prefetch the page tables required to translate a batch of virtual addresses.
+* All addresses advance through the paging hierarchy together - the missing
+* page tables of each level (PML4, PDPT, PD, PT) are collected for the whole
+* batch and fetched in one scatter read before advancing to the next level.
+* -- pProcess
+* -- cva
+* -- pva
+*/
+VOID MmX64_TlbPrefetchVirt2Phys(_In_ PVMM_PROCESS pProcess, _In_ DWORD cva, _In_reads_(cva) PQWORD pva)
+{
+    BYTE iPML;
+    DWORD i, cActive = cva;
+    QWORD pte;
+    PQWORD ppaPT = NULL;
+    POB_SET psObPrefetch = NULL;
+    PVMMOB_CACHE_MEM pObPT;
+    if(!(psObPrefetch = ObSet_New())) { goto fail; }
+    if(!(ppaPT = LocalAlloc(0, cva * sizeof(QWORD)))) { goto fail; }
+    for(i = 0; i < cva; i++) {
+        ppaPT[i] = pProcess->paDTB & 0x0000fffffffff000;
+    }
+    for(iPML = 4; cActive && (iPML >= 1); iPML--) {
+        // 1: stage and fetch missing page tables of the current level
+        for(i = 0; i < cva; i++) {
+            if(ppaPT[i] && !VmmCacheExists(VMM_CACHE_TAG_TLB, ppaPT[i])) {
+                ObSet_Push(psObPrefetch, ppaPT[i]);
+            }
+        }
+        VmmTlbPrefetch(psObPrefetch);
+        if(iPML == 1) { break; }
+        // 2: advance to the next level
+        for(i = 0; i < cva; i++) {
+            if(!ppaPT[i]) { continue; }
+            if(!(pObPT = VmmCacheGet(VMM_CACHE_TAG_TLB, ppaPT[i]))) {
+                ppaPT[i] = 0;
+                cActive--;
+                continue;
+            }
+            pte = pObPT->pqw[0x1ff & (pva[i] >> MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML])];
+            Ob_DECREF(pObPT);
+            if(!(pte & 0x01) || (pte & 0x80) || (pProcess->fUserOnly && !(pte & 0x04))) {
+                ppaPT[i] = 0;                               // not valid / large page / supervisor
+                cActive--;
+                continue;
+            }
+            ppaPT[i] = pte & 0x0000fffffffff000;
+        }
+    }
+fail:
+    LocalFree(ppaPT);
+    Ob_DECREF(psObPrefetch);
+}
+
+VOID MmX64_Virt2PhysRange_DoWork(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx, _In_ QWORD paPT, _In_ BYTE iPML, _In_ QWORD vaBase)
+{
+    QWORD i, pte, va, vaFirst, vaLast;
+    PVMMOB_CACHE_MEM pObPTEs;
+    if(!(pObPTEs = VmmTlbGetPageTable(paPT & 0x0000fffffffff000, FALSE))) { return; }
+    i = (ctx->vaFirst > vaBase) ? (0x1ff & (ctx->vaFirst >> MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML])) : 0;
+    for(; i < 512; i++) {
+        va = vaBase + (i << MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML]);
+        if((iPML == 4) && (i >= 0x100)) {
+            va |= 0xffff000000000000;                       // CANONICAL KERNEL ADDRESS
+        }
+        if((va > ctx->vaLast) || ctx->fFail) { break; }
+        vaFirst = max(va, ctx->vaFirst);
+        vaLast = min(va + (1ULL << MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML]) - 1, ctx->vaLast);
+        pte = pObPTEs->pqw[i];
+        if(!MMX64_PTE_IS_VALID(pte, iPML)) {
+            if(iPML == 1) {                                 // NOT VALID -> PAGED/TRANSITION/..
+                VmmVirt2PhysRange_PushPte(ctx, vaFirst, pte, vaLast - vaFirst + 1);
+            }
+            continue;
+        }
+        if(ctx->pProcess->fUserOnly && !(pte & 0x04)) { continue; }    // SUPERVISOR PAGE & USER MODE REQ
+        if(pte & 0x000f000000000000) { continue; }          // RESERVED
+        if((iPML == 1) || (pte & 0x80) /* PS */) {
+            if(iPML == 4) { continue; }                     // NO SUPPORT IN PML4
+            VmmVirt2PhysRange_Push(ctx, vaFirst, (pte & MMX64_PAGETABLEMAP_PML_REGION_MASK_PG[iPML]) + (vaFirst - va), vaLast - vaFirst + 1, VMM_PTE_TP_HARDWARE);
+            continue;
+        }
+        MmX64_Virt2PhysRange_DoWork(ctx, pte, iPML - 1, va);
+    }
+    Ob_DECREF(pObPTEs);
+}
+
+/*
+* Translate a virtual address range into extents by walking the page tables
+* of the range only once - large pages and physically contiguous page table
+* entries are merged into single extents.
+* -- ctx
+*/
+VOID MmX64_Virt2PhysRange(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx)
+{
+    MmX64_Virt2PhysRange_DoWork(ctx, ctx->pProcess->paDTB, 4, 0);
+}
+
 VOID MmX64_MapInitialize_Index(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_PTEENTRY pMemMap, _In_ PDWORD pcMemMap, _In_ QWORD vaBase, _In_ BYTE iPML, _In_ QWORD PTEs[512], _In_ BOOL fSupervisorPML, _In_ QWORD paMax)
 {
     PVMMOB_CACHE_MEM pObNextPT;
@@ -166,19 +462,128 @@ VOID MmX64_CallbackCleanup_ObPteMap(PVMMOB_MAP_PTE pOb)
     LocalFree(pOb->pbMultiText);
 }
 
+/*
+* Retrieve the PTE map of the kernel DTB (System process) if the kernel half of
+* the process page tables may be shared with it. This must be called before
+* the process LockUpdate is acquired since the System process PTE map may have
+* to be initialized (under the System process LockUpdate).
+* CALLER DECREF: return
+* -- pProcess
+* -- return = the System process PTE map, or NULL if nothing may be shared.
+*/
+PVMMOB_MAP_PTE MmX64_PteMapInitialize_KernelMap(_In_ PVMM_PROCESS pProcess)
+{
+    PVMM_PROCESS pObSystemProcess = NULL;
+    PVMMOB_MAP_PTE pObMapK = NULL;
+    if((ctxVmm->tpSystem != VMM_SYSTEM_WINDOWS_X64) || pProcess->fUserOnly || !ctxVmm->kernel.paDTB || (pProcess->paDTB == ctxVmm->kernel.paDTB)) { return NULL; }
+    if((pObSystemProcess = VmmProcessGet(4)) && (pObSystemProcess != pProcess) && (pObSystemProcess->paDTB == ctxVmm->kernel.paDTB) && !pObSystemProcess->fUserOnly) {
+        VmmMap_GetPte(pObSystemProcess, &pObMapK, FALSE);
+    }
+    Ob_DECREF(pObSystemProcess);
+    return pObMapK;
+}
+
+/*
+* Find the upper half PML4 entries of the process which are identical to the
+* kernel DTB. Shared entries are zeroed in the PML4 copy and marked in the
+* shared bitmask.
+* -- pqwPML4 = copy of the process PML4 to walk.
+* -- pqwSharedMask = bitmask of shared upper half PML4 entries (256 bits).
+* -- return = TRUE if any entry is shared.
+*/
+_Success_(return)
+BOOL MmX64_PteMapInitialize_KernelShared(_Inout_ QWORD pqwPML4[512], _Out_writes_(4) PQWORD pqwSharedMask)
+{
+    QWORD i;
+    BOOL fShared = FALSE;
+    PVMMOB_CACHE_MEM pObPML4K = NULL;
+    ZeroMemory(pqwSharedMask, 4 * sizeof(QWORD));
+    if(!(pObPML4K = VmmTlbGetPageTable(ctxVmm->kernel.paDTB, FALSE))) { return FALSE; }
+    for(i = 0x100; i < 0x200; i++) {
+        if(pqwPML4[i] && (pqwPML4[i] == pObPML4K->pqw[i])) {
+            pqwSharedMask[(i - 0x100) >> 6] |= 1ULL << (i & 0x3f);
+            pqwPML4[i] = 0;
+            fShared = TRUE;
+        }
+    }
+    Ob_DECREF(pObPML4K);
+    return fShared;
+}
+
+/*
+* Merge the entries of the System process PTE map located in shared PML4 slots
+* into the (va sorted) PTE map of the process. Entries are clipped to the
+* shared 512GB slots; the text of the System map isn't carried over. The
+* software PTE count of a clipped entry is estimated proportionally.
+* -- pMemMap
+* -- pcMemMap
+* -- pMapK = System process PTE map.
+* -- pqwSharedMask
+*/
+VOID MmX64_PteMapInitialize_MergeKernelShared(_Inout_ PVMM_MAP_PTEENTRY pMemMap, _Inout_ PDWORD pcMemMap, _In_ PVMMOB_MAP_PTE pMapK, _In_reads_(4) PQWORD pqwSharedMask)
+{
+    DWORD iK, iP = 0, cMerge = 0, cMemMapProcess = *pcMemMap;
+    QWORD va, vaLast, vaSlotLast, iSlot;
+    PVMM_MAP_PTEENTRY peK, pe, pMerge;
+    if(!(pMerge = LocalAlloc(LMEM_ZEROINIT, VMM_MEMMAP_ENTRIES_MAX * sizeof(VMM_MAP_PTEENTRY)))) { return; }
+    for(iK = 0; iK < pMapK->cMap; iK++) {
+        peK = pMapK->pMap + iK;
+        if(!peK->cPages) { continue; }
+        va = peK->vaBase;
+        vaLast = peK->vaBase + (peK->cPages << 12) - 1;
+        while(TRUE) {
+            iSlot = (va >> 39) & 0x1ff;
+            vaSlotLast = min(va | ((1ULL << 39) - 1), vaLast);
+            if((iSlot >= 0x100) && (pqwSharedMask[(iSlot - 0x100) >> 6] & (1ULL << (iSlot & 0x3f)))) {
+                // own process entries located before the shared entry:
+                while((iP < cMemMapProcess) && (pMemMap[iP].vaBase < va) && (cMerge < VMM_MEMMAP_ENTRIES_MAX - 1)) {
+                    pMerge[cMerge++] = pMemMap[iP++];
+                }
+                if(cMerge >= VMM_MEMMAP_ENTRIES_MAX - 1) { break; }
+                pe = pMerge + cMerge++;
+                pe->vaBase = va;
+                pe->cPages = (vaSlotLast + 1 - va) >> 12;
+                pe->fPage = peK->fPage;
+                pe->fWoW64 = peK->fWoW64;
+                pe->cSoftware = (pe->cPages == peK->cPages) ? peK->cSoftware : (DWORD)((peK->cSoftware * pe->cPages) / peK->cPages);
+            }
+            if(vaSlotLast == vaLast) { break; }
+            va = vaSlotLast + 1;
+        }
+    }
+    while((iP < cMemMapProcess) && (cMerge < VMM_MEMMAP_ENTRIES_MAX - 1)) {
+        pMerge[cMerge++] = pMemMap[iP++];
+    }
+    memcpy(pMemMap, pMerge, cMerge * sizeof(VMM_MAP_PTEENTRY));
+    *pcMemMap = cMerge;
+    LocalFree(pMerge);
+}
+
+/*
+* Initialize the PTE map of a process by walking its page tables. On Windows
+* the kernel half of the page tables of a process is mostly identical to the
+* kernel DTB - those parts are taken from the System process PTE map instead
+* of walking them once more per process.
+* -- pProcess
+* -- return
+*/
 _Success_(return)
 BOOL MmX64_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
 {
     QWORD i;
     DWORD cMemMap = 0;
+    QWORD pqwPML4[512], qwSharedMask[4];
     PVMMOB_CACHE_MEM pObPML4;
     PVMM_MAP_PTEENTRY pMemMap = NULL;
-    PVMMOB_MAP_PTE pObMap = NULL;
+    PVMMOB_MAP_PTE pObMap = NULL, pObMapKernel = NULL;
     // already existing?
     if(pProcess->Map.pObPte) { return TRUE; }
+    // kernel map is retrieved before the process lock is taken (lock order).
+    pObMapKernel = MmX64_PteMapInitialize_KernelMap(pProcess);
     EnterCriticalSection(&pProcess->LockUpdate);
     if(pProcess->Map.pObPte) {
         LeaveCriticalSection(&pProcess->LockUpdate);
+        Ob_DECREF(pObMapKernel);
         return TRUE;
     }
     // allocate temporary buffer and walk page tables
@@ -186,15 +591,23 @@ BOOL MmX64_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
     if(pObPML4) {
         pMemMap = (PVMM_MAP_PTEENTRY)LocalAlloc(LMEM_ZEROINIT, VMM_MEMMAP_ENTRIES_MAX * sizeof(VMM_MAP_PTEENTRY));
         if(pMemMap) {
-            MmX64_MapInitialize_Index(pProcess, pMemMap, &cMemMap, 0, 4, pObPML4->pqw, FALSE, ctxMain->dev.paMax);
+            memcpy(pqwPML4, pObPML4->pqw, sizeof(pqwPML4));
+            if(pObMapKernel && !MmX64_PteMapInitialize_KernelShared(pqwPML4, qwSharedMask)) {
+                Ob_DECREF_NULL(&pObMapKernel);
+            }
+            MmX64_MapInitialize_Index(pProcess, pMemMap, &cMemMap, 0, 4, pqwPML4, FALSE, ctxMain->dev.paMax);
             for(i = 0; i < cMemMap; i++) { // fixup sign extension for kernel addresses
                 if(pMemMap[i].vaBase & 0x0000800000000000) {
                     pMemMap[i].vaBase |= 0xffff000000000000;
                 }
             }
+            if(pObMapKernel) {
+                MmX64_PteMapInitialize_MergeKernelShared(pMemMap, &cMemMap, pObMapKernel, qwSharedMask);
+            }
         }
         Ob_DECREF(pObPML4);
     }
+    Ob_DECREF_NULL(&pObMapKernel);
     // allocate VmmOb depending on result
     pObMap = Ob_Alloc(OB_TAG_MAP_PTE, 0, sizeof(VMMOB_MAP_PTE) + cMemMap * sizeof(VMM_MAP_PTEENTRY), (OB_CLEANUP_CB)MmX64_CallbackCleanup_ObPteMap, NULL);
     if(!pObMap) {
@@ -215,7 +628,7 @@ BOOL MmX64_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
 }
 
 _Success_(return)
-BOOL MmX64_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa)
+BOOL MmX64_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift)
 {
     QWORD pte, i, qwMask;
     PVMMOB_CACHE_MEM pObPTEs;
@@ -237,9 +650,10 @@ BOOL MmX64_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_
         *ppa = pte & 0x0000fffffffff000 & qwMask;           // MASK AWAY BITS FOR 4kB/2MB/1GB PAGES
         qwMask = qwMask ^ 0xffffffffffffffff;
         *ppa = *ppa | (qwMask & va);                        // FILL LOWER ADDRESS BITS
+        if(pbPageShift) { *pbPageShift = MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML]; }
         return TRUE;
     }
-    return MmX64_Virt2Phys(pte, fUserOnly, iPML - 1, va, ppa);
+    return MmX64_Virt2Phys(pte, fUserOnly, iPML - 1, va, ppa, pbPageShift);
 }
 
 VOID MmX64_Virt2PhysVadEx(_In_ QWORD paPT, _Inout_ PVMMOB_MAP_VADEX pVadEx, _In_ BYTE iPML, _Inout_ PDWORD piVadEx)
@@ -379,12 +793,16 @@ VOID MmX64_Initialize()
     }
     ctxVmm->fnMemoryModel.pfnClose = MmX64_Close;
     ctxVmm->fnMemoryModel.pfnVirt2Phys = MmX64_Virt2Phys;
+    ctxVmm->fnMemoryModel.pfnVirt2PhysRange = MmX64_Virt2PhysRange;
     ctxVmm->fnMemoryModel.pfnVirt2PhysVadEx = MmX64_Virt2PhysVadEx;
     ctxVmm->fnMemoryModel.pfnVirt2PhysGetInformation = MmX64_Virt2PhysGetInformation;
     ctxVmm->fnMemoryModel.pfnPhys2VirtGetInformation = MmX64_Phys2VirtGetInformation;
     ctxVmm->fnMemoryModel.pfnPteMapInitialize = MmX64_PteMapInitialize;
     ctxVmm->fnMemoryModel.pfnTlbSpider = MmX64_TlbSpider;
+    ctxVmm->fnMemoryModel.pfnTlbSpiderMultiple = MmX64_TlbSpiderMultiple;
+    ctxVmm->fnMemoryModel.pfnTlbPrefetchVirt2Phys = MmX64_TlbPrefetchVirt2Phys;
     ctxVmm->fnMemoryModel.pfnTlbPageTableVerify = MmX64_TlbPageTableVerify;
+    ctxVmm->fnMemoryModel.pfnReadScatterVirtualTranslate = VmmReadScatterVirtual_TranslateX64;
     ctxVmm->tpMemoryModel = VMM_MEMORYMODEL_X64;
     ctxVmm->f32 = FALSE;
 }
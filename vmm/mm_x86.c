@@ -149,7 +149,7 @@ BOOL MmX86_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
 }
 
 _Success_(return)
-BOOL MmX86_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa)
+BOOL MmX86_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift)
 {
     DWORD pte, i;
     PVMMOB_CACHE_MEM pObPTEs;
@@ -168,15 +168,17 @@ BOOL MmX86_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_
     }
     if(fUserOnly && !(pte & 0x04)) { return FALSE; }        // SUPERVISOR PAGE & USER MODE REQ
     if((iPML == 2) && !(pte & 0x80) /* PS */) {
-        return MmX86_Virt2Phys(pte, fUserOnly, 1, va, ppa);
+        return MmX86_Virt2Phys(pte, fUserOnly, 1, va, ppa, pbPageShift);
     }
     if(iPML == 1) { // 4kB PAGE
         *ppa = pte & 0xfffff000;
+        if(pbPageShift) { *pbPageShift = 12; }
         return TRUE;
     }
     // 4MB PAGE
     if(pte & 0x003e0000) { return FALSE; }                  // RESERVED
     *ppa = (((QWORD)(pte & 0x0001e000)) << (32 - 13)) + (pte & 0xffc00000) + (va & 0x003ff000);
+    if(pbPageShift) { *pbPageShift = 22; }
     return TRUE;
 }
 
@@ -325,6 +327,7 @@ VOID MmX86_Initialize()
     ctxVmm->fnMemoryModel.pfnPteMapInitialize = MmX86_PteMapInitialize;
     ctxVmm->fnMemoryModel.pfnTlbSpider = MmX86_TlbSpider;
     ctxVmm->fnMemoryModel.pfnTlbPageTableVerify = MmX86_TlbPageTableVerify;
+    ctxVmm->fnMemoryModel.pfnReadScatterVirtualTranslate = VmmReadScatterVirtual_TranslateX86;
     ctxVmm->tpMemoryModel = VMM_MEMORYMODEL_X86;
     ctxVmm->f32 = TRUE;
 }
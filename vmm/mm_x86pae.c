@@ -200,7 +200,7 @@ BOOL MmX86PAE_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
 }
 
 _Success_(return)
-BOOL MmX86PAE_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa)
+BOOL MmX86PAE_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift)
 {
     PBYTE pbPTEs;
     QWORD pte, i, qwMask;
@@ -221,7 +221,7 @@ BOOL MmX86PAE_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _I
         Ob_DECREF(pObPTEs);
         if(!(pte & 0x01)) { return FALSE; }                 // NOT VALID
         if(pte & 0xffff0000000001e6) { return FALSE; }      // RESERVED BITS IN PDPTE
-        return MmX86PAE_Virt2Phys(pte, fUserOnly, 2, va, ppa);
+        return MmX86PAE_Virt2Phys(pte, fUserOnly, 2, va, ppa, pbPageShift);
     }
     // PT or PD
     pte = pObPTEs->pqw[i];
@@ -237,9 +237,10 @@ BOOL MmX86PAE_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _I
         *ppa = pte & 0x0000fffffffff000 & qwMask;           // MASK AWAY BITS FOR 4kB/2MB/1GB PAGES
         qwMask = qwMask ^ 0xffffffffffffffff;
         *ppa = *ppa | (qwMask & va);                        // FILL LOWER ADDRESS BITS
+        if(pbPageShift) { *pbPageShift = MMX86PAE_PAGETABLEMAP_PML_REGION_SIZE[iPML]; }
         return TRUE;
     }
-    return MmX86PAE_Virt2Phys(pte, fUserOnly, 1, va, ppa);
+    return MmX86PAE_Virt2Phys(pte, fUserOnly, 1, va, ppa, pbPageShift);
 }
 
 VOID MmX86PAE_Virt2PhysVadEx(_In_ QWORD paPT, _Inout_ PVMMOB_MAP_VADEX pVadEx, _In_ BYTE iPML, _Inout_ PDWORD piVadEx)
@@ -412,6 +413,7 @@ VOID MmX86PAE_Initialize()
     ctxVmm->fnMemoryModel.pfnPteMapInitialize = MmX86PAE_PteMapInitialize;
     ctxVmm->fnMemoryModel.pfnTlbSpider = MmX86PAE_TlbSpider;
     ctxVmm->fnMemoryModel.pfnTlbPageTableVerify = MmX86PAE_TlbPageTableVerify;
+    ctxVmm->fnMemoryModel.pfnReadScatterVirtualTranslate = VmmReadScatterVirtual_TranslateX86PAE;
     ctxVmm->tpMemoryModel = VMM_MEMORYMODEL_X86PAE;
     ctxVmm->f32 = TRUE;
 }
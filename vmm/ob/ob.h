@@ -36,6 +36,7 @@
 #define OB_TAG_MAP_NET                  'Mnet'
 #define OB_TAG_MAP_PFN                  'Mpfn'
 #define OB_TAG_MAP_EVIL                 'Mevl'
+#define OB_TAG_MAP_EXTENT               'Mext'
 #define OB_TAG_MAP_TASK                 'Mtsk'
 #define OB_TAG_MOD_MINIDUMP_CTX         'mMDx'
 #define OB_TAG_OBJ_ERROR                'Oerr'
@@ -45,6 +46,7 @@
 #define OB_TAG_PDB_ENTRY                'PdbE'
 #define OB_TAG_PFN_CONTEXT              'PfnC'
 #define OB_TAG_PFN_PROC_TABLE           'PfnT'
+#define OB_TAG_PHYS2VIRT_INDEX          'P2Vi'
 #define OB_TAG_REG_HIVE                 'Rhve'
 #define OB_TAG_REG_KEY                  'Rkey'
 #define OB_TAG_REG_KEYVALUE             'Rval'
@@ -995,6 +997,35 @@ DWORD ObCompress_Size(_In_opt_ POB_COMPRESSED pdc);
 _Success_(return != NULL)
 POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc);
 
+#define OB_COMPRESS_FORMAT_NONE         0x0000      // not compressed (raw copy).
+#define OB_COMPRESS_FORMAT_LZ4          0x8000      // lz4 - other values are windows COMPRESSION_FORMAT_*.
+
+/*
+* Compress a buffer into a caller supplied buffer. This is a raw buffer helper
+* for callers that manage their own storage (no object is created).
+* -- pb
+* -- cb
+* -- pbOut
+* -- cbOut
+* -- pcbOut = the compressed size on success.
+* -- pusFormat = the OB_COMPRESS_FORMAT_* to pass to ObCompress_DecompressBuffer.
+* -- return = TRUE on success, FALSE on fail or if compressed data exceeds cbOut.
+*/
+_Success_(return)
+BOOL ObCompress_CompressBuffer(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_writes_to_(cbOut, *pcbOut) PBYTE pbOut, _In_ DWORD cbOut, _Out_ PDWORD pcbOut, _Out_ PUSHORT pusFormat);
+
+/*
+* Decompress a buffer compressed with ObCompress_CompressBuffer.
+* -- usFormat = format returned by ObCompress_CompressBuffer (or OB_COMPRESS_FORMAT_NONE).
+* -- pbCompressed
+* -- cbCompressed
+* -- pbOut
+* -- cbOut = the exact uncompressed size.
+* -- return
+*/
+_Success_(return)
+BOOL ObCompress_DecompressBuffer(_In_ USHORT usFormat, _In_reads_(cbCompressed) PBYTE pbCompressed, _In_ DWORD cbCompressed, _Out_writes_(cbOut) PBYTE pbOut, _In_ DWORD cbOut);
+
 
 
 // ----------------------------------------------------------------------------
@@ -11,7 +11,7 @@
 //
 #include "ob.h"
 
-#define OB_COMPRESSED_MAX_THREADS               2
+#define OB_COMPRESSED_MAX_THREADS               0x80    // compression workspaces (>= max # of vmm worker threads).
 #define OB_COMPRESSED_CACHED_ENTRIES_MAX        0x40
 #define OB_COMPRESSED_CACHED_ENTRIES_MAXSIZE    0x00100000
 #define OB_COMPRESSED_IS_VALID(p)               (p && (p->ObHdr._magic == OB_HEADER_MAGIC) && (p->ObHdr._tag == OB_TAG_CORE_COMPRESSED))
@@ -62,22 +62,22 @@ typedef struct tdOB_COMPRESSED_WORKSPACE {
 } OB_COMPRESSED_WORKSPACE;
 
 /*
-* Internal helper function to compress bytes.
+* Internal helper function to compress bytes into a caller supplied buffer.
 * -- pb
 * -- cb
-* -- ppb
-* -- pcb
+* -- pbOut
+* -- cbOut
+* -- pcbOut
 * -- pusRtlCompressionFormat
 * -- return
-* CALLER LocalFree: *ppb
 */
 _Success_(return)
-BOOL _ObCompressed_Compress(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PBYTE *ppb, _Out_ PDWORD pcb, _Out_ PUSHORT pusRtlCompressionFormat)
+BOOL _ObCompressed_CompressToBuffer(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_writes_to_(cbOut, *pcbOut) PBYTE pbOut, _In_ DWORD cbOut, _Out_ PDWORD pcbOut, _Out_ PUSHORT pusRtlCompressionFormat)
 {
     BOOL f;
     NTSTATUS nt;
-    DWORD cbResult, i;
-    PBYTE pbResult = NULL, pbBuffer = NULL;
+    DWORD i, iStart;
+    OB_COMPRESSED_WORKSPACE *pWS;
     static DWORD iWorkSpace = 0;
     static OB_COMPRESSED_WORKSPACE WorkSpace[OB_COMPRESSED_MAX_THREADS] = { 0 };
     static OB_COMPRESSED_RtlCompressBuffer *pfnRtlCompressBuffer = NULL;
@@ -95,10 +95,6 @@ BOOL _ObCompressed_Compress(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PBYTE
             (hNtDll = LoadLibraryA("ntdll.dll")) &&
             (pfnRtlGetCompressionWorkSpaceSize = (OB_COMPRESSED_RtlGetCompressionWorkSpaceSize *)GetProcAddress(hNtDll, "RtlGetCompressionWorkSpaceSize")) &&
             (0 == pfnRtlGetCompressionWorkSpaceSize(usRtlCompressionFormat, &ulCompressBufferWorkSpaceSize, &ulCompressFragmentWorkSpaceSize));
-        for(i = 0; f && (i < OB_COMPRESSED_MAX_THREADS); i++) {
-            WorkSpace[i].cbWorkBuffer = ulCompressBufferWorkSpaceSize;
-            WorkSpace[i].pbWorkBuffer = LocalAlloc(0, ulCompressBufferWorkSpaceSize);
-        }
         if(f) {
             pfnRtlCompressBuffer = (OB_COMPRESSED_RtlCompressBuffer *)GetProcAddress(hNtDll, "RtlCompressBuffer");
         }
@@ -109,71 +105,57 @@ BOOL _ObCompressed_Compress(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PBYTE
         }
         if(!pfnRtlCompressBuffer) { return FALSE; }
     }
-    // 2: compress
-    if(!(pbBuffer = LocalAlloc(0, cb))) { goto fail; }
-    i = InterlockedIncrement(&iWorkSpace) % OB_COMPRESSED_MAX_THREADS;
-    AcquireSRWLockExclusive(&WorkSpace[i].LockSRW);
-    nt = pfnRtlCompressBuffer(usRtlCompressionFormat, pb, cb, pbBuffer, cb, 4096, &cbResult, WorkSpace->pbWorkBuffer);
-    ReleaseSRWLockExclusive(&WorkSpace[i].LockSRW);
-    if(nt) { goto fail; }
-    if(!(pbResult = LocalAlloc(0, cbResult))) { goto fail; }
-    memcpy(pbResult, pbBuffer, cbResult);
-    *pcb = cbResult;
-    *ppb = pbResult;
+    // 2: claim a free workspace (block on the round-robin workspace only if
+    //    all workspaces are in use) - workspaces are allocated on first use.
+    iStart = InterlockedIncrement(&iWorkSpace);
+    for(i = 0; i < OB_COMPRESSED_MAX_THREADS; i++) {
+        if(TryAcquireSRWLockExclusive(&WorkSpace[(iStart + i) % OB_COMPRESSED_MAX_THREADS].LockSRW)) { break; }
+    }
+    if(i == OB_COMPRESSED_MAX_THREADS) {
+        i = 0;
+        AcquireSRWLockExclusive(&WorkSpace[iStart % OB_COMPRESSED_MAX_THREADS].LockSRW);
+    }
+    pWS = &WorkSpace[(iStart + i) % OB_COMPRESSED_MAX_THREADS];
+    if(!pWS->pbWorkBuffer && (pWS->pbWorkBuffer = LocalAlloc(0, ulCompressBufferWorkSpaceSize))) {
+        pWS->cbWorkBuffer = ulCompressBufferWorkSpaceSize;
+    }
+    // 3: compress
+    nt = pWS->pbWorkBuffer ? pfnRtlCompressBuffer(usRtlCompressionFormat, pb, cb, pbOut, cbOut, 4096, pcbOut, pWS->pbWorkBuffer) : 1;
+    ReleaseSRWLockExclusive(&pWS->LockSRW);
     *pusRtlCompressionFormat = usRtlCompressionFormat;
-fail:
-    LocalFree(pbBuffer);
-    return pbResult ? TRUE : FALSE;
+    return nt ? FALSE : TRUE;
 }
 
 /*
-* Retrieve uncompressed from a compressed data object.
-* CALLER DECREF: return
-* -- pdc
-* -- return
+* Internal helper function to decompress bytes into a caller supplied buffer.
+* -- usRtlCompressionFormat
+* -- pbCompressed
+* -- cbCompressed
+* -- pbOut
+* -- cbOut
+* -- return = TRUE if exactly cbOut bytes were decompressed.
 */
-_Success_(return != NULL)
-POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc)
+_Success_(return)
+BOOL _ObCompressed_DecompressToBuffer(_In_ USHORT usRtlCompressionFormat, _In_reads_(cbCompressed) PBYTE pbCompressed, _In_ DWORD cbCompressed, _Out_writes_(cbOut) PBYTE pbOut, _In_ DWORD cbOut)
 {
-    // function have a static global cache map shared amongst all instances
-    // which will cache up to OB_COMPRESSED_CACHED_ENTRIES_MAX decompressed
-    // entries smaller than OB_COMPRESSED_CACHED_ENTRIES_MAXSIZE.
-    static POB_CACHEMAP pObCacheMap = NULL;
     static SRWLOCK InitLockSRW = { 0 };
     static OB_COMPRESSED_RtlDecompressBuffer *pfnRtlDecompressBuffer = NULL;
     HANDLE hNtDll = 0;
-    POB_DATA pObData = NULL;
     ULONG ulFinalUncompressedSize = 0;
-    if(!OB_COMPRESSED_IS_VALID(pdc)) { return NULL; }
-    // 1: ensure compress functionality:
+    if(usRtlCompressionFormat == OB_COMPRESS_FORMAT_LZ4) { return FALSE; }
+    // 1: ensure initialization
     if(!pfnRtlDecompressBuffer) {
         AcquireSRWLockExclusive(&InitLockSRW);
-        if(!pfnRtlDecompressBuffer) {
-            if(!pObCacheMap) {
-                pObCacheMap = ObCacheMap_New(OB_COMPRESSED_CACHED_ENTRIES_MAX, NULL, OB_CACHEMAP_FLAGS_OBJECT_OB);
-            }
-            if(pObCacheMap && (hNtDll = LoadLibraryA("ntdll.dll"))) {
-                pfnRtlDecompressBuffer = (OB_COMPRESSED_RtlDecompressBuffer *)GetProcAddress(hNtDll, "RtlDecompressBuffer");
-                FreeLibrary(hNtDll);
-            }
+        if(!pfnRtlDecompressBuffer && (hNtDll = LoadLibraryA("ntdll.dll"))) {
+            pfnRtlDecompressBuffer = (OB_COMPRESSED_RtlDecompressBuffer *)GetProcAddress(hNtDll, "RtlDecompressBuffer");
+            FreeLibrary(hNtDll);
         }
         ReleaseSRWLockExclusive(&InitLockSRW);
-        if(!pfnRtlDecompressBuffer) { return NULL; }
-    }
-    // 2: fetch from cache (if possible):
-    if(pObCacheMap && (pObData = ObCacheMap_GetByKey(pObCacheMap, pdc->qwCacheKey))) {
-        return pObData;
-    }
-    // 3: decompress and insert into cache
-    if(!(pObData = Ob_Alloc(OB_TAG_CORE_DATA, 0, sizeof(OB) + pdc->cbUncompressed, NULL, NULL))) { return NULL; }
-    if(0 != pfnRtlDecompressBuffer(pdc->usRtlCompressionFormat, pObData->pb, pdc->cbUncompressed, pdc->pbCompressed, pdc->cbCompressed, &ulFinalUncompressedSize)) {
-        Ob_DECREF(pObData);
-        return NULL;
-    }
-    if(pObData->ObHdr.cbData < OB_COMPRESSED_CACHED_ENTRIES_MAXSIZE) {    // only cache objects smaller than threshold
-        ObCacheMap_Push(pObCacheMap, pdc->qwCacheKey, pObData, 0);
+        if(!pfnRtlDecompressBuffer) { return FALSE; }
     }
-    return pObData;
+    // 2: decompress
+    if(0 != pfnRtlDecompressBuffer(usRtlCompressionFormat, pbOut, cbOut, pbCompressed, cbCompressed, &ulFinalUncompressedSize)) { return FALSE; }
+    return ulFinalUncompressedSize == cbOut;
 }
 
 #endif /* _WIN32 */
@@ -181,6 +163,44 @@ POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc)
 
 #include <lz4.h>
 
+/*
+* Internal helper function to compress bytes into a caller supplied buffer.
+* -- pb
+* -- cb
+* -- pbOut
+* -- cbOut
+* -- pcbOut
+* -- pusRtlCompressionFormat
+* -- return
+*/
+_Success_(return)
+BOOL _ObCompressed_CompressToBuffer(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_writes_to_(cbOut, *pcbOut) PBYTE pbOut, _In_ DWORD cbOut, _Out_ PDWORD pcbOut, _Out_ PUSHORT pusRtlCompressionFormat)
+{
+    int cbResult;
+    if((cbResult = LZ4_compress_default(pb, pbOut, cb, cbOut)) <= 0) { return FALSE; }
+    *pcbOut = (DWORD)cbResult;
+    *pusRtlCompressionFormat = OB_COMPRESS_FORMAT_LZ4;
+    return TRUE;
+}
+
+/*
+* Internal helper function to decompress bytes into a caller supplied buffer.
+* -- usRtlCompressionFormat
+* -- pbCompressed
+* -- cbCompressed
+* -- pbOut
+* -- cbOut
+* -- return = TRUE if exactly cbOut bytes were decompressed.
+*/
+_Success_(return)
+BOOL _ObCompressed_DecompressToBuffer(_In_ USHORT usRtlCompressionFormat, _In_reads_(cbCompressed) PBYTE pbCompressed, _In_ DWORD cbCompressed, _Out_writes_(cbOut) PBYTE pbOut, _In_ DWORD cbOut)
+{
+    if(usRtlCompressionFormat != OB_COMPRESS_FORMAT_LZ4) { return FALSE; }
+    return (int)cbOut == LZ4_decompress_safe(pbCompressed, pbOut, cbCompressed, cbOut);
+}
+
+#endif /* LINUX */
+
 /*
 * Internal helper function to compress bytes.
 * -- pb
@@ -192,19 +212,16 @@ POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc)
 * CALLER LocalFree: *ppb
 */
 _Success_(return)
-BOOL _ObCompressed_Compress(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PBYTE * ppb, _Out_ PDWORD pcb, _Out_ PUSHORT pusRtlCompressionFormat)
+BOOL _ObCompressed_Compress(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PBYTE *ppb, _Out_ PDWORD pcb, _Out_ PUSHORT pusRtlCompressionFormat)
 {
     DWORD cbResult = 0;
     PBYTE pbResult = NULL, pbBuffer = NULL;
     if(!(pbBuffer = LocalAlloc(0, cb))) { goto fail; }
-    if(!(cbResult = LZ4_compress_default(pb, pbBuffer, cb, cb))) {
-        goto fail;
-    }
+    if(!_ObCompressed_CompressToBuffer(pb, cb, pbBuffer, cb, &cbResult, pusRtlCompressionFormat)) { goto fail; }
     if(!(pbResult = LocalAlloc(0, cbResult))) { goto fail; }
     memcpy(pbResult, pbBuffer, cbResult);
     *pcb = cbResult;
     *ppb = pbResult;
-    *pusRtlCompressionFormat = 0;
 fail:
     LocalFree(pbBuffer);
     return pbResult ? TRUE : FALSE;
@@ -226,7 +243,7 @@ POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc)
     static SRWLOCK InitLockSRW = { 0 };
     POB_DATA pObData = NULL;
     if(!OB_COMPRESSED_IS_VALID(pdc)) { return NULL; }
-    // 1: ensure compress functionality:
+    // 1: ensure cache map:
     if(!pObCacheMap) {
         AcquireSRWLockExclusive(&InitLockSRW);
         if(!pObCacheMap) {
@@ -241,7 +258,7 @@ POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc)
     }
     // 3: decompress and insert into cache
     if(!(pObData = Ob_Alloc(OB_TAG_CORE_DATA, 0, sizeof(OB) + pdc->cbUncompressed, NULL, NULL))) { return NULL; }
-    if(pObData->ObHdr.cbData != LZ4_decompress_safe(pdc->pbCompressed, pObData->pb, pdc->cbCompressed, pdc->cbUncompressed)) {
+    if(!_ObCompressed_DecompressToBuffer(pdc->usRtlCompressionFormat, pdc->pbCompressed, pdc->cbCompressed, pObData->pb, pdc->cbUncompressed)) {
         Ob_DECREF(pObData);
         return NULL;
     }
@@ -251,7 +268,41 @@ POB_DATA ObCompressed_GetData(_In_opt_ POB_COMPRESSED pdc)
     return pObData;
 }
 
-#endif /* LINUX */
+/*
+* Compress a buffer into a caller supplied buffer. This is a raw buffer helper
+* for callers that manage their own storage (no object is created).
+* -- pb
+* -- cb
+* -- pbOut
+* -- cbOut
+* -- pcbOut = the compressed size on success.
+* -- return = TRUE on success, FALSE on fail or if compressed data exceeds cbOut.
+*/
+_Success_(return)
+BOOL ObCompress_CompressBuffer(_In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_writes_to_(cbOut, *pcbOut) PBYTE pbOut, _In_ DWORD cbOut, _Out_ PDWORD pcbOut, _Out_ PUSHORT pusFormat)
+{
+    return _ObCompressed_CompressToBuffer(pb, cb, pbOut, cbOut, pcbOut, pusFormat);
+}
+
+/*
+* Decompress a buffer compressed with ObCompress_CompressBuffer.
+* -- usFormat
+* -- pbCompressed
+* -- cbCompressed
+* -- pbOut
+* -- cbOut = the exact uncompressed size.
+* -- return
+*/
+_Success_(return)
+BOOL ObCompress_DecompressBuffer(_In_ USHORT usFormat, _In_reads_(cbCompressed) PBYTE pbCompressed, _In_ DWORD cbCompressed, _Out_writes_(cbOut) PBYTE pbOut, _In_ DWORD cbOut)
+{
+    if(usFormat == OB_COMPRESS_FORMAT_NONE) {
+        if(cbCompressed != cbOut) { return FALSE; }
+        memcpy(pbOut, pbCompressed, cbOut);
+        return TRUE;
+    }
+    return _ObCompressed_DecompressToBuffer(usFormat, pbCompressed, cbCompressed, pbOut, cbOut);
+}
 
 /*
 * Object Map object manager cleanup function to be called when reference
@@ -37,6 +37,7 @@ typedef unsigned __int64                    QWORD, *PQWORD;
 #include <time.h>
 #include <unistd.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -69,6 +70,7 @@ typedef DWORD(*PTHREAD_START_ROUTINE)(PVOID);
 typedef DWORD(*LPTHREAD_START_ROUTINE)(PVOID);
 typedef int(*_CoreCrtNonSecureSearchSortCompareFunction)(void const *, void const *);
 #define WINAPI
+#define __forceinline                       inline __attribute__((always_inline))
 #define errno_t                             int
 #define CONST                               const
 #define TRUE                                1
@@ -182,6 +184,8 @@ typedef int(*_CoreCrtNonSecureSearchSortCompareFunction)(void const *, void cons
 #define InterlockedIncrement64(p)           (__sync_add_and_fetch(p, 1))
 #define InterlockedIncrement(p)             (__sync_add_and_fetch_4(p, 1))
 #define InterlockedDecrement(p)             (__sync_sub_and_fetch_4(p, 1))
+#define InterlockedCompareExchange(p, v, c) (__sync_val_compare_and_swap(p, c, v))
+#define MemoryBarrier()                     (__sync_synchronize())
 #define GetCurrentProcess()					((HANDLE)-1)
 #define InetNtopA                           inet_ntop
 #define closesocket(s)                      close(s)
@@ -533,6 +537,8 @@ typedef struct tdSRWLOCK {
 } SRWLOCK, *PSRWLOCK;
 VOID InitializeSRWLock(PSRWLOCK SRWLock);
 VOID AcquireSRWLockExclusive(_Inout_ PSRWLOCK SRWLock);
+BOOL AcquireSRWLockExclusive_Try(_Inout_ PSRWLOCK SRWLock);
+#define TryAcquireSRWLockExclusive  AcquireSRWLockExclusive_Try
 VOID ReleaseSRWLockExclusive(_Inout_ PSRWLOCK SRWLock);
 #define AcquireSRWLockShared    AcquireSRWLockExclusive
 #define ReleaseSRWLockShared    ReleaseSRWLockExclusive
@@ -128,7 +128,10 @@ VOID PageStatUpdate(_In_opt_ PPAGE_STATISTICS pPageStat, _In_ QWORD qwAddr, _In_
 #define STATISTICS_ID_VMMDLL_PdbTypeSize                        0x3a
 #define STATISTICS_ID_VMMDLL_PdbTypeChildOffset                 0x3b
 #define STATISTICS_ID_VMM_PagedCompressedMemory                 0x3c
-#define STATISTICS_ID_MAX                                       0x3c
+#define STATISTICS_ID_VMMDLL_MemReadPin                         0x3d
+#define STATISTICS_ID_VMMDLL_MemVirt2PhysRange                  0x3e
+#define STATISTICS_ID_VMMDLL_MemVirt2PhysBatch                  0x3f
+#define STATISTICS_ID_MAX                                       0x3f
 #define STATISTICS_ID_NOLOG                                     0xffffffff
 
 static LPCSTR STATISTICS_ID_STR[] = {
@@ -193,6 +196,9 @@ static LPCSTR STATISTICS_ID_STR[] = {
     "VMMDLL_PdbTypeSize",
     "VMMDLL_PdbTypeChildOffset",
     "VMM_PagedCompressedMemory",
+    "VMMDLL_MemReadPin",
+    "VMMDLL_MemVirt2PhysRange",
+    "VMMDLL_MemVirt2PhysBatch",
 };
 
 VOID Statistics_CallSetEnabled(_In_ BOOL fEnabled);
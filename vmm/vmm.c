@@ -36,7 +36,29 @@ PVMM_MAIN_CONTEXT ctxMain = NULL;
 // PHYSICAL MEMORY CACHING FOR READS AND PAGE TABLES
 // ----------------------------------------------------------------------------
 
-#define VMM_CACHE_GET_BUCKET(qwA)      ((VMM_CACHE_BUCKETS - 1) & ((qwA >> 12) + 13 * (qwA + _rotr16((WORD)qwA, 9) + _rotr((DWORD)qwA, 17) + _rotr64(qwA, 31))))
+#define VMM_CACHE_GET_HASH(qwA)         (_rotr64(qwA, 12) * 0x9e3779b97f4a7c15)
+#define VMM_CACHE_GET_SHARD(qwHash)     ((DWORD)((qwHash) >> 48) & (VMM_CACHE_SHARDS - 1))
+#define VMM_CACHE_GET_BUCKET(qwHash)    ((DWORD)((qwHash) >> 32) & (VMM_CACHE_SHARD_BUCKETS - 1))
+#define VMM_CACHE_AGE(t, pOb)           ((DWORD)((t)->dwEpoch - (pOb)->dwEpoch))
+#define VMM_CACHE_IS_STALE(t, pOb)      (VMM_CACHE_AGE(t, pOb) >= VMM_CACHE_REGIONS)
+#define VMM_CACHE_MAXAGE_RECENT         0
+#define VMM_CACHE_MAXAGE_DEFAULT        (VMM_CACHE_REGIONS - 1)
+#define VMM_CACHE_MAXAGE_ANY            0xffffffff
+#define VMM_CACHE_MAXAGE(flags)         (((flags) & VMM_FLAG_CACHE_RECENT_ONLY) ? VMM_CACHE_MAXAGE_RECENT : (((flags) & VMM_FLAG_CACHE_STALE_OK) ? VMM_CACHE_MAXAGE_ANY : VMM_CACHE_MAXAGE_DEFAULT))
+#define VMM_CACHE_SEQLOCK_RETRY         4
+#define VMM_CACHE_CHAIN_MAX             0x100
+#define VMM_CACHE_EVICT_BATCH           0x40
+#define VMM_CACHE2_GET_SHARD(qwHash)    ((DWORD)((qwHash) >> 48) & (VMM_CACHE2_SHARDS - 1))
+#define VMM_CACHE2_GET_BUCKET(qwHash)   ((DWORD)((qwHash) >> 32) & (VMM_CACHE2_SHARD_BUCKETS - 1))
+#define VMM_CACHE_DEDUP_STRIPE(h)       ((DWORD)(h) & (VMM_CACHE_DEDUP_STRIPES - 1))
+#define VMM_CACHE_DEDUP_BUCKET(h)       ((DWORD)(h) & (VMM_CACHE_DEDUP_BUCKETS - 1))
+#define VMM_CACHE_DEDUP_SEEN_INDEX(h)   (((DWORD)((h) >> 32) & (VMM_CACHE_DEDUP_SEEN - 1) & ~(VMM_CACHE_DEDUP_STRIPES - 1)) | VMM_CACHE_DEDUP_STRIPE(h))
+#define VMM_CACHE_DEDUP_SAVED(t)        ((DWORD)min((DWORD)max(0, (t)->cDedup), (t)->cMax))
+#define VMM_CACHE_ENTRIES_LIMIT(t)      ((t)->cMax + VMM_CACHE_DEDUP_SAVED(t))
+#define VMM_CACHE_SHARD_LIMIT(t)        ((t)->cShardMax + VMM_CACHE_DEDUP_SAVED(t) / VMM_CACHE_SHARDS)
+
+// shared page data of all cached zero pages - never written to.
+static const BYTE VmmCache_pbZeroPage[0x1000] = { 0 };
 
 /*
 * Retrieve cache table from ctxVmm given a specific tag.
@@ -56,34 +78,514 @@ PVMM_CACHE_TABLE VmmCacheTableGet(_In_ DWORD wTblTag)
 }
 
 /*
-* Clear the oldest region of all InUse entries and make it the new active region.
-* -- wTblTag
+* Unlink an entry from a second tier cache shard - the caller owns the entry.
+* NB! the shard must be exclusively locked.
+* -- s
+* -- pe
 */
-VOID VmmCacheClearPartial(_In_ DWORD dwTblTag)
+VOID VmmCache2_ShardUnlink(_In_ PVMM_CACHE2_SHARD s, _In_ PVMM_CACHE2_ENTRY pe)
+{
+    PVMM_CACHE2_ENTRY *ppe = &s->B[VMM_CACHE2_GET_BUCKET(VMM_CACHE_GET_HASH(pe->qwA))];
+    while(*ppe != pe) {
+        ppe = &(*ppe)->FLink;
+    }
+    *ppe = pe->FLink;
+    if(pe->FifoFLink == pe) {
+        s->pFifo = NULL;
+    } else {
+        pe->FifoBLink->FifoFLink = pe->FifoFLink;
+        pe->FifoFLink->FifoBLink = pe->FifoBLink;
+        if(s->pFifo == pe) {
+            s->pFifo = pe->FifoFLink;
+        }
+    }
+    s->c--;
+    s->cb -= sizeof(VMM_CACHE2_ENTRY) + pe->cb;
+}
+
+/*
+* Remove and free an entry from a second tier cache shard.
+* NB! the shard must be exclusively locked.
+* -- s
+* -- pe
+*/
+VOID VmmCache2_ShardRemove(_In_ PVMM_CACHE2_SHARD s, _In_ PVMM_CACHE2_ENTRY pe)
+{
+    VmmCache2_ShardUnlink(s, pe);
+    LocalFree(pe);
+}
+
+/*
+* Evict the oldest entries of a second tier cache shard until it's below the
+* given size in bytes.
+* NB! the shard must be exclusively locked.
+* -- s
+* -- cbMax
+*/
+VOID VmmCache2_ShardEvict(_In_ PVMM_CACHE2_SHARD s, _In_ QWORD cbMax)
+{
+    while(s->pFifo && (s->cb > cbMax)) {
+        VmmCache2_ShardRemove(s, s->pFifo);
+    }
+}
+
+PVMM_CACHE2_ENTRY VmmCache2_ShardFind(_In_ PVMM_CACHE2_SHARD s, _In_ DWORD iB, _In_ QWORD qwA)
+{
+    PVMM_CACHE2_ENTRY pe = s->B[iB];
+    while(pe && (pe->qwA != qwA)) {
+        pe = pe->FLink;
+    }
+    return pe;
+}
+
+/*
+* Compress a page evicted from the first tier cache into the second tier cache.
+* Pages which have become stale (and may have changed) on a volatile memory
+* device are not kept. Pages which don't compress are kept uncompressed.
+* -- t
+* -- pOb
+*/
+VOID VmmCache2_Put(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    DWORD iB, cb;
+    USHORT usFormat;
+    QWORD qwHash;
+    PVMM_CACHE2_SHARD s;
+    PVMM_CACHE2_ENTRY pe, peDup;
+    BYTE pbBuffer[0x1000];
+    if(!t->C2.fActive || !pOb->h.f || !pOb->pb || (pOb->h.qwA == MEM_SCATTER_ADDR_INVALID)) { return; }
+    if(ctxMain->dev.fVolatile && VMM_CACHE_IS_STALE(t, pOb)) { return; }
+    if(!ObCompress_CompressBuffer(pOb->pb, 0x1000, pbBuffer, 0x1000, &cb, &usFormat) || (cb >= 0x1000)) {
+        cb = 0x1000;
+        usFormat = OB_COMPRESS_FORMAT_NONE;
+    }
+    if(!(pe = LocalAlloc(0, sizeof(VMM_CACHE2_ENTRY) + cb))) { return; }
+    pe->qwA = pOb->h.qwA;
+    pe->dwEpoch = pOb->dwEpoch;
+    pe->cb = cb;
+    pe->usFormat = usFormat;
+    memcpy(pe->pb, (usFormat == OB_COMPRESS_FORMAT_NONE) ? pOb->pb : pbBuffer, cb);
+    qwHash = VMM_CACHE_GET_HASH(pe->qwA);
+    s = &t->C2.S[VMM_CACHE2_GET_SHARD(qwHash)];
+    iB = VMM_CACHE2_GET_BUCKET(qwHash);
+    AcquireSRWLockExclusive(&s->LockSRW);
+    if((peDup = VmmCache2_ShardFind(s, iB, pe->qwA))) {
+        VmmCache2_ShardRemove(s, peDup);
+    }
+    VmmCache2_ShardEvict(s, t->C2.cbShardMax - min(t->C2.cbShardMax, sizeof(VMM_CACHE2_ENTRY) + cb));
+    // insert into bucket chain and as newest entry in fifo
+    pe->FLink = s->B[iB];
+    s->B[iB] = pe;
+    if(s->pFifo) {
+        pe->FifoFLink = s->pFifo;
+        pe->FifoBLink = s->pFifo->FifoBLink;
+        pe->FifoBLink->FifoFLink = pe;
+        s->pFifo->FifoBLink = pe;
+    } else {
+        pe->FifoFLink = pe;
+        pe->FifoBLink = pe;
+        s->pFifo = pe;
+    }
+    s->c++;
+    s->cb += sizeof(VMM_CACHE2_ENTRY) + cb;
+    ReleaseSRWLockExclusive(&s->LockSRW);
+}
+
+/*
+* Retrieve a page from the second tier cache. The page is removed from the
+* second tier cache on success - it's up to the caller to promote it into the
+* first tier cache (with its original epoch).
+* -- t
+* -- qwA
+* -- pbPage = buffer to receive the 0x1000 bytes uncompressed page.
+* -- pdwEpoch = receives the epoch of the page.
+* -- return
+*/
+_Success_(return)
+BOOL VmmCache2_Take(_In_ PVMM_CACHE_TABLE t, _In_ QWORD qwA, _Out_writes_(0x1000) PBYTE pbPage, _Out_ PDWORD pdwEpoch)
+{
+    BOOL f = FALSE;
+    QWORD qwHash;
+    PVMM_CACHE2_SHARD s;
+    PVMM_CACHE2_ENTRY pe;
+    if(!t->C2.fActive) { return FALSE; }
+    qwHash = VMM_CACHE_GET_HASH(qwA);
+    s = &t->C2.S[VMM_CACHE2_GET_SHARD(qwHash)];
+    if(!s->c) { return FALSE; }
+    // 1: find and unlink under the lock - stale entries are left for eviction.
+    AcquireSRWLockExclusive(&s->LockSRW);
+    if((pe = VmmCache2_ShardFind(s, VMM_CACHE2_GET_BUCKET(qwHash), qwA))) {
+        if(ctxMain->dev.fVolatile && VMM_CACHE_IS_STALE(t, pe)) {
+            pe = NULL;
+        } else {
+            VmmCache2_ShardUnlink(s, pe);
+        }
+    }
+    ReleaseSRWLockExclusive(&s->LockSRW);
+    if(!pe) { return FALSE; }
+    // 2: decompress the now privately owned entry without the lock.
+    f = ObCompress_DecompressBuffer(pe->usFormat, pe->pb, pe->cb, pbPage, 0x1000);
+    *pdwEpoch = pe->dwEpoch;
+    LocalFree(pe);
+    if(f) {
+        InterlockedIncrement64((t->tag == VMM_CACHE_TAG_TLB) ? &ctxVmm->stat.cTlbCache2Hit : &ctxVmm->stat.cPhysCache2Hit);
+    }
+    return f;
+}
+
+/*
+* Remove a page from the second tier cache (if exists).
+* -- t
+* -- qwA
+*/
+VOID VmmCache2_Invalidate(_In_ PVMM_CACHE_TABLE t, _In_ QWORD qwA)
+{
+    QWORD qwHash;
+    PVMM_CACHE2_SHARD s;
+    PVMM_CACHE2_ENTRY pe;
+    if(!t->C2.fActive) { return; }
+    qwHash = VMM_CACHE_GET_HASH(qwA);
+    s = &t->C2.S[VMM_CACHE2_GET_SHARD(qwHash)];
+    if(!s->c) { return; }
+    AcquireSRWLockExclusive(&s->LockSRW);
+    if((pe = VmmCache2_ShardFind(s, VMM_CACHE2_GET_BUCKET(qwHash), qwA))) {
+        VmmCache2_ShardRemove(s, pe);
+    }
+    ReleaseSRWLockExclusive(&s->LockSRW);
+}
+
+/*
+* Remove the stale entries of a second tier cache on a volatile memory device.
+* Entries are (mostly) ordered by epoch in the fifo - removal stops at the
+* first non-stale entry.
+* -- t
+*/
+VOID VmmCache2_ClearStale(_In_ PVMM_CACHE_TABLE t)
+{
+    DWORD iS;
+    PVMM_CACHE2_SHARD s;
+    if(!t->C2.fActive || !ctxMain->dev.fVolatile) { return; }
+    for(iS = 0; iS < VMM_CACHE2_SHARDS; iS++) {
+        s = &t->C2.S[iS];
+        if(!s->c) { continue; }
+        AcquireSRWLockExclusive(&s->LockSRW);
+        while(s->pFifo && VMM_CACHE_IS_STALE(t, s->pFifo)) {
+            VmmCache2_ShardRemove(s, s->pFifo);
+        }
+        ReleaseSRWLockExclusive(&s->LockSRW);
+    }
+}
+
+/*
+* Set the max size of a second tier cache - shrink if required.
+* -- t
+* -- cbMax
+*/
+VOID VmmCache2_SetMax(_In_ PVMM_CACHE_TABLE t, _In_ QWORD cbMax)
+{
+    DWORD iS;
+    PVMM_CACHE2_SHARD s;
+    if(!t->C2.fActive) { return; }
+    t->C2.cbShardMax = cbMax / VMM_CACHE2_SHARDS;
+    for(iS = 0; iS < VMM_CACHE2_SHARDS; iS++) {
+        s = &t->C2.S[iS];
+        if(s->cb <= t->C2.cbShardMax) { continue; }
+        AcquireSRWLockExclusive(&s->LockSRW);
+        VmmCache2_ShardEvict(s, t->C2.cbShardMax);
+        ReleaseSRWLockExclusive(&s->LockSRW);
+    }
+}
+
+VOID VmmCache2SetBudget(_In_ DWORD cMB)
+{
+    cMB = cMB ? max(cMB, VMM_CACHE2_BUDGET_MB_MIN) : VMM_CACHE2_BUDGET_MB_DEFAULT;
+    cMB = min(cMB, 0x00100000);
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheBudget);
+    VmmCache2_SetMax(&ctxVmm->Cache.PHYS, (QWORD)cMB << 19);
+    VmmCache2_SetMax(&ctxVmm->Cache.TLB, (QWORD)cMB << 19);
+    ctxVmm->Cache.cMB2 = cMB;
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheBudget);
+}
+
+VOID VmmCache2_Close(_In_ PVMM_CACHE_TABLE t)
+{
+    DWORD iS;
+    PVMM_CACHE2_SHARD s;
+    if(!t->C2.fActive) { return; }
+    t->C2.fActive = FALSE;
+    for(iS = 0; iS < VMM_CACHE2_SHARDS; iS++) {
+        s = &t->C2.S[iS];
+        AcquireSRWLockExclusive(&s->LockSRW);
+        VmmCache2_ShardEvict(s, 0);
+        ReleaseSRWLockExclusive(&s->LockSRW);
+    }
+}
+
+VOID VmmCache2_Initialize(_In_ PVMM_CACHE_TABLE t)
+{
+    DWORD iS;
+    for(iS = 0; iS < VMM_CACHE2_SHARDS; iS++) {
+        InitializeSRWLock(&t->C2.S[iS].LockSRW);
+    }
+    t->C2.cbShardMax = ((QWORD)VMM_CACHE2_BUDGET_MB_DEFAULT << 19) / VMM_CACHE2_SHARDS;
+    t->C2.fActive = TRUE;
+}
+
+/*
+* Remove an entry from its shard bucket chain and CLOCK ring.
+* NB! the shard must be exclusively locked with an odd sequence number. The
+* forward link of the entry is left intact for the benefit of concurrent
+* optimistic readers which may currently be traversing the bucket chain.
+* -- s
+* -- pOb
+*/
+VOID VmmCache_ShardRemove(_In_ PVMM_CACHE_SHARD s, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    // remove from bucket chain
+    if(pOb->FLink) {
+        pOb->FLink->BLink = pOb->BLink;
+    }
+    if(pOb->BLink) {
+        pOb->BLink->FLink = pOb->FLink;
+    } else {
+        s->B[pOb->iB] = pOb->FLink;
+    }
+    // remove from clock ring
+    if(pOb->ClockFLink == pOb) {
+        s->pClockHand = NULL;
+    } else {
+        pOb->ClockBLink->ClockFLink = pOb->ClockFLink;
+        pOb->ClockFLink->ClockBLink = pOb->ClockBLink;
+        if(s->pClockHand == pOb) {
+            s->pClockHand = pOb->ClockFLink;
+        }
+    }
+    s->c--;
+}
+
+/*
+* Insert an entry into its shard bucket chain and into the CLOCK ring just
+* behind the clock hand (i.e. the entry is the last to be considered).
+* NB! the shard must be exclusively locked with an odd sequence number.
+* -- s
+* -- pOb
+*/
+VOID VmmCache_ShardInsert(_In_ PVMM_CACHE_SHARD s, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    // insert into bucket chain
+    pOb->BLink = NULL;
+    pOb->FLink = s->B[pOb->iB];
+    if(pOb->FLink) { pOb->FLink->BLink = pOb; }
+    s->B[pOb->iB] = pOb;
+    // insert into clock ring
+    if(s->pClockHand) {
+        pOb->ClockFLink = s->pClockHand;
+        pOb->ClockBLink = s->pClockHand->ClockBLink;
+        pOb->ClockBLink->ClockFLink = pOb;
+        s->pClockHand->ClockBLink = pOb;
+    } else {
+        pOb->ClockFLink = pOb;
+        pOb->ClockBLink = pOb;
+        s->pClockHand = pOb;
+    }
+    s->c++;
+}
+
+/*
+* Check whether an entry is currently in a shard.
+* NB! the shard must be locked.
+* -- s
+* -- pOb
+* -- return
+*/
+BOOL VmmCache_ShardContains(_In_ PVMM_CACHE_SHARD s, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    PVMMOB_CACHE_MEM pe = s->B[pOb->iB];
+    while(pe && (pe != pOb)) {
+        pe = pe->FLink;
+    }
+    return pe ? TRUE : FALSE;
+}
+
+/*
+* Evict a single entry from a shard using the CLOCK (second chance) algorithm.
+* Stale entries are evicted immediately, recently accessed entries have their
+* accessed bit cleared and are passed by once. The evicted entry still holds
+* the shard reference - it must be completed by VmmCache_EvictComplete once
+* the shard lock is released.
+* NB! the shard must be exclusively locked with an odd sequence number.
+* -- t
+* -- s
+* -- return = the evicted entry, or NULL if no entry was evicted.
+*/
+PVMMOB_CACHE_MEM VmmCache_ShardEvict(_In_ PVMM_CACHE_TABLE t, _In_ PVMM_CACHE_SHARD s)
+{
+    DWORD i, cMax = 2 * s->c + 1;
+    PVMMOB_CACHE_MEM pOb = s->pClockHand;
+    for(i = 0; pOb && (i < cMax); i++) {
+        if(pOb->fAccessed && !VMM_CACHE_IS_STALE(t, pOb)) {
+            pOb->fAccessed = FALSE;
+            pOb = s->pClockHand = pOb->ClockFLink;
+            continue;
+        }
+        VmmCache_ShardRemove(s, pOb);
+        return pOb;
+    }
+    return NULL;
+}
+
+/*
+* Complete the eviction of an entry removed from its shard: keep it in the
+* second tier cache and drop the shard reference. The callback will take care
+* of re-insertion into the empty list when the refcount becomes low enough.
+* NB! must not be called with the shard lock held.
+* -- t
+* -- pOb
+*/
+VOID VmmCache_EvictComplete(_In_ PVMM_CACHE_TABLE t, _In_opt_ PVMMOB_CACHE_MEM pOb)
+{
+    if(!pOb) { return; }
+    VmmCache2_Put(t, pOb);
+    Ob_DECREF(pOb);
+}
+
+/*
+* Remove all stale entries from a shard. Stale entries are collected in
+* batches under the shard lock and completed after the lock is released.
+* -- t
+* -- s
+*/
+VOID VmmCache_ShardClearStale(_In_ PVMM_CACHE_TABLE t, _In_ PVMM_CACHE_SHARD s)
+{
+    DWORD i, c, cEvict;
+    PVMMOB_CACHE_MEM pOb, pObNext, pObEvict[VMM_CACHE_EVICT_BATCH];
+    // NB! unlocked (interlocked) pre-check of s->c is a benign race - an entry
+    //     inserted concurrently is in the current epoch and thus not stale.
+    //     The count is re-read under the shard lock below.
+    if(!InterlockedCompareExchange((volatile LONG*)&s->c, 0, 0)) { return; }
+    do {
+        cEvict = 0;
+        AcquireSRWLockExclusive(&s->LockSRW);
+        InterlockedIncrement(&s->dwSeq);
+        pOb = s->pClockHand;
+        for(i = 0, c = s->c; pOb && (i < c) && (cEvict < VMM_CACHE_EVICT_BATCH); i++) {
+            pObNext = pOb->ClockFLink;
+            if(VMM_CACHE_IS_STALE(t, pOb)) {
+                VmmCache_ShardRemove(s, pOb);
+                pObEvict[cEvict++] = pOb;
+            }
+            pOb = pObNext;
+        }
+        InterlockedIncrement(&s->dwSeq);
+        ReleaseSRWLockExclusive(&s->LockSRW);
+        for(i = 0; i < cEvict; i++) {
+            VmmCache_EvictComplete(t, pObEvict[i]);
+        }
+    } while(cEvict == VMM_CACHE_EVICT_BATCH);
+}
+
+/*
+* Re-validate the recently used entries of a PHYS/TLB cache table which just
+* became stale by re-reading them from the device in a single batch. Entries
+* with unchanged contents are moved into the current generation in-place and
+* changed entries are replaced with the newly read contents.
+* -- t
+*/
+VOID VmmCache_Revalidate(_In_ PVMM_CACHE_TABLE t)
+{
+    DWORD iS, i, c = 0, cUnchanged = 0;
+    PVMM_CACHE_SHARD s;
+    PVMMOB_CACHE_MEM pOb, pObReservedMEM;
+    PPVMMOB_CACHE_MEM ppObMEMs = NULL;
+    PPMEM_SCATTER ppMEMs = NULL;
+    if(!(ppObMEMs = LocalAlloc(0, VMM_CACHE_REVALIDATE_MAX * sizeof(PVMMOB_CACHE_MEM)))) { goto fail; }
+    // 1: collect recently used entries which just became stale.
+    for(iS = 0; (iS < VMM_CACHE_SHARDS) && (c < VMM_CACHE_REVALIDATE_MAX); iS++) {
+        s = &t->S[iS];
+        if(!s->c) { continue; }
+        AcquireSRWLockShared(&s->LockSRW);
+        pOb = s->pClockHand;
+        for(i = 0; pOb && (i < s->c) && (c < VMM_CACHE_REVALIDATE_MAX); i++) {
+            if(pOb->fAccessed && (VMM_CACHE_AGE(t, pOb) == VMM_CACHE_REGIONS)) {
+                Ob_INCREF(pOb);
+                ppObMEMs[c++] = pOb;
+            }
+            pOb = pOb->ClockFLink;
+        }
+        ReleaseSRWLockShared(&s->LockSRW);
+    }
+    if(!c || !LcAllocScatter1(c, &ppMEMs)) { goto fail; }
+    // 2: batch re-read and compare with the cached contents.
+    for(i = 0; i < c; i++) {
+        ppMEMs[i]->qwA = ppObMEMs[i]->h.qwA;
+    }
+    LcReadScatter(ctxMain->hLC, c, ppMEMs);
+    for(i = 0; i < c; i++) {
+        pOb = ppObMEMs[i];
+        if(!ppMEMs[i]->f) { continue; }
+        if(!memcmp(pOb->pb, ppMEMs[i]->pb, 0x1000)) {
+            cUnchanged++;
+            continue;
+        }
+        ppMEMs[i]->f = FALSE;
+        if((t->tag == VMM_CACHE_TAG_TLB) && !VmmTlbPageTableVerify(ppMEMs[i]->pb, ppMEMs[i]->qwA, FALSE)) { continue; }
+        if((pObReservedMEM = VmmCacheReserve(t->tag))) {
+            pObReservedMEM->h.f = TRUE;
+            pObReservedMEM->h.qwA = ppMEMs[i]->qwA;
+            memcpy(pObReservedMEM->h.pb, ppMEMs[i]->pb, 0x1000);
+            VmmCacheReserveReturn(pObReservedMEM);
+        }
+    }
+    // 3: renew the epoch of unchanged entries still in the cache. Entries are
+    //    collected in shard order - lock each shard once as a modification.
+    for(i = 0; i < c; ) {
+        s = &t->S[iS = ppObMEMs[i]->iS];
+        AcquireSRWLockExclusive(&s->LockSRW);
+        InterlockedIncrement(&s->dwSeq);
+        for(; (i < c) && (ppObMEMs[i]->iS == iS); i++) {
+            if(ppMEMs[i]->f && VmmCache_ShardContains(s, ppObMEMs[i])) {
+                ppObMEMs[i]->dwEpoch = t->dwEpoch;
+            }
+        }
+        InterlockedIncrement(&s->dwSeq);
+        ReleaseSRWLockExclusive(&s->LockSRW);
+    }
+    InterlockedAdd64(&ctxVmm->stat.cCacheRevalidate, c);
+    InterlockedAdd64(&ctxVmm->stat.cCacheRevalidateUnchanged, cUnchanged);
+fail:
+    for(i = 0; i < c; i++) {
+        Ob_DECREF(ppObMEMs[i]);
+    }
+    LocalFree(ppObMEMs);
+    LcMemFree(ppMEMs);
+}
+
+/*
+* Start a new refresh generation of a cache table.
+* -- dwTblTag
+* -- fPurge = remove all stale entries from the cache.
+*/
+VOID VmmCache_ClearPartialEx(_In_ DWORD dwTblTag, _In_ BOOL fPurge)
 {
     PVMM_CACHE_TABLE t;
-    PVMMOB_CACHE_MEM pOb;
-    PSLIST_ENTRY e;
-    DWORD iR;
+    DWORD iS;
     PVMM_PROCESS pObProcess = NULL;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || !t->fActive) { return; }
     EnterCriticalSection(&t->Lock);
-    iR = (t->iR + (VMM_CACHE_REGIONS - 1)) % VMM_CACHE_REGIONS;
-    // 1: clear all entries from region
-    AcquireSRWLockExclusive(&t->R[iR].LockSRW);
-    while((e = InterlockedPopEntrySList(&t->R[iR].ListHeadInUse))) {
-        pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListInUse);
-        // remove region refcount of object - callback will take care of
-        // re-insertion into empty list when refcount becomes low enough.
-        Ob_DECREF(pOb);
+    InterlockedIncrement(&t->dwEpoch);
+    if(dwTblTag == VMM_CACHE_TAG_TLB) {
+        InterlockedIncrement(&ctxVmm->Cache.dwTlbGeneration);
+    }
+    if(fPurge) {
+        for(iS = 0; iS < VMM_CACHE_SHARDS; iS++) {
+            VmmCache_ShardClearStale(t, &t->S[iS]);
+        }
     }
-    ZeroMemory(t->R[iR].B, VMM_CACHE_BUCKETS * sizeof(PVMMOB_CACHE_MEM));
-    ReleaseSRWLockExclusive(&t->R[iR].LockSRW);
-    t->iR = iR;
-    t->fAllActiveRegions = t->fAllActiveRegions || (t->iR == 0);
+    VmmCache2_ClearStale(t);
+    t->fAllActiveRegions = t->fAllActiveRegions || (t->dwEpoch >= VMM_CACHE_REGIONS);
     LeaveCriticalSection(&t->Lock);
-    // 2: if tlb cache clear -> update process 'is spider done' flag
+    // if tlb cache clear -> update process 'is spider done' flag
     if(t->fAllActiveRegions && (dwTblTag == VMM_CACHE_TAG_TLB)) {
         while((pObProcess = VmmProcessGetNext(pObProcess, 0))) {
             if(pObProcess->fTlbSpiderDone) {
@@ -95,51 +597,113 @@ VOID VmmCacheClearPartial(_In_ DWORD dwTblTag)
     }
 }
 
-/*
-* Clear the specified cache from all entries.
-* -- dwTblTag
-*/
+VOID VmmCacheClearPartial(_In_ DWORD dwTblTag)
+{
+    PVMM_CACHE_TABLE t;
+    VmmCache_ClearPartialEx(dwTblTag, FALSE);
+    // re-validate recently used entries (if enabled)
+    if(ctxVmm->Cache.fRevalidate && ctxMain->dev.fVolatile && ((dwTblTag == VMM_CACHE_TAG_PHYS) || (dwTblTag == VMM_CACHE_TAG_TLB))) {
+        if((t = VmmCacheTableGet(dwTblTag)) && t->fActive) {
+            VmmCache_Revalidate(t);
+            if(dwTblTag == VMM_CACHE_TAG_TLB) {
+                InterlockedIncrement(&ctxVmm->Cache.dwTlbGeneration);
+            }
+        }
+    }
+}
+
 VOID VmmCacheClear(_In_ DWORD dwTblTag)
 {
     DWORD i;
     for(i = 0; i < VMM_CACHE_REGIONS; i++) {
-        VmmCacheClearPartial(dwTblTag);
+        VmmCache_ClearPartialEx(dwTblTag, (i == VMM_CACHE_REGIONS - 1));
+    }
+}
+
+/*
+* Increase the refcount of a cache entry only if it's currently held by more
+* than the "total list" reference. This prevents optimistic readers from
+* resurrecting an entry which is in the process of being recycled (refcount
+* dropped to one).
+* NB! a refcount of two or more does not mean the entry is live - entries on
+*     the empty list also hold two references. The caller must re-check the
+*     shard sequence and the entry address after the increment and drop the
+*     reference if either changed.
+* -- pOb
+* -- return
+*/
+BOOL VmmCache_TryIncRef(_In_ PVMMOB_CACHE_MEM pOb)
+{
+    DWORD c;
+    while((c = pOb->Ob._count) >= 2) {
+        if(c == (DWORD)InterlockedCompareExchange((volatile LONG*)&pOb->Ob._count, c + 1, c)) {
+            return TRUE;
+        }
     }
+    return FALSE;
 }
 
 /*
 * Retrieve an item from the cache.
+* Lookups are optimistic (seqlock); the shard lock is only taken if the shard
+* is repeatedly modified during the lookup.
 * CALLER DECREF: return
 * -- dwTblTag
 * -- qwA
-* -- fCurrentRegionOnly = only retrieve from the currently active cache region.
+* -- dwMaxAge = max # of refresh generations since the entry was read (VMM_CACHE_MAXAGE_*).
 * -- return
 */
-PVMMOB_CACHE_MEM VmmCacheGetEx(_In_ DWORD dwTblTag, _In_ QWORD qwA, _In_ BOOL fCurrentRegionOnly)
+PVMMOB_CACHE_MEM VmmCacheGetEx(_In_ DWORD dwTblTag, _In_ QWORD qwA, _In_ DWORD dwMaxAge)
 {
     PVMM_CACHE_TABLE t;
-    DWORD iB, iR, iRB, iRC;
+    PVMM_CACHE_SHARD s;
+    QWORD qwHash;
+    DWORD iB, iRetry, iChain, dwSeq;
     PVMMOB_CACHE_MEM pOb;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || !t->fActive) { return NULL; }
-    iB = VMM_CACHE_GET_BUCKET(qwA);
-    iRB = t->iR;
-    for(iRC = 0; iRC < VMM_CACHE_REGIONS; iRC++) {
-        iR = (iRB + iRC) % VMM_CACHE_REGIONS;
-        AcquireSRWLockShared(&t->R[iR].LockSRW);
-        pOb = t->R[iR].B[iB];
-        while(pOb && (pOb->h.qwA != qwA)) {
+    qwHash = VMM_CACHE_GET_HASH(qwA);
+    s = &t->S[VMM_CACHE_GET_SHARD(qwHash)];
+    iB = VMM_CACHE_GET_BUCKET(qwHash);
+    // 1: optimistic lookup
+    for(iRetry = 0; iRetry < VMM_CACHE_SEQLOCK_RETRY; iRetry++) {
+        dwSeq = s->dwSeq;
+        if(dwSeq & 1) {
+            SwitchToThread();
+            continue;
+        }
+        MemoryBarrier();
+        pOb = s->B[iB];
+        for(iChain = 0; pOb && (pOb->h.qwA != qwA) && (iChain < VMM_CACHE_CHAIN_MAX); iChain++) {
             pOb = pOb->FLink;
         }
-        if(pOb) {
-            Ob_INCREF(pOb);
-            ReleaseSRWLockShared(&t->R[iR].LockSRW);
-            return pOb;
+        MemoryBarrier();
+        if((dwSeq != s->dwSeq) || (iChain == VMM_CACHE_CHAIN_MAX)) { continue; }
+        if(!pOb) { return NULL; }
+        if(!VmmCache_TryIncRef(pOb)) { continue; }
+        MemoryBarrier();
+        if((dwSeq != s->dwSeq) || (pOb->h.qwA != qwA)) {
+            Ob_DECREF(pOb);
+            continue;
         }
-        ReleaseSRWLockShared(&t->R[iR].LockSRW);
-        if(fCurrentRegionOnly) { break; }
+        goto finish;
     }
-    return NULL;
+    // 2: locked lookup (fallback on heavy shard contention)
+    AcquireSRWLockShared(&s->LockSRW);
+    pOb = s->B[iB];
+    while(pOb && (pOb->h.qwA != qwA)) {
+        pOb = pOb->FLink;
+    }
+    Ob_INCREF(pOb);
+    ReleaseSRWLockShared(&s->LockSRW);
+    if(!pOb) { return NULL; }
+finish:
+    if(VMM_CACHE_AGE(t, pOb) > dwMaxAge) {
+        Ob_DECREF(pOb);
+        return NULL;
+    }
+    pOb->fAccessed = TRUE;
+    return pOb;
 }
 
 /*
@@ -151,145 +715,690 @@ PVMMOB_CACHE_MEM VmmCacheGetEx(_In_ DWORD dwTblTag, _In_ QWORD qwA, _In_ BOOL fC
 */
 PVMMOB_CACHE_MEM VmmCacheGet(_In_ DWORD dwTblTag, _In_ QWORD qwA)
 {
-    return VmmCacheGetEx(dwTblTag, qwA, FALSE);
+    return VmmCacheGetEx(dwTblTag, qwA, VMM_CACHE_MAXAGE_DEFAULT);
 }
 
 BOOL VmmCacheExists(_In_ DWORD dwTblTag, _In_ QWORD qwA)
 {
     BOOL result;
     PVMMOB_CACHE_MEM pOb;
-    pOb = VmmCacheGetEx(dwTblTag, qwA, FALSE);
+    pOb = VmmCacheGetEx(dwTblTag, qwA, VMM_CACHE_MAXAGE_DEFAULT);
     result = pOb != NULL;
     Ob_DECREF(pOb);
     return result;
 }
 
-VOID VmmCache_CallbackRefCount1(PVMMOB_CACHE_MEM pOb)
+/*
+* Set the max number of entries of a cache table. When shrinking, excess
+* entries are evicted from the shards and surplus entries have their page
+* data released (see VmmCache_CallbackRefCount1).
+* -- t
+* -- cMax
+*/
+VOID VmmCache_SetMax(_In_ PVMM_CACHE_TABLE t, _In_ DWORD cMax)
 {
-    PVMM_CACHE_TABLE t;
-    t = VmmCacheTableGet(((POB)pOb)->_tag);
-    if(!t) {
-        vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
+    DWORD iS, i, cEvict;
+    PVMM_CACHE_SHARD s;
+    PVMMOB_CACHE_MEM pObEvict[VMM_CACHE_EVICT_BATCH];
+    PSLIST_ENTRY e;
+    if(!t->fActive) { return; }
+    cMax = max(cMax, VMM_CACHE_ENTRIES_MIN);
+    EnterCriticalSection(&t->Lock);
+    if(cMax >= t->cMax) {
+        // grow - new entries are allocated on demand.
+        t->cMax = cMax;
+        t->cShardMax = cMax / VMM_CACHE_SHARDS;
+        LeaveCriticalSection(&t->Lock);
         return;
     }
-    if(!t->fActive) { return; }
-    Ob_INCREF(pOb);
-    InterlockedPushEntrySList(&t->R[pOb->iR].ListHeadEmpty, &pOb->SListEmpty);
+    // shrink
+    t->cMax = cMax;
+    t->cShardMax = cMax / VMM_CACHE_SHARDS;
+    for(iS = 0; iS < VMM_CACHE_SHARDS; iS++) {
+        s = &t->S[iS];
+        if(s->c <= VMM_CACHE_SHARD_LIMIT(t)) { continue; }
+        do {
+            cEvict = 0;
+            AcquireSRWLockExclusive(&s->LockSRW);
+            InterlockedIncrement(&s->dwSeq);
+            while((s->c > VMM_CACHE_SHARD_LIMIT(t)) && (cEvict < VMM_CACHE_EVICT_BATCH) && (pObEvict[cEvict] = VmmCache_ShardEvict(t, s))) {
+                cEvict++;
+            }
+            InterlockedIncrement(&s->dwSeq);
+            ReleaseSRWLockExclusive(&s->LockSRW);
+            for(i = 0; i < cEvict; i++) {
+                VmmCache_EvictComplete(t, pObEvict[i]);
+            }
+        } while(cEvict == VMM_CACHE_EVICT_BATCH);
+    }
+    while((t->cTotal > VMM_CACHE_ENTRIES_LIMIT(t)) && (e = InterlockedPopEntrySList(&t->ListHeadEmpty))) {
+        Ob_DECREF(CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListEmpty));
+    }
+    LeaveCriticalSection(&t->Lock);
 }
 
-PVMMOB_CACHE_MEM VmmCacheReserve(_In_ DWORD dwTblTag)
+/*
+* Set the memory budget shared by the PHYS, TLB and PAGING caches. The budget
+* may be changed at runtime - the tables are grown or shrunk accordingly.
+* -- cMB = the budget in MB, 0 = default.
+*/
+VOID VmmCacheSetBudget(_In_ DWORD cMB)
 {
-    PVMM_CACHE_TABLE t;
-    PVMMOB_CACHE_MEM pOb;
-    PSLIST_ENTRY e;
-    WORD cLoopProtect = 0;
-    t = VmmCacheTableGet(dwTblTag);
-    if(!t || !t->fActive) { return NULL; }
-    while(!(e = InterlockedPopEntrySList(&t->R[t->iR].ListHeadEmpty))) {
-        if(QueryDepthSList(&t->R[t->iR].ListHeadTotal) < VMM_CACHE_REGION_MEMS) {
-            // below max threshold -> create new
-            pOb = Ob_Alloc(t->tag, LMEM_ZEROINIT, sizeof(VMMOB_CACHE_MEM), NULL, (OB_CLEANUP_CB)VmmCache_CallbackRefCount1);
-            if(!pOb) { return NULL; }
-            pOb->iR = t->iR;
-            pOb->h.version = MEM_SCATTER_VERSION;
-            pOb->h.cb = 0x1000;
-            pOb->h.pb = pOb->pb;
-            pOb->h.qwA = MEM_SCATTER_ADDR_INVALID;
-            Ob_INCREF(pOb);  // "total list" reference
-            InterlockedPushEntrySList(&t->R[pOb->iR].ListHeadTotal, &pOb->SListTotal);
-            return pOb;         // return fresh object - refcount = 2.
-        }
-        // reclaim existing entries by clearing the oldest cache region.
-        VmmCacheClearPartial(dwTblTag);
-        if(++cLoopProtect == VMM_CACHE_REGIONS) {
-            vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - CACHE %04X DRAINED OF ENTRIES\n", dwTblTag);
-            Sleep(10);
-        }
+    DWORD i, cPages, cPool, cPoolOld, cMax[3];
+    PVMM_CACHE_TABLE t[3] = { &ctxVmm->Cache.PAGING, &ctxVmm->Cache.PHYS, &ctxVmm->Cache.TLB };
+    cMB = cMB ? max(cMB, VMM_CACHE_BUDGET_MB_MIN) : VMM_CACHE_BUDGET_MB_DEFAULT;
+    cMB = min(cMB, 0x00100000);
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheBudget);
+    cPages = cMB << 8;
+    cMax[0] = cPages / 3;
+    // PHYS/TLB share the remainder - keep the current (rebalanced) ratio.
+    cPool = cPages - cMax[0];
+    cPoolOld = t[1]->cMax + t[2]->cMax;
+    cMax[1] = (DWORD)(((QWORD)cPool * t[1]->cMax) / max(1, cPoolOld));
+    cMax[2] = cPool - cMax[1];
+    // shrink tables before growing others to stay within the budget.
+    for(i = 0; i < 3; i++) {
+        if(cMax[i] < t[i]->cMax) { VmmCache_SetMax(t[i], cMax[i]); }
     }
-    pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListEmpty);
-    pOb->h.qwA = MEM_SCATTER_ADDR_INVALID;
-    pOb->h.f = FALSE;
-    return pOb; // reference overtaken by callee (from EmptyList)
+    for(i = 0; i < 3; i++) {
+        if(cMax[i] > t[i]->cMax) { VmmCache_SetMax(t[i], cMax[i]); }
+    }
+    ctxVmm->Cache.cMB = cMB;
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheBudget);
 }
 
 /*
-* Return an entry retrieved with VmmCacheReserve to the cache.
-* NB! no other items may be returned with this function!
-* FUNCTION DECREF: pOb
-* -- pOb
+* Shift budget between the PHYS and TLB caches depending on which of them
+* has had the most misses (device reads) since the last rebalance. Budget is
+* only moved to a table which is currently full; each table retains at least
+* 1/8 of the shared PHYS+TLB budget.
 */
-VOID VmmCacheReserveReturn(_In_opt_ PVMMOB_CACHE_MEM pOb)
+VOID VmmCache_Rebalance()
 {
-    PVMM_CACHE_TABLE t;
-    if(!pOb) { return; }
-    t = VmmCacheTableGet(((POB)pOb)->_tag);
-    if(!t) {
-        vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
-        return;
+    QWORD cMissPHYS, cMissTLB;
+    DWORD cPool, cStep, cFloor;
+    PVMM_CACHE_TABLE tFrom = NULL, tTo = NULL;
+    if(!TryAcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheBudget)) { return; }
+    cMissPHYS = ctxVmm->stat.cPhysReadSuccess + ctxVmm->stat.cPhysReadFail - ctxVmm->stat.cPhysReadFailCacheHit;
+    cMissTLB = ctxVmm->stat.cTlbReadSuccess + ctxVmm->stat.cTlbReadFail;
+    cMissPHYS -= ctxVmm->Cache.cRebalanceMissPHYS;
+    cMissTLB -= ctxVmm->Cache.cRebalanceMissTLB;
+    ctxVmm->Cache.cRebalanceMissPHYS += cMissPHYS;
+    ctxVmm->Cache.cRebalanceMissTLB += cMissTLB;
+    if(cMissPHYS > 2 * cMissTLB) {
+        tFrom = &ctxVmm->Cache.TLB;
+        tTo = &ctxVmm->Cache.PHYS;
+    } else if(cMissTLB > 2 * cMissPHYS) {
+        tFrom = &ctxVmm->Cache.PHYS;
+        tTo = &ctxVmm->Cache.TLB;
     }
-    if(!t->fActive || !pOb->h.f || (pOb->h.qwA == MEM_SCATTER_ADDR_INVALID)) {
-        // decrement refcount of object - callback will take care of
-        // re-insertion into empty list when refcount becomes low enough.
-        Ob_DECREF(pOb);
-        return;
+    if(tFrom && (tTo->cTotal >= tTo->cMax)) {
+        cPool = tFrom->cMax + tTo->cMax;
+        cStep = cPool / 32;
+        cFloor = cPool / 8;
+        if(tFrom->cMax >= cFloor + cStep) {
+            VmmCache_SetMax(tFrom, tFrom->cMax - cStep);
+            VmmCache_SetMax(tTo, tTo->cMax + cStep);
+        }
     }
-    // insert into map - refcount will be overtaken by "cache region".
-    pOb->iB = VMM_CACHE_GET_BUCKET(pOb->h.qwA);
-    AcquireSRWLockExclusive(&t->R[pOb->iR].LockSRW);
-    InterlockedPushEntrySList(&t->R[pOb->iR].ListHeadInUse, &pOb->SListInUse);
-    // insert into "bucket"
-    pOb->BLink = NULL;
-    pOb->FLink = t->R[pOb->iR].B[pOb->iB];
-    if(pOb->FLink) { pOb->FLink->BLink = pOb; }
-    t->R[pOb->iR].B[pOb->iB] = pOb;
-    ReleaseSRWLockExclusive(&t->R[pOb->iR].LockSRW);
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheBudget);
 }
 
-VOID VmmCacheClose(_In_ DWORD dwTblTag)
+/*
+* Allocate VMM_CACHE_ARENA_SIZE bytes of page aligned memory from the OS for
+* use as cache page data. On Linux explicit hugepages are used if configured,
+* otherwise a 2MB aligned range is advised for transparent hugepages.
+* -- return = the memory, or NULL on fail.
+*/
+PBYTE VmmCache_ArenaAllocOs()
 {
-    PVMM_CACHE_TABLE t;
-    PVMMOB_CACHE_MEM pOb;
+#ifdef _WIN32
+    return VirtualAlloc(NULL, VMM_CACHE_ARENA_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#endif /* _WIN32 */
+#ifdef LINUX
+    PBYTE pb, pbAlloc;
+    SIZE_T cbHead;
+    pb = mmap(NULL, VMM_CACHE_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(pb != MAP_FAILED) { return pb; }
+    // no explicit hugepages -> over-allocate and trim to a 2MB aligned range.
+    pbAlloc = mmap(NULL, 2 * VMM_CACHE_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(pbAlloc == MAP_FAILED) { return NULL; }
+    pb = (PBYTE)(((QWORD)pbAlloc + VMM_CACHE_ARENA_SIZE - 1) & ~(QWORD)(VMM_CACHE_ARENA_SIZE - 1));
+    cbHead = pb - pbAlloc;
+    if(cbHead) { munmap(pbAlloc, cbHead); }
+    munmap(pb + VMM_CACHE_ARENA_SIZE, VMM_CACHE_ARENA_SIZE - cbHead);
+    madvise(pb, VMM_CACHE_ARENA_SIZE, MADV_HUGEPAGE);
+    return pb;
+#endif /* LINUX */
+}
+
+VOID VmmCache_ArenaFreeOs(_In_ PBYTE pb)
+{
+#ifdef _WIN32
+    VirtualFree(pb, 0, MEM_RELEASE);
+#endif /* _WIN32 */
+#ifdef LINUX
+    munmap(pb, VMM_CACHE_ARENA_SIZE);
+#endif /* LINUX */
+}
+
+/*
+* Unlink an arena from the circular arena list of a table.
+* NB! t->LockArena must be held.
+*/
+VOID VmmCache_ArenaUnlink(_In_ PVMM_CACHE_TABLE t, _In_ PVMM_CACHE_ARENA pa)
+{
+    if(pa->FLink == pa) {
+        t->pArena = NULL;
+        return;
+    }
+    pa->BLink->FLink = pa->FLink;
+    pa->FLink->BLink = pa->BLink;
+    if(t->pArena == pa) {
+        t->pArena = pa->FLink;
+    }
+}
+
+/*
+* Insert an arena first into the circular arena list of a table.
+* NB! t->LockArena must be held.
+*/
+VOID VmmCache_ArenaInsertFirst(_In_ PVMM_CACHE_TABLE t, _In_ PVMM_CACHE_ARENA pa)
+{
+    if(t->pArena) {
+        pa->FLink = t->pArena;
+        pa->BLink = t->pArena->BLink;
+        pa->BLink->FLink = pa;
+        t->pArena->BLink = pa;
+    } else {
+        pa->FLink = pa;
+        pa->BLink = pa;
+    }
+    t->pArena = pa;
+}
+
+/*
+* Give a cache entry one page of page data carved from the arenas of a table.
+* The arena list is circular with arenas that have free pages first and full
+* arenas last - i.e. a page is always available from the first arena unless
+* all arenas are full.
+* -- t
+* -- pOb
+* -- return
+*/
+BOOL VmmCache_ArenaPageAlloc(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    DWORD i;
+    PVMM_CACHE_ARENA pa;
+    AcquireSRWLockExclusive(&t->LockArena);
+    pa = t->pArena;
+    if(!pa || !pa->cFree) {
+        // all arenas full -> allocate a new arena.
+        if(!(pa = LocalAlloc(0, sizeof(VMM_CACHE_ARENA)))) { goto fail; }
+        if(!(pa->pb = VmmCache_ArenaAllocOs())) {
+            LocalFree(pa);
+            goto fail;
+        }
+        pa->cUsed = 0;
+        pa->cFree = VMM_CACHE_ARENA_PAGES;
+        for(i = 0; i < VMM_CACHE_ARENA_PAGES; i++) {
+            pa->iFree[i] = (WORD)(VMM_CACHE_ARENA_PAGES - 1 - i);
+        }
+        VmmCache_ArenaInsertFirst(t, pa);
+    }
+    i = pa->iFree[--pa->cFree];
+    pa->cUsed++;
+    if(!pa->cFree) {
+        // arena is now full -> rotate it last.
+        t->pArena = pa->FLink;
+    }
+    ReleaseSRWLockExclusive(&t->LockArena);
+    pOb->pArena = pa;
+    pOb->pb = pa->pb + ((SIZE_T)i << 12);
+    return TRUE;
+fail:
+    ReleaseSRWLockExclusive(&t->LockArena);
+    return FALSE;
+}
+
+/*
+* Return the page data of a cache entry to its arena. Arenas without any pages
+* in use are released back to the OS.
+* -- t
+* -- pOb
+*/
+VOID VmmCache_ArenaPageFree(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    PVMM_CACHE_ARENA pa = pOb->pArena;
+    if(!pa) { return; }
+    AcquireSRWLockExclusive(&t->LockArena);
+    pa->iFree[pa->cFree++] = (WORD)((pOb->pb - pa->pb) >> 12);
+    pa->cUsed--;
+    if(!pa->cUsed) {
+        VmmCache_ArenaUnlink(t, pa);
+        VmmCache_ArenaFreeOs(pa->pb);
+        LocalFree(pa);
+    } else if(pa->cFree == 1) {
+        // arena was full -> move it first.
+        VmmCache_ArenaUnlink(t, pa);
+        VmmCache_ArenaInsertFirst(t, pa);
+    }
+    ReleaseSRWLockExclusive(&t->LockArena);
+    pOb->pArena = NULL;
+    pOb->pb = NULL;
+    pOb->h.pb = NULL;
+}
+
+/*
+* Check whether a page is all zeroes. The check is done on 64 byte blocks of
+* QWORDs which the compiler may vectorize.
+* -- pb
+* -- return
+*/
+BOOL VmmCache_DedupIsZeroPage(_In_reads_(0x1000) PBYTE pb)
+{
+    DWORD i;
+    PQWORD pqw = (PQWORD)pb;
+    for(i = 0; i < 0x200; i += 8) {
+        if(pqw[i] | pqw[i + 1] | pqw[i + 2] | pqw[i + 3] | pqw[i + 4] | pqw[i + 5] | pqw[i + 6] | pqw[i + 7]) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+* Hash the contents of a page (four independent multiply-rotate lanes).
+* -- pb
+* -- return
+*/
+QWORD VmmCache_DedupHash(_In_reads_(0x1000) PBYTE pb)
+{
+    DWORD i;
+    PQWORD pqw = (PQWORD)pb;
+    QWORD h0 = 0, h1 = 1, h2 = 2, h3 = 3;
+    for(i = 0; i < 0x200; i += 4) {
+        h0 = _rotl64(h0 ^ pqw[i + 0], 29) * 0x9e3779b97f4a7c15;
+        h1 = _rotl64(h1 ^ pqw[i + 1], 29) * 0x9e3779b97f4a7c15;
+        h2 = _rotl64(h2 ^ pqw[i + 2], 29) * 0x9e3779b97f4a7c15;
+        h3 = _rotl64(h3 ^ pqw[i + 3], 29) * 0x9e3779b97f4a7c15;
+    }
+    return h0 ^ _rotl64(h1, 16) ^ _rotl64(h2, 32) ^ _rotl64(h3, 48);
+}
+
+/*
+* Find shared page data with the given hash and contents.
+* NB! the stripe lock of the hash must be held (shared or exclusive).
+* -- d
+* -- qwHash
+* -- pb
+* -- return
+*/
+PVMM_CACHE_DEDUP_ENTRY VmmCache_DedupFind(_In_ PVMM_CACHE_DEDUP d, _In_ QWORD qwHash, _In_reads_(0x1000) PBYTE pb)
+{
+    PVMM_CACHE_DEDUP_ENTRY pe = d->B[VMM_CACHE_DEDUP_BUCKET(qwHash)];
+    while(pe && ((pe->qwHash != qwHash) || memcmp(pe->pb, pb, 0x1000))) {
+        pe = pe->FLink;
+    }
+    return pe;
+}
+
+/*
+* Share the page data of a PHYS cache entry about to be inserted into the
+* cache. Zero pages are mapped to a single read-only zero page. Pages with
+* contents identical to an already shared page are mapped to its page data;
+* a shared page is created when the same contents (hash) has been seen
+* inserted before. On success the arena page of the entry is released.
+* The zero check and hash are computed before any lock is taken and lookups
+* only take the shared lock of the stripe of the hash.
+* NB! the entry must not be in the cache and must have its own page data.
+* NB! should only be called if page data sharing is enabled.
+* -- t
+* -- pOb
+*/
+VOID VmmCache_Dedup(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    QWORD qwHash;
+    DWORD iStripe, iSeen;
+    PVMM_CACHE_DEDUP d = t->pDedup;
+    PVMM_CACHE_DEDUP_ENTRY pe;
+    // 1: zero page
+    if(VmmCache_DedupIsZeroPage(pOb->pb)) {
+        VmmCache_ArenaPageFree(t, pOb);
+        pOb->pb = pOb->h.pb = (PBYTE)VmmCache_pbZeroPage;
+        InterlockedIncrement(&t->cDedup);
+        InterlockedIncrement64(&ctxVmm->stat.cPhysDedupZero);
+        return;
+    }
+    // 2: duplicate page - lookup of existing shared page data
+    qwHash = VmmCache_DedupHash(pOb->pb);
+    iStripe = VMM_CACHE_DEDUP_STRIPE(qwHash);
+    AcquireSRWLockShared(&d->LockSRW[iStripe]);
+    if((pe = VmmCache_DedupFind(d, qwHash, pOb->pb))) {
+        InterlockedIncrement(&pe->cRef);
+    }
+    ReleaseSRWLockShared(&d->LockSRW[iStripe]);
+    // 3: duplicate page - create shared page data if contents seen before
+    if(!pe) {
+        AcquireSRWLockExclusive(&d->LockSRW[iStripe]);
+        if(!(pe = VmmCache_DedupFind(d, qwHash, pOb->pb))) {
+            iSeen = VMM_CACHE_DEDUP_SEEN_INDEX(qwHash);
+            if((d->qwSeen[iSeen] != qwHash) || !(pe = LocalAlloc(0, sizeof(VMM_CACHE_DEDUP_ENTRY)))) {
+                d->qwSeen[iSeen] = qwHash;
+                ReleaseSRWLockExclusive(&d->LockSRW[iStripe]);
+                return;
+            }
+            // contents seen before -> create shared page data (costs one page).
+            pe->qwHash = qwHash;
+            pe->cRef = 0;
+            memcpy(pe->pb, pOb->pb, 0x1000);
+            pe->FLink = d->B[VMM_CACHE_DEDUP_BUCKET(qwHash)];
+            d->B[VMM_CACHE_DEDUP_BUCKET(qwHash)] = pe;
+            InterlockedDecrement(&t->cDedup);
+        }
+        InterlockedIncrement(&pe->cRef);
+        ReleaseSRWLockExclusive(&d->LockSRW[iStripe]);
+    }
+    VmmCache_ArenaPageFree(t, pOb);
+    pOb->pDedup = pe;
+    pOb->pb = pOb->h.pb = pe->pb;
+    InterlockedIncrement(&t->cDedup);
+    InterlockedIncrement64(&ctxVmm->stat.cPhysDedupShared);
+}
+
+/*
+* Release the shared page data of a cache entry. Shared page data no longer
+* used by any entry is freed.
+* -- t
+* -- pOb
+*/
+VOID VmmCache_DedupRelease(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_CACHE_MEM pOb)
+{
+    PVMM_CACHE_DEDUP d = t->pDedup;
+    PVMM_CACHE_DEDUP_ENTRY pe = pOb->pDedup, *ppe;
+    DWORD iStripe;
+    if(pe) {
+        iStripe = VMM_CACHE_DEDUP_STRIPE(pe->qwHash);
+        AcquireSRWLockExclusive(&d->LockSRW[iStripe]);
+        if(!InterlockedDecrement(&pe->cRef)) {
+            ppe = &d->B[VMM_CACHE_DEDUP_BUCKET(pe->qwHash)];
+            while(*ppe != pe) {
+                ppe = &(*ppe)->FLink;
+            }
+            *ppe = pe->FLink;
+            LocalFree(pe);
+            InterlockedIncrement(&t->cDedup);
+        }
+        ReleaseSRWLockExclusive(&d->LockSRW[iStripe]);
+        pOb->pDedup = NULL;
+    }
+    InterlockedDecrement(&t->cDedup);
+    pOb->pb = NULL;
+    pOb->h.pb = NULL;
+}
+
+VOID VmmCache_CallbackRefCount1(PVMMOB_CACHE_MEM pOb)
+{
+    PVMM_CACHE_TABLE t;
+    t = VmmCacheTableGet(((POB)pOb)->_tag);
+    if(!t) {
+        vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
+        return;
+    }
+    if(!t->fActive) { return; }
+    if(pOb->pb && !pOb->pArena) {
+        // entry with shared page data -> release it and retire the entry, the
+        // entry is given new page data when revived by VmmCache_EntryNew.
+        VmmCache_DedupRelease(t, pOb);
+        InterlockedDecrement(&t->cTotal);
+        InterlockedPushEntrySList(&t->ListHeadRetired, &pOb->SListEmpty);
+        return;
+    }
+    if(t->cTotal > VMM_CACHE_ENTRIES_LIMIT(t)) {
+        // table is above its max size (shrunk) -> retire the entry by freeing
+        // its page data. The entry itself is kept (on the retired list) since
+        // concurrent optimistic readers may still hold a pointer to it.
+        InterlockedDecrement(&t->cTotal);
+        VmmCache_ArenaPageFree(t, pOb);
+        InterlockedPushEntrySList(&t->ListHeadRetired, &pOb->SListEmpty);
+        return;
+    }
+    Ob_INCREF(pOb);
+    InterlockedPushEntrySList(&t->ListHeadEmpty, &pOb->SListEmpty);
+}
+
+/*
+* Create a new entry - or revive a retired entry - and give it page data.
+* NB! caller must already have accounted for the entry in t->cTotal.
+* -- t
+* -- return = the entry with refcount = 2, or NULL on fail.
+*/
+PVMMOB_CACHE_MEM VmmCache_EntryNew(_In_ PVMM_CACHE_TABLE t)
+{
+    PVMMOB_CACHE_MEM pOb;
+    PSLIST_ENTRY e;
+    if((e = InterlockedPopEntrySList(&t->ListHeadRetired))) {
+        pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListEmpty);
+    } else {
+        pOb = Ob_Alloc(t->tag, LMEM_ZEROINIT, sizeof(VMMOB_CACHE_MEM), NULL, (OB_CLEANUP_CB)VmmCache_CallbackRefCount1);
+        if(!pOb) { return NULL; }
+        pOb->h.version = MEM_SCATTER_VERSION;
+        pOb->h.cb = 0x1000;
+        // initial refcount is the "total list" reference.
+        InterlockedPushEntrySList(&t->ListHeadTotal, &pOb->SListTotal);
+    }
+    if(!VmmCache_ArenaPageAlloc(t, pOb)) {
+        InterlockedPushEntrySList(&t->ListHeadRetired, &pOb->SListEmpty);
+        return NULL;
+    }
+    pOb->h.pb = pOb->pb;
+    pOb->h.qwA = MEM_SCATTER_ADDR_INVALID;
+    pOb->h.f = FALSE;
+    pOb->dwReadAheadId = 0;
+    Ob_INCREF(pOb);
+    return pOb;
+}
+
+PVMMOB_CACHE_MEM VmmCacheReserve(_In_ DWORD dwTblTag)
+{
+    PVMM_CACHE_TABLE t;
+    PVMM_CACHE_SHARD s;
+    PVMMOB_CACHE_MEM pOb, pObEvict;
+    PSLIST_ENTRY e;
+    DWORD cLoopProtect = 0;
+    t = VmmCacheTableGet(dwTblTag);
+    if(!t || !t->fActive) { return NULL; }
+    while(!(e = InterlockedPopEntrySList(&t->ListHeadEmpty))) {
+        if(InterlockedIncrement(&t->cTotal) <= VMM_CACHE_ENTRIES_LIMIT(t)) {
+            // below max threshold -> create new
+            if(!(pOb = VmmCache_EntryNew(t))) {
+                InterlockedDecrement(&t->cTotal);
+            }
+            return pOb;         // return fresh object - refcount = 2.
+        }
+        InterlockedDecrement(&t->cTotal);
+        // reclaim an existing entry by evicting it from a round-robin shard.
+        s = &t->S[InterlockedIncrement(&t->iShardEvict) & (VMM_CACHE_SHARDS - 1)];
+        AcquireSRWLockExclusive(&s->LockSRW);
+        InterlockedIncrement(&s->dwSeq);
+        pObEvict = VmmCache_ShardEvict(t, s);
+        InterlockedIncrement(&s->dwSeq);
+        ReleaseSRWLockExclusive(&s->LockSRW);
+        VmmCache_EvictComplete(t, pObEvict);
+        // a full table under pressure -> (occasionally) rebalance the budget.
+        if(!(InterlockedIncrement(&ctxVmm->Cache.cEvictForced) & 0xfff)) {
+            VmmCache_Rebalance();
+        }
+        if(++cLoopProtect == 4 * VMM_CACHE_SHARDS) {
+            vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - CACHE %04X DRAINED OF ENTRIES\n", dwTblTag);
+            cLoopProtect = 0;
+            Sleep(10);
+        }
+    }
+    pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListEmpty);
+    pOb->h.qwA = MEM_SCATTER_ADDR_INVALID;
+    pOb->h.f = FALSE;
+    pOb->dwReadAheadId = 0;
+    return pOb; // reference overtaken by callee (from EmptyList)
+}
+
+/*
+* Return an entry retrieved with VmmCacheReserve to the cache.
+* NB! no other items may be returned with this function!
+* FUNCTION DECREF: pOb
+* -- pOb
+* -- fKeepEpoch = keep the epoch already set in pOb (page promoted from the
+*                 second tier cache) instead of the current epoch.
+*/
+VOID VmmCache_ReserveReturnEx(_In_opt_ PVMMOB_CACHE_MEM pOb, _In_ BOOL fKeepEpoch)
+{
+    QWORD qwHash;
+    PVMM_CACHE_TABLE t;
+    PVMM_CACHE_SHARD s;
+    PVMMOB_CACHE_MEM pObDup, pObEvict = NULL;
+    if(!pOb) { return; }
+    t = VmmCacheTableGet(((POB)pOb)->_tag);
+    if(!t) {
+        vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
+        return;
+    }
+    if(!t->fActive || !pOb->h.f || (pOb->h.qwA == MEM_SCATTER_ADDR_INVALID)) {
+        // decrement refcount of object - callback will take care of
+        // re-insertion into empty list when refcount becomes low enough.
+        Ob_DECREF(pOb);
+        return;
+    }
+    if(t->pDedup && pOb->pArena && ctxVmm->Cache.fDedup) {
+        VmmCache_Dedup(t, pOb);
+    }
+    // insert into shard - refcount will be overtaken by "cache shard".
+    qwHash = VMM_CACHE_GET_HASH(pOb->h.qwA);
+    pOb->iS = VMM_CACHE_GET_SHARD(qwHash);
+    pOb->iB = VMM_CACHE_GET_BUCKET(qwHash);
+    if(!fKeepEpoch) {
+        pOb->dwEpoch = t->dwEpoch;
+    }
+    pOb->fAccessed = FALSE;
+    s = &t->S[pOb->iS];
+    AcquireSRWLockExclusive(&s->LockSRW);
+    InterlockedIncrement(&s->dwSeq);
+    // replace any existing (older) entry of the same address
+    pObDup = s->B[pOb->iB];
+    while(pObDup && (pObDup->h.qwA != pOb->h.qwA)) {
+        pObDup = pObDup->FLink;
+    }
+    if(pObDup) {
+        VmmCache_ShardRemove(s, pObDup);
+    }
+    // evict (if required) and insert
+    if(s->c >= VMM_CACHE_SHARD_LIMIT(t)) {
+        pObEvict = VmmCache_ShardEvict(t, s);
+    }
+    VmmCache_ShardInsert(s, pOb);
+    InterlockedIncrement(&s->dwSeq);
+    ReleaseSRWLockExclusive(&s->LockSRW);
+    Ob_DECREF(pObDup);
+    VmmCache_EvictComplete(t, pObEvict);
+}
+
+/*
+* Return an entry retrieved with VmmCacheReserve to the cache.
+* NB! no other items may be returned with this function!
+* FUNCTION DECREF: pOb
+* -- pOb
+*/
+VOID VmmCacheReserveReturn(_In_opt_ PVMMOB_CACHE_MEM pOb)
+{
+    VmmCache_ReserveReturnEx(pOb, FALSE);
+}
+
+VOID VmmCacheClose(_In_ DWORD dwTblTag)
+{
+    PVMM_CACHE_TABLE t;
+    PVMM_CACHE_SHARD s;
+    PVMM_CACHE_ARENA pa;
+    PVMM_CACHE_DEDUP_ENTRY pe;
+    PVMMOB_CACHE_MEM pOb;
     PSLIST_ENTRY e;
-    DWORD iR;
+    DWORD iS, i;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || !t->fActive) { return; }
     t->fActive = FALSE;
+    VmmCache2_Close(t);
     EnterCriticalSection(&t->Lock);
-    for(iR = 0; iR < VMM_CACHE_REGIONS; iR++) {
-        AcquireSRWLockExclusive(&t->R[iR].LockSRW);
-        // remove from "empty list"
-        while((e = InterlockedPopEntrySList(&t->R[iR].ListHeadEmpty))) {
-            pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListEmpty);
-            Ob_DECREF(pOb);
-        }
-        // remove from "in use list"
-        while((e = InterlockedPopEntrySList(&t->R[iR].ListHeadInUse))) {
-            pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListInUse);
+    // remove from "shards"
+    for(iS = 0; iS < VMM_CACHE_SHARDS; iS++) {
+        s = &t->S[iS];
+        AcquireSRWLockExclusive(&s->LockSRW);
+        InterlockedIncrement(&s->dwSeq);
+        while((pOb = s->pClockHand)) {
+            VmmCache_ShardRemove(s, pOb);
             Ob_DECREF(pOb);
         }
-        // remove from "total list"
-        while((e = InterlockedPopEntrySList(&t->R[iR].ListHeadTotal))) {
-            pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListTotal);
-            Ob_DECREF(pOb);
+        InterlockedIncrement(&s->dwSeq);
+        ReleaseSRWLockExclusive(&s->LockSRW);
+    }
+    // remove from "empty list"
+    while((e = InterlockedPopEntrySList(&t->ListHeadEmpty))) {
+        pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListEmpty);
+        Ob_DECREF(pOb);
+    }
+    // remove from "total list" (retired entries are only on this list). The
+    // page data is released in bulk with the arenas below; entries still in
+    // use (pinned) by external callers are detached from their page data.
+    while((e = InterlockedPopEntrySList(&t->ListHeadTotal))) {
+        pOb = CONTAINING_RECORD(e, VMMOB_CACHE_MEM, SListTotal);
+        pOb->pArena = NULL;
+        Ob_DECREF(pOb);
+    }
+    // release arenas
+    while((pa = t->pArena)) {
+        VmmCache_ArenaUnlink(t, pa);
+        VmmCache_ArenaFreeOs(pa->pb);
+        LocalFree(pa);
+    }
+    // release shared page data
+    if(t->pDedup) {
+        for(i = 0; i < VMM_CACHE_DEDUP_BUCKETS; i++) {
+            while((pe = t->pDedup->B[i])) {
+                t->pDedup->B[i] = pe->FLink;
+                LocalFree(pe);
+            }
         }
+        LocalFree(t->pDedup);
+        t->pDedup = NULL;
     }
+    LeaveCriticalSection(&t->Lock);
     DeleteCriticalSection(&t->Lock);
 }
 
 VOID VmmCacheInitialize(_In_ DWORD dwTblTag)
 {
-    DWORD iR;
+    DWORD iS;
     PVMM_CACHE_TABLE t;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || t->fActive) { return; }
-    for(iR = 0; iR < VMM_CACHE_REGIONS; iR++) {
-        InitializeSRWLock(&t->R[iR].LockSRW);
-        InitializeSListHead(&t->R[iR].ListHeadEmpty);
-        InitializeSListHead(&t->R[iR].ListHeadInUse);
-        InitializeSListHead(&t->R[iR].ListHeadTotal);
+    for(iS = 0; iS < VMM_CACHE_SHARDS; iS++) {
+        InitializeSRWLock(&t->S[iS].LockSRW);
     }
+    InitializeSListHead(&t->ListHeadEmpty);
+    InitializeSListHead(&t->ListHeadRetired);
+    InitializeSListHead(&t->ListHeadTotal);
+    InitializeSRWLock(&t->LockArena);
     InitializeCriticalSection(&t->Lock);
+    t->cMax = VMM_CACHE_ENTRIES_MAX;
+    t->cShardMax = VMM_CACHE_ENTRIES_MAX / VMM_CACHE_SHARDS;
     t->tag = dwTblTag;
+    if((dwTblTag == VMM_CACHE_TAG_PHYS) || (dwTblTag == VMM_CACHE_TAG_TLB)) {
+        VmmCache2_Initialize(t);
+    }
+    if(dwTblTag == VMM_CACHE_TAG_PHYS) {
+        if((t->pDedup = LocalAlloc(LMEM_ZEROINIT, sizeof(VMM_CACHE_DEDUP)))) {
+            for(iS = 0; iS < VMM_CACHE_DEDUP_STRIPES; iS++) {
+                InitializeSRWLock(&t->pDedup->LockSRW[iS]);
+            }
+        }
+    }
     t->fActive = TRUE;
 }
 
@@ -298,26 +1407,30 @@ VOID VmmCacheInitialize(_In_ DWORD dwTblTag)
 */
 VOID VmmCacheInvalidate_2(_In_ DWORD dwTblTag, _In_ QWORD qwA)
 {
+    QWORD qwHash;
     PVMM_CACHE_TABLE t;
+    PVMM_CACHE_SHARD s;
     PVMMOB_CACHE_MEM pOb;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || !t->fActive) { return; }
-    while((pOb = VmmCacheGet(dwTblTag, qwA))) {
-        AcquireSRWLockExclusive(&t->R[pOb->iR].LockSRW);
-        // remove from bucket list
-        if(pOb->FLink) {
-            pOb->FLink->BLink = pOb->BLink;
-        }
-        if(pOb->BLink) {
-            pOb->BLink->FLink = pOb->FLink;
-        } else {
-            t->R[pOb->iR].B[pOb->iB] = pOb->FLink;
-        }
-        // NB! "leak" object - i.e. keep it on InUse list until the cache
-        //     region itself gets cleared. somewhat ugly, but simple...
-        ReleaseSRWLockExclusive(&t->R[pOb->iR].LockSRW);
+    qwHash = VMM_CACHE_GET_HASH(qwA);
+    s = &t->S[VMM_CACHE_GET_SHARD(qwHash)];
+    AcquireSRWLockExclusive(&s->LockSRW);
+    InterlockedIncrement(&s->dwSeq);
+    pOb = s->B[VMM_CACHE_GET_BUCKET(qwHash)];
+    while(pOb && (pOb->h.qwA != qwA)) {
+        pOb = pOb->FLink;
+    }
+    if(pOb) {
+        VmmCache_ShardRemove(s, pOb);
         Ob_DECREF(pOb);
     }
+    InterlockedIncrement(&s->dwSeq);
+    ReleaseSRWLockExclusive(&s->LockSRW);
+    VmmCache2_Invalidate(t, qwA);
+    if(dwTblTag == VMM_CACHE_TAG_TLB) {
+        InterlockedIncrement(&ctxVmm->Cache.dwTlbGeneration);
+    }
 }
 
 VOID VmmCacheInvalidate(_In_ QWORD pa)
@@ -326,12 +1439,196 @@ VOID VmmCacheInvalidate(_In_ QWORD pa)
     VmmCacheInvalidate_2(VMM_CACHE_TAG_PHYS, pa);
 }
 
+/*
+* Find the index of the first failed physical range ending after pa.
+* NB! ctxVmm->LockSRW.CacheFail must be held.
+*/
+DWORD VmmCacheFail_Index(_In_ QWORD pa)
+{
+    DWORD iLo = 0, iHi = ctxVmm->Cache.PHYS_FAILED.c, i;
+    while(iLo < iHi) {
+        i = (iLo + iHi) >> 1;
+        if(ctxVmm->Cache.PHYS_FAILED.E[i].paEnd <= pa) {
+            iLo = i + 1;
+        } else {
+            iHi = i;
+        }
+    }
+    return iLo;
+}
+
+/*
+* Check whether a physical page is known to fail to read.
+* -- pa
+* -- return
+*/
+BOOL VmmCacheFail_Exists(_In_ QWORD pa)
+{
+    BOOL f;
+    DWORD i;
+    if(!ctxVmm->Cache.PHYS_FAILED.c) { return FALSE; }
+    pa &= ~0xfff;
+    AcquireSRWLockShared(&ctxVmm->LockSRW.CacheFail);
+    i = VmmCacheFail_Index(pa);
+    f = (i < ctxVmm->Cache.PHYS_FAILED.c) && (ctxVmm->Cache.PHYS_FAILED.E[i].pa <= pa);
+    ReleaseSRWLockShared(&ctxVmm->LockSRW.CacheFail);
+    return f;
+}
+
+/*
+* Add a physical page which failed to read to the negative cache. Adjacent
+* pages are merged into ranges. If the max number of ranges is reached the
+* page is not added.
+* -- pa
+*/
+VOID VmmCacheFail_Add(_In_ QWORD pa)
+{
+    DWORD i, c;
+    PVMM_CACHE_FAIL_EXTENT pe = ctxVmm->Cache.PHYS_FAILED.E;
+    pa &= ~0xfff;
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheFail);
+    c = ctxVmm->Cache.PHYS_FAILED.c;
+    i = VmmCacheFail_Index(pa);
+    if((i < c) && (pe[i].pa <= pa)) {
+        // already exists
+    } else if(i && (pe[i - 1].paEnd == pa)) {
+        // extend previous range (and merge with next range if adjacent)
+        pe[i - 1].paEnd = pa + 0x1000;
+        if((i < c) && (pe[i].pa == pa + 0x1000)) {
+            pe[i - 1].paEnd = pe[i].paEnd;
+            memmove(pe + i, pe + i + 1, (c - i - 1) * sizeof(VMM_CACHE_FAIL_EXTENT));
+            ctxVmm->Cache.PHYS_FAILED.c = c - 1;
+        }
+    } else if((i < c) && (pe[i].pa == pa + 0x1000)) {
+        // extend next range
+        pe[i].pa = pa;
+    } else if(c < VMM_CACHE_FAIL_EXTENTS_MAX) {
+        // insert new range
+        memmove(pe + i + 1, pe + i, (c - i) * sizeof(VMM_CACHE_FAIL_EXTENT));
+        pe[i].pa = pa;
+        pe[i].paEnd = pa + 0x1000;
+        ctxVmm->Cache.PHYS_FAILED.c = c + 1;
+    }
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheFail);
+}
+
+VOID VmmCacheFailClear()
+{
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheFail);
+    ctxVmm->Cache.PHYS_FAILED.c = 0;
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheFail);
+}
+
+/*
+* Register a device read of a page missing in the cache. If the page is not
+* already being read the caller becomes the owner of the read and must call
+* VmmCacheInflight_End once the read page is put into the cache. If the page
+* is currently being read by another thread the caller becomes a waiter and
+* must call VmmCacheInflight_Wait - and then retrieve the page from the cache.
+* NB! an owner must end all its reads before it waits for any other reads.
+* -- dwTag
+* -- qwA
+* -- pfWait = receives TRUE if the caller is a waiter.
+* -- return = the in-flight slot, or VMM_CACHE_INFLIGHT_NONE if not tracked.
+*/
+DWORD VmmCacheInflight_Begin(_In_ DWORD dwTag, _In_ QWORD qwA, _Out_ PBOOL pfWait)
+{
+    DWORD iSlot;
+    PVMM_CACHE_INFLIGHT pe;
+    *pfWait = FALSE;
+    iSlot = (DWORD)(VMM_CACHE_GET_HASH(qwA) >> 40) & (VMM_CACHE_INFLIGHT_SLOTS - 1);
+    pe = &ctxVmm->Cache.INFLIGHT[iSlot];
+    if(!pe->hEvent) { return VMM_CACHE_INFLIGHT_NONE; }
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheInflight);
+    if(!pe->cRef) {
+        pe->qwA = qwA;
+        pe->dwTag = dwTag;
+        pe->cRef = 1;
+        pe->fDone = FALSE;
+        ResetEvent(pe->hEvent);
+    } else if((pe->qwA == qwA) && (pe->dwTag == dwTag)) {
+        pe->cRef++;
+        *pfWait = TRUE;
+    } else {
+        // slot in use by another page -> not tracked.
+        iSlot = VMM_CACHE_INFLIGHT_NONE;
+    }
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheInflight);
+    return iSlot;
+}
+
+/*
+* Complete a device read registered with VmmCacheInflight_Begin (owner).
+* -- iSlot
+*/
+VOID VmmCacheInflight_End(_In_ DWORD iSlot)
+{
+    PVMM_CACHE_INFLIGHT pe;
+    if(iSlot == VMM_CACHE_INFLIGHT_NONE) { return; }
+    pe = &ctxVmm->Cache.INFLIGHT[iSlot];
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheInflight);
+    pe->fDone = TRUE;
+    SetEvent(pe->hEvent);
+    pe->cRef--;
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheInflight);
+}
+
+/*
+* Wait for a device read registered by another thread to complete (waiter).
+* -- iSlot
+*/
+VOID VmmCacheInflight_Wait(_In_ DWORD iSlot)
+{
+    PVMM_CACHE_INFLIGHT pe = &ctxVmm->Cache.INFLIGHT[iSlot];
+    if(!pe->fDone) {
+        WaitForSingleObject(pe->hEvent, INFINITE);
+    }
+    AcquireSRWLockExclusive(&ctxVmm->LockSRW.CacheInflight);
+    pe->cRef--;
+    ReleaseSRWLockExclusive(&ctxVmm->LockSRW.CacheInflight);
+}
+
+VOID VmmCacheInflight_Close()
+{
+    DWORD i;
+    for(i = 0; i < VMM_CACHE_INFLIGHT_SLOTS; i++) {
+        if(ctxVmm->Cache.INFLIGHT[i].hEvent) {
+            CloseHandle(ctxVmm->Cache.INFLIGHT[i].hEvent);
+            ctxVmm->Cache.INFLIGHT[i].hEvent = NULL;
+        }
+    }
+}
+
+VOID VmmCacheInflight_Initialize()
+{
+    DWORD i;
+    for(i = 0; i < VMM_CACHE_INFLIGHT_SLOTS; i++) {
+        ctxVmm->Cache.INFLIGHT[i].hEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+    }
+}
+
 PVMMOB_CACHE_MEM VmmCacheGet_FromDeviceOnMiss(_In_ DWORD dwTblTag, _In_ DWORD dwTblTagSecondaryOpt, _In_ QWORD qwA)
 {
+    BOOL fCache2 = FALSE, fWait;
+    DWORD iSlot;
     PVMMOB_CACHE_MEM pObMEM, pObReservedMEM;
     PMEM_SCATTER pMEM;
     pObMEM = VmmCacheGet(dwTblTag, qwA);
     if(pObMEM) { return pObMEM; }
+    // wait for a concurrent read of the same page (if any)
+    iSlot = VmmCacheInflight_Begin(dwTblTag, qwA, &fWait);
+    if(fWait) {
+        VmmCacheInflight_Wait(iSlot);
+        if((pObMEM = VmmCacheGet(dwTblTag, qwA))) {
+            InterlockedIncrement64(&ctxVmm->stat.cCacheMissCoalesced);
+            return pObMEM;
+        }
+        iSlot = VMM_CACHE_INFLIGHT_NONE;
+    }
+    if(VmmCacheFail_Exists(qwA)) {
+        VmmCacheInflight_End(iSlot);
+        return NULL;
+    }
     if((pObReservedMEM = VmmCacheReserve(dwTblTag))) {
         pMEM = &pObReservedMEM->h;
         pMEM->qwA = qwA;
@@ -341,84 +1638,465 @@ PVMMOB_CACHE_MEM VmmCacheGet_FromDeviceOnMiss(_In_ DWORD dwTblTag, _In_ DWORD dw
             Ob_DECREF(pObMEM);
             pObMEM = NULL;
         }
-        if(!pMEM->f) {
-            LcReadScatter(ctxMain->hLC, 1, &pMEM);
+        if(!pMEM->f && VmmCache2_Take(VmmCacheTableGet(dwTblTag), qwA, pMEM->pb, &pObReservedMEM->dwEpoch)) {
+            pMEM->f = TRUE;
+            fCache2 = TRUE;
+        }
+        if(!pMEM->f) {
+            LcReadScatter(ctxMain->hLC, 1, &pMEM);
+        }
+        if(pMEM->f) {
+            Ob_INCREF(pObReservedMEM);
+            VmmCache_ReserveReturnEx(pObReservedMEM, fCache2);
+            VmmCacheInflight_End(iSlot);
+            return pObReservedMEM;
+        }
+        VmmCacheFail_Add(qwA);
+        VmmCacheReserveReturn(pObReservedMEM);
+    }
+    VmmCacheInflight_End(iSlot);
+    return NULL;
+}
+
+/*
+* Retrieve a page table from a given physical address (if possible).
+* CALLER DECREF: return
+* -- pa
+* -- fCacheOnly
+* -- return = Cache entry on success, NULL on fail.
+*/
+PVMMOB_CACHE_MEM VmmTlbGetPageTable(_In_ QWORD pa, _In_ BOOL fCacheOnly)
+{
+    PVMMOB_CACHE_MEM pObMEM;
+    pObMEM = VmmCacheGet(VMM_CACHE_TAG_TLB, pa);
+    if(pObMEM) {
+        InterlockedIncrement64(&ctxVmm->stat.cTlbCacheHit);
+        return pObMEM;
+    }
+    if(fCacheOnly) { return NULL; }
+    // try retrieve from (1) TLB cache, (2) PHYS cache, (3) device
+    pObMEM = VmmCacheGet_FromDeviceOnMiss(VMM_CACHE_TAG_TLB, VMM_CACHE_TAG_PHYS, pa);
+    if(!pObMEM) {
+        InterlockedIncrement64(&ctxVmm->stat.cTlbReadFail);
+        return NULL;
+    }
+    InterlockedIncrement64(&ctxVmm->stat.cTlbReadSuccess);
+    if(VmmTlbPageTableVerify(pObMEM->h.pb, pObMEM->h.qwA, FALSE)) {
+        return pObMEM;
+    }
+    Ob_DECREF(pObMEM);
+    return NULL;
+}
+
+/*
+* Translate a virtual address to a physical address by walking the page tables.
+* The successfully translated Physical Address (PA) is returned in ppa.
+* Upon fail the PTE will be returned in ppa (if possible) - which may be used
+* to further lookup virtual memory in case of PageFile or Win10 MemCompression.
+* -- paDTB
+* -- fUserOnly
+* -- va
+* -- ppa
+* -- return
+*/
+_Success_(return)
+BOOL VmmVirt2PhysEx(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    *ppa = 0;
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return FALSE; }
+    return ctxVmm->fnMemoryModel.pfnVirt2Phys(paDTB, fUserOnly, -1, va, ppa, NULL);
+}
+
+/*
+* Calculate the check value of a software tlb entry. The check value binds the
+* entry to its va page, its data, the DTB and the current TLB generation - a
+* torn or outdated entry will fail the check.
+* -- paDTB
+* -- fUserOnly
+* -- vaPage = va >> page shift.
+* -- qwData
+* -- dwGeneration = TLB generation (ctxVmm->Cache.dwTlbGeneration).
+* -- return
+*/
+QWORD VmmVirt2Phys_TlbCheck(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD vaPage, _In_ QWORD qwData, _In_ DWORD dwGeneration)
+{
+    QWORD h;
+    h = vaPage ^ _rotl64(qwData, 23) ^ _rotl64(paDTB, 41) ^ ((QWORD)dwGeneration << 1) ^ (fUserOnly ? 1 : 0);
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccd;
+    h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53;
+    return h ^ (h >> 33);
+}
+
+/*
+* Look up a translation in a software tlb.
+* -- pTlb
+* -- paDTB
+* -- fUserOnly
+* -- va
+* -- ppa
+* -- pbPageShift = optional page shift of the translation (12 = 4kB, 21 = 2MB, ...).
+* -- return
+*/
+_Success_(return)
+BOOL VmmVirt2Phys_TlbGet(_In_ PVMM_PROCESS_TLB pTlb, _In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift)
+{
+    QWORD qwCheck, qwData, qwMask;
+    PVMM_PROCESS_TLB_ENTRY pe;
+    BYTE iShift;
+    DWORD dwGeneration = ctxVmm->Cache.dwTlbGeneration;
+    // 4kB page:
+    pe = &pTlb->E[(va >> 12) & (VMM_PROCESS_TLB_ENTRIES - 1)];
+    qwCheck = *(volatile QWORD*)&pe->qwCheck;
+    qwData = *(volatile QWORD*)&pe->qwData;
+    if(qwCheck != VmmVirt2Phys_TlbCheck(paDTB, fUserOnly, va >> 12, qwData, dwGeneration)) {
+        // large page:
+        pe = &pTlb->L[(va >> 21) & (VMM_PROCESS_TLB_ENTRIES_LARGE - 1)];
+        qwCheck = *(volatile QWORD*)&pe->qwCheck;
+        qwData = *(volatile QWORD*)&pe->qwData;
+        iShift = (BYTE)(qwData & 0x3f);
+        if((iShift < 21) || (qwCheck != VmmVirt2Phys_TlbCheck(paDTB, fUserOnly, va >> iShift, qwData, dwGeneration))) { return FALSE; }
+    }
+    qwMask = (1ULL << (qwData & 0x3f)) - 1;
+    *ppa = (qwData & ~0xfffULL) | (va & qwMask);
+    if(pbPageShift) { *pbPageShift = (BYTE)(qwData & 0x3f); }
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) {
+        *ppa &= ~0xfffULL;                                  // X86 RETURNS PAGE ALIGNED ADDRESSES
+    }
+    return TRUE;
+}
+
+/*
+* Insert a successful translation into a software tlb.
+* -- pTlb
+* -- paDTB
+* -- fUserOnly
+* -- va
+* -- pa
+* -- iShift = page shift of the translation (12 = 4kB, 21 = 2MB, ...).
+* -- dwGeneration = TLB generation sampled before the page table walk.
+*/
+VOID VmmVirt2Phys_TlbPut(_In_ PVMM_PROCESS_TLB pTlb, _In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _In_ QWORD pa, _In_ BYTE iShift, _In_ DWORD dwGeneration)
+{
+    QWORD qwData;
+    PVMM_PROCESS_TLB_ENTRY pe;
+    if((iShift < 12) || (iShift > 63)) { return; }
+    if(dwGeneration != ctxVmm->Cache.dwTlbGeneration) { return; }   // page tables changed during walk
+    qwData = (pa & ~((1ULL << iShift) - 1)) | iShift;
+    pe = (iShift == 12) ?
+        &pTlb->E[(va >> 12) & (VMM_PROCESS_TLB_ENTRIES - 1)] :
+        &pTlb->L[(va >> 21) & (VMM_PROCESS_TLB_ENTRIES_LARGE - 1)];
+    *(volatile QWORD*)&pe->qwData = qwData;
+    *(volatile QWORD*)&pe->qwCheck = VmmVirt2Phys_TlbCheck(paDTB, fUserOnly, va >> iShift, qwData, dwGeneration);
+}
+
+/*
+* Check whether the x64 PML4 entry mapping a kernel address of a process is
+* identical to the PML4 entry of the kernel DTB. If so the whole 512GB slot is
+* translated by the kernel page tables and may use the shared kernel tlb. The
+* result is remembered per slot in the process until the TLB generation moves.
+* -- pProcess
+* -- va
+* -- return
+*/
+BOOL VmmVirt2Phys_IsKernelShared(_In_ PVMM_PROCESS pProcess, _In_ QWORD va)
+{
+    BOOL fShared = FALSE;
+    DWORD iSlot, dwState, dwGeneration;
+    PVMMOB_CACHE_MEM pObPML4 = NULL, pObPML4K = NULL;
+    if((ctxVmm->tpMemoryModel != VMM_MEMORYMODEL_X64) || pProcess->fUserOnly || !VMM_KADDR64(va) || !ctxVmm->kernel.paDTB) { return FALSE; }
+    if(pProcess->paDTB == ctxVmm->kernel.paDTB) { return TRUE; }
+    iSlot = (DWORD)((va >> 39) & 0xff);
+    dwGeneration = ctxVmm->Cache.dwTlbGeneration;
+    dwState = pProcess->dwTlbKernelShared[iSlot];
+    if((dwState >> 1) == ((dwGeneration + 1) & 0x7fffffff)) {
+        return (dwState & 1) ? TRUE : FALSE;
+    }
+    if((pObPML4 = VmmTlbGetPageTable(pProcess->paDTB, FALSE)) && (pObPML4K = VmmTlbGetPageTable(ctxVmm->kernel.paDTB, FALSE))) {
+        fShared = (pObPML4->pqw[0x100 + iSlot] & 1) && (pObPML4->pqw[0x100 + iSlot] == pObPML4K->pqw[0x100 + iSlot]);
+    }
+    Ob_DECREF(pObPML4);
+    Ob_DECREF(pObPML4K);
+    if(dwGeneration == ctxVmm->Cache.dwTlbGeneration) {
+        pProcess->dwTlbKernelShared[iSlot] = (((dwGeneration + 1) & 0x7fffffff) << 1) | (fShared ? 1 : 0);
+    }
+    return fShared;
+}
+
+/*
+* Look up a translation in the software tlb responsible for the address; i.e.
+* the shared kernel tlb for shared x64 kernel addresses or the process tlb.
+* -- pProcess
+* -- va
+* -- ppa
+* -- return
+*/
+_Success_(return)
+BOOL VmmVirt2Phys_TlbLookup(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    if(VmmVirt2Phys_IsKernelShared(pProcess, va)) {
+        return VmmVirt2Phys_TlbGet(&ctxVmm->Cache.TlbKernel, ctxVmm->kernel.paDTB, FALSE, va, ppa, NULL);
+    }
+    return VmmVirt2Phys_TlbGet(&pProcess->Tlb, pProcess->paDTB, pProcess->fUserOnly, va, ppa, NULL);
+}
+
+/*
+* Walk the page tables of the memory model tp. If tp is a compile time constant
+* the memory model page table walker is called directly; VMM_MEMORYMODEL_NA
+* dispatches through the memory model function table.
+*/
+static __forceinline BOOL VmmVirt2Phys_Walk(_In_ VMM_MEMORYMODEL_TP tp, _In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift)
+{
+    switch(tp) {
+        case VMM_MEMORYMODEL_X64:
+            return MmX64_Virt2Phys(paDTB, fUserOnly, -1, va, ppa, pbPageShift);
+        case VMM_MEMORYMODEL_X86PAE:
+            return MmX86PAE_Virt2Phys(paDTB, fUserOnly, -1, va, ppa, pbPageShift);
+        case VMM_MEMORYMODEL_X86:
+            return MmX86_Virt2Phys(paDTB, fUserOnly, -1, va, ppa, pbPageShift);
+        default:
+            return ctxVmm->fnMemoryModel.pfnVirt2Phys(paDTB, fUserOnly, -1, va, ppa, pbPageShift);
+    }
+}
+
+/*
+* Translate a virtual address to a physical address - see VmmVirt2Phys. The tp
+* is either the active memory model (as a compile time constant - for the
+* specialized virtual memory read loops) or VMM_MEMORYMODEL_NA for the generic
+* function table dispatched version. The optional pbPageShift receives the page
+* shift of the translation (12 = 4kB, 21 = 2MB, ...).
+*/
+_Success_(return)
+static __forceinline BOOL VmmVirt2Phys_Tp(_In_ VMM_MEMORYMODEL_TP tp, _In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift)
+{
+    BYTE iShift = 0;
+    BOOL fUserOnly;
+    QWORD paDTB;
+    DWORD dwGeneration;
+    PVMM_PROCESS_TLB pTlb;
+    if(!ctxVmm->Cache.TLB.fActive) {
+        return VmmVirt2Phys_Walk(tp, pProcess->paDTB, pProcess->fUserOnly, va, ppa, pbPageShift);
+    }
+    if(((tp == VMM_MEMORYMODEL_X64) || (tp == VMM_MEMORYMODEL_NA)) && VmmVirt2Phys_IsKernelShared(pProcess, va)) {
+        pTlb = &ctxVmm->Cache.TlbKernel;
+        paDTB = ctxVmm->kernel.paDTB;
+        fUserOnly = FALSE;
+        if(pProcess->paDTB != paDTB) {
+            InterlockedIncrement64(&ctxVmm->stat.cTlbVirt2PhysKernelShared);
+        }
+    } else {
+        pTlb = &pProcess->Tlb;
+        paDTB = pProcess->paDTB;
+        fUserOnly = pProcess->fUserOnly;
+    }
+    if(VmmVirt2Phys_TlbGet(pTlb, paDTB, fUserOnly, va, ppa, pbPageShift)) {
+        InterlockedIncrement64(&ctxVmm->stat.cTlbVirt2PhysHit);
+        return TRUE;
+    }
+    dwGeneration = ctxVmm->Cache.dwTlbGeneration;
+    if(!VmmVirt2Phys_Walk(tp, paDTB, fUserOnly, va, ppa, &iShift)) { return FALSE; }
+    VmmVirt2Phys_TlbPut(pTlb, paDTB, fUserOnly, va, *ppa, iShift, dwGeneration);
+    if(pbPageShift) { *pbPageShift = iShift; }
+    return TRUE;
+}
+
+/*
+* Translate a virtual address to a physical address by walking the page tables.
+* Successful translations are kept in the process software tlb which is looked
+* up before walking the page tables; it's invalidated on TLB refresh. On x64
+* kernel addresses mapped by PML4 entries identical to the kernel DTB share a
+* single software tlb between all processes.
+* The successfully translated Physical Address (PA) is returned in ppa.
+* Upon fail the PTE will be returned in ppa (if possible) - which may be used
+* to further lookup virtual memory in case of PageFile or Win10 MemCompression.
+* -- pProcess
+* -- va
+* -- ppa
+* -- return
+*/
+_Success_(return)
+BOOL VmmVirt2Phys(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    *ppa = 0;
+    if(!pProcess || (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA)) { return FALSE; }
+    return VmmVirt2Phys_Tp(VMM_MEMORYMODEL_NA, pProcess, va, ppa, NULL);
+}
+
+/*
+* Translate multiple virtual addresses of a process to physical addresses. The
+* addresses missing in the software tlb are sorted (grouping addresses sharing
+* page tables) and their missing page tables are fetched in batches (one read
+* per page table level) before translating each address.
+* -- pProcess
+* -- cva
+* -- pva = virtual addresses.
+* -- ppa = physical addresses (0 on fail).
+* -- pfSuccess = optional per-address result.
+* -- return = number of successfully translated addresses.
+*/
+DWORD VmmVirt2PhysBatch(_In_ PVMM_PROCESS pProcess, _In_ DWORD cva, _In_reads_(cva) PQWORD pva, _Out_writes_(cva) PQWORD ppa, _Out_writes_opt_(cva) PBOOL pfSuccess)
+{
+    BOOL f;
+    QWORD pa;
+    DWORD i, j, cvaPage = 0, cSuccess = 0;
+    PQWORD pvaPage;
+    // 1: batch fetch page tables of addresses not in software tlb
+    if((cva > 1) && ctxVmm->fnMemoryModel.pfnTlbPrefetchVirt2Phys && ctxVmm->Cache.TLB.fActive && (pvaPage = LocalAlloc(0, cva * sizeof(QWORD)))) {
+        for(i = 0; i < cva; i++) {
+            if(!VmmVirt2Phys_TlbLookup(pProcess, pva[i], &pa)) {
+                pvaPage[cvaPage++] = pva[i] & ~0xfffULL;
+            }
+        }
+        if(cvaPage > 1) {
+            qsort(pvaPage, cvaPage, sizeof(QWORD), Util_qsort_QWORD);
+            for(i = 1, j = 1; i < cvaPage; i++) {
+                if(pvaPage[i] != pvaPage[j - 1]) {
+                    pvaPage[j++] = pvaPage[i];
+                }
+            }
+            cvaPage = j;
         }
-        if(pMEM->f) {
-            Ob_INCREF(pObReservedMEM);
-            VmmCacheReserveReturn(pObReservedMEM);
-            return pObReservedMEM;
+        if(cvaPage > 1) {
+            ctxVmm->fnMemoryModel.pfnTlbPrefetchVirt2Phys(pProcess, cvaPage, pvaPage);
         }
-        VmmCacheReserveReturn(pObReservedMEM);
+        LocalFree(pvaPage);
     }
-    return NULL;
+    // 2: translate
+    for(i = 0; i < cva; i++) {
+        f = VmmVirt2Phys(pProcess, pva[i], ppa + i);
+        if(!f) { ppa[i] = 0; }
+        if(pfSuccess) { pfSuccess[i] = f; }
+        if(f) { cSuccess++; }
+    }
+    return cSuccess;
 }
 
 /*
-* Retrieve a page table from a given physical address (if possible).
-* CALLER DECREF: return
+* Append a range to the extent list of a range translation - merging it with
+* the previous extent if contiguous.
+* -- ctx
+* -- va
 * -- pa
-* -- fCacheOnly
-* -- return = Cache entry on success, NULL on fail.
+* -- cb
+* -- tp
 */
-PVMMOB_CACHE_MEM VmmTlbGetPageTable(_In_ QWORD pa, _In_ BOOL fCacheOnly)
+VOID VmmVirt2PhysRange_Push(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx, _In_ QWORD va, _In_ QWORD pa, _In_ QWORD cb, _In_ VMM_PTE_TP tp)
 {
-    PVMMOB_CACHE_MEM pObMEM;
-    pObMEM = VmmCacheGet(VMM_CACHE_TAG_TLB, pa);
-    if(pObMEM) {
-        InterlockedIncrement64(&ctxVmm->stat.cTlbCacheHit);
-        return pObMEM;
-    }
-    if(fCacheOnly) { return NULL; }
-    // try retrieve from (1) TLB cache, (2) PHYS cache, (3) device
-    pObMEM = VmmCacheGet_FromDeviceOnMiss(VMM_CACHE_TAG_TLB, VMM_CACHE_TAG_PHYS, pa);
-    if(!pObMEM) {
-        InterlockedIncrement64(&ctxVmm->stat.cTlbReadFail);
-        return NULL;
+    DWORD cMapMax;
+    PVMM_MAP_EXTENTENTRY pe, pMap;
+    if(ctx->fFail || !cb) { return; }
+    if(ctx->cMap) {
+        pe = ctx->pMap + ctx->cMap - 1;
+        if((pe->tp == tp) && (pe->va + pe->cb == va) && ((pe->pa + pe->cb == pa) || (!pe->pa && !pa && (tp != VMM_PTE_TP_HARDWARE)))) {
+            pe->cb += cb;
+            return;
+        }
     }
-    InterlockedIncrement64(&ctxVmm->stat.cTlbReadSuccess);
-    if(VmmTlbPageTableVerify(pObMEM->h.pb, pObMEM->h.qwA, FALSE)) {
-        return pObMEM;
+    if(ctx->cMap == ctx->cMapMax) {
+        cMapMax = ctx->cMapMax ? 2 * ctx->cMapMax : 0x100;
+        if(!(pMap = LocalAlloc(0, cMapMax * sizeof(VMM_MAP_EXTENTENTRY)))) {
+            ctx->fFail = TRUE;
+            return;
+        }
+        if(ctx->cMap) {
+            memcpy(pMap, ctx->pMap, ctx->cMap * sizeof(VMM_MAP_EXTENTENTRY));
+        }
+        LocalFree(ctx->pMap);
+        ctx->pMap = pMap;
+        ctx->cMapMax = cMapMax;
     }
-    Ob_DECREF(pObMEM);
-    return NULL;
+    pe = ctx->pMap + ctx->cMap++;
+    pe->va = va;
+    pe->pa = pa;
+    pe->cb = cb;
+    pe->tp = tp;
+    pe->_Reserved1 = 0;
 }
 
 /*
-* Translate a virtual address to a physical address by walking the page tables.
-* The successfully translated Physical Address (PA) is returned in ppa.
-* Upon fail the PTE will be returned in ppa (if possible) - which may be used
-* to further lookup virtual memory in case of PageFile or Win10 MemCompression.
-* -- paDTB
-* -- fUserOnly
+* Append a not present page (given by its PTE) to the extent list of a range
+* translation. The page type is resolved by the memory model paged function.
+* -- ctx
 * -- va
-* -- ppa
-* -- return
+* -- pte
+* -- cb = byte count within the page starting at va.
 */
-_Success_(return)
-BOOL VmmVirt2PhysEx(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
+VOID VmmVirt2PhysRange_PushPte(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx, _In_ QWORD va, _In_ QWORD pte, _In_ QWORD cb)
 {
-    *ppa = 0;
-    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return FALSE; }
-    return ctxVmm->fnMemoryModel.pfnVirt2Phys(paDTB, fUserOnly, -1, va, ppa);
+    QWORD pa = 0;
+    VMM_PTE_TP tp = VMM_PTE_TP_NA;
+    if(!pte || !ctxVmm->fnMemoryModel.pfnPagedRead) { return; }
+    ctxVmm->fnMemoryModel.pfnPagedRead(ctx->pProcess, va & ~0xfffULL, pte, NULL, &pa, &tp, VMM_FLAG_NOVAD);
+    if(tp == VMM_PTE_TP_NA) { return; }
+    // VAD-backed memory isn't resolved through the VAD here (VMM_FLAG_NOVAD) -
+    // the paged read sees a bogus page file offset; report it as prototype.
+    if(((tp == VMM_PTE_TP_PAGEFILE) || (tp == VMM_PTE_TP_COMPRESSED)) && MmWin_PteIsVadBacked(pte)) {
+        tp = VMM_PTE_TP_PROTOTYPE;
+        pa = 0;
+    }
+    VmmVirt2PhysRange_Push(ctx, va, (pa ? ((pa & ~0xfffULL) + (va & 0xfff)) : 0), cb, tp);
 }
 
 /*
-* Translate a virtual address to a physical address by walking the page tables.
-* The successfully translated Physical Address (PA) is returned in ppa.
-* Upon fail the PTE will be returned in ppa (if possible) - which may be used
-* to further lookup virtual memory in case of PageFile or Win10 MemCompression.
+* Range translation for memory models without a range walker - translate one
+* page (or one large page) at a time.
+* -- ctx
+*/
+VOID VmmVirt2PhysRange_Generic(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx)
+{
+    BYTE iShift;
+    QWORD va, vaNext, vaLast, pa;
+    PVMM_PROCESS pProcess = ctx->pProcess;
+    va = ctx->vaFirst;
+    while(!ctx->fFail) {
+        iShift = 12;
+        if(ctxVmm->fnMemoryModel.pfnVirt2Phys(pProcess->paDTB, pProcess->fUserOnly, -1, va & ~0xfffULL, &pa, &iShift)) {
+            vaNext = (va | ((1ULL << iShift) - 1)) + 1;
+            vaLast = min(vaNext - 1, ctx->vaLast);
+            VmmVirt2PhysRange_Push(ctx, va, (pa & ~0xfffULL) + (va & 0xfff), vaLast - va + 1, VMM_PTE_TP_HARDWARE);
+        } else {
+            vaNext = (va & ~0xfffULL) + 0x1000;
+            vaLast = min(vaNext - 1, ctx->vaLast);
+            VmmVirt2PhysRange_PushPte(ctx, va, pa, vaLast - va + 1);
+        }
+        if(vaLast >= ctx->vaLast) { break; }
+        va = vaNext;
+    }
+}
+
+/*
+* Translate a virtual address range into a compact list of extents. Physically
+* contiguous pages and large pages are merged into single extents.
+* CALLER DECREF: return
 * -- pProcess
 * -- va
-* -- ppa
+* -- cb
 * -- return
 */
-_Success_(return)
-BOOL VmmVirt2Phys(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa)
+PVMMOB_MAP_EXTENT VmmVirt2PhysRange(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD cb)
 {
-    *ppa = 0;
-    if(!pProcess || (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA)) { return FALSE; }
-    return ctxVmm->fnMemoryModel.pfnVirt2Phys(pProcess->paDTB, pProcess->fUserOnly, -1, va, ppa);
+    VMM_VIRT2PHYS_RANGE_CONTEXT ctx = { 0 };
+    PVMMOB_MAP_EXTENT pObMap = NULL;
+    if(!cb || (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA)) { return NULL; }
+    ctx.pProcess = pProcess;
+    ctx.vaFirst = va;
+    ctx.vaLast = (va + cb - 1 < va) ? (QWORD)-1 : (va + cb - 1);
+    if(ctxVmm->f32) {
+        if(ctx.vaFirst > 0xffffffff) { return NULL; }
+        ctx.vaLast = min(ctx.vaLast, 0xffffffff);
+    }
+    if(ctxVmm->fnMemoryModel.pfnVirt2PhysRange) {
+        ctxVmm->fnMemoryModel.pfnVirt2PhysRange(&ctx);
+    } else {
+        VmmVirt2PhysRange_Generic(&ctx);
+    }
+    if(!ctx.fFail && (pObMap = Ob_Alloc(OB_TAG_MAP_EXTENT, LMEM_ZEROINIT, sizeof(VMMOB_MAP_EXTENT) + ctx.cMap * sizeof(VMM_MAP_EXTENTENTRY), NULL, NULL))) {
+        pObMap->cMap = ctx.cMap;
+        if(ctx.cMap) {
+            memcpy(pObMap->pMap, ctx.pMap, ctx.cMap * sizeof(VMM_MAP_EXTENTENTRY));
+        }
+    }
+    LocalFree(ctx.pMap);
+    return pObMap;
 }
 
 /*
@@ -433,6 +2111,48 @@ VOID VmmTlbSpider(_In_ PVMM_PROCESS pProcess)
     ctxVmm->fnMemoryModel.pfnTlbSpider(pProcess);
 }
 
+BOOL VmmTlbSpiderAll_CriteriaNotDone(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx)
+{
+    return (pProcess->dwState == 0) && !pProcess->fTlbSpiderDone;
+}
+
+VOID VmmTlbSpiderAll_Action(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx)
+{
+    VmmTlbSpider(pProcess);
+}
+
+/*
+* Spider the TLB (page table cache) of all active not yet spidered processes.
+* Processes are spidered in parallel and page table reads are batched over all
+* processes if supported by the memory model.
+*/
+VOID VmmTlbSpiderAll()
+{
+    SIZE_T cMax = 0;
+    DWORD i, cProcess = 0;
+    PVMM_PROCESS pObProcess = NULL, *ppObProcess = NULL;
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return; }
+    if(!ctxVmm->fnMemoryModel.pfnTlbSpiderMultiple) {
+        VmmProcessActionForeachParallel(NULL, VmmTlbSpiderAll_CriteriaNotDone, VmmTlbSpiderAll_Action);
+        return;
+    }
+    VmmProcessListPIDs(NULL, &cMax, 0);
+    if(!cMax || !(ppObProcess = LocalAlloc(0, cMax * sizeof(PVMM_PROCESS)))) { return; }
+    while((cProcess < cMax) && (pObProcess = VmmProcessGetNext(pObProcess, 0))) {
+        if(VmmTlbSpiderAll_CriteriaNotDone(pObProcess, NULL)) {
+            ppObProcess[cProcess++] = Ob_INCREF(pObProcess);
+        }
+    }
+    Ob_DECREF_NULL(&pObProcess);
+    if(cProcess) {
+        ctxVmm->fnMemoryModel.pfnTlbSpiderMultiple(cProcess, ppObProcess);
+    }
+    for(i = 0; i < cProcess; i++) {
+        Ob_DECREF(ppObProcess[i]);
+    }
+    LocalFree(ppObProcess);
+}
+
 /*
 * Try verify that a supplied page table in pb is valid by analyzing it.
 * -- pb = 0x1000 bytes containing the page table page.
@@ -1197,115 +2917,336 @@ BOOL VmmProcessTableCreateInitial()
 
 // ----------------------------------------------------------------------------
 // WORK (THREAD POOL) API:
-// The 'Work' thread pool contain by default 32 threads which is waiting to
-// receive work scheduled by calling the VmmWork function.
+// The 'Work' thread pool contain a number of threads sized to the host which
+// are waiting to receive work scheduled by calling the VmmWork function.
+// Each worker thread has its own work queue; work is scheduled round-robin
+// onto the queues. A worker takes work from its own queue and steals work
+// from the other queues when its own is empty. Work is always taken oldest
+// first so that no work unit starves behind work scheduled after it.
+// Work units are stored by value in the queues - no allocation per unit.
 // ----------------------------------------------------------------------------
 
+typedef struct tdVMMWORK_LATCH {
+    volatile DWORD cRemaining;      // work units remaining - event set at zero.
+    HANDLE hEventFinish;
+} VMMWORK_LATCH, *PVMMWORK_LATCH;
+
 typedef struct tdVMMWORK_UNIT {
     LPTHREAD_START_ROUTINE pfn;     // function to call
     PVOID ctx;                      // optional function parameter
     HANDLE hEventFinish;            // optional event to set when upon work completion
+    PVMMWORK_LATCH pLatch;          // optional latch to count down upon work completion
 } VMMWORK_UNIT, *PVMMWORK_UNIT;
 
-typedef struct tdVMMWORK_THREAD_CONTEXT {
-    HANDLE hEventWakeup;
-    HANDLE hThread;
-} VMMWORK_THREAD_CONTEXT, *PVMMWORK_THREAD_CONTEXT;
+typedef struct tdVMMWORK_DEQUE {
+    SRWLOCK LockSRW;
+    DWORD iHead;                    // index of oldest unit
+    DWORD cUnit;
+    VMMWORK_UNIT Unit[VMM_WORK_DEQUE_SIZE];
+} VMMWORK_DEQUE, *PVMMWORK_DEQUE;
+
+VOID VmmWork_LatchCountDown(_In_ PVMMWORK_LATCH pLatch)
+{
+    if(0 == InterlockedDecrement(&pLatch->cRemaining)) {
+        SetEvent(pLatch->hEventFinish);
+    }
+}
+
+VOID VmmWork_UnitComplete(_In_ PVMMWORK_UNIT pu)
+{
+    if(pu->hEventFinish) {
+        SetEvent(pu->hEventFinish);
+    }
+    if(pu->pLatch) {
+        VmmWork_LatchCountDown(pu->pLatch);
+    }
+}
+
+/*
+* Take the oldest work unit from a work queue.
+* -- pd
+* -- pu = receives the work unit.
+* -- return
+*/
+_Success_(return)
+BOOL VmmWork_DequePop(_In_ PVMMWORK_DEQUE pd, _Out_ PVMMWORK_UNIT pu)
+{
+    if(!pd->cUnit) { return FALSE; }
+    AcquireSRWLockExclusive(&pd->LockSRW);
+    if(!pd->cUnit) {
+        ReleaseSRWLockExclusive(&pd->LockSRW);
+        return FALSE;
+    }
+    *pu = pd->Unit[pd->iHead];
+    pd->iHead = (pd->iHead + 1) % VMM_WORK_DEQUE_SIZE;
+    pd->cUnit--;
+    ReleaseSRWLockExclusive(&pd->LockSRW);
+    return TRUE;
+}
+
+_Success_(return)
+BOOL VmmWork_DequePush(_In_ PVMMWORK_DEQUE pd, _In_ PVMMWORK_UNIT pu)
+{
+    if(pd->cUnit == VMM_WORK_DEQUE_SIZE) { return FALSE; }
+    AcquireSRWLockExclusive(&pd->LockSRW);
+    if(pd->cUnit == VMM_WORK_DEQUE_SIZE) {
+        ReleaseSRWLockExclusive(&pd->LockSRW);
+        return FALSE;
+    }
+    pd->Unit[(pd->iHead + pd->cUnit) % VMM_WORK_DEQUE_SIZE] = *pu;
+    pd->cUnit++;
+    ReleaseSRWLockExclusive(&pd->LockSRW);
+    return TRUE;
+}
+
+/*
+* Retrieve a work unit for a worker thread; from its own queue or stolen from
+* the queues of the other worker threads.
+* -- iThread
+* -- pu
+* -- return
+*/
+_Success_(return)
+BOOL VmmWork_Pop(_In_ DWORD iThread, _Out_ PVMMWORK_UNIT pu)
+{
+    DWORD i;
+    if(VmmWork_DequePop(ctxVmm->Work.pDeques + iThread, pu)) { return TRUE; }
+    for(i = 1; i < ctxVmm->Work.cThread; i++) {
+        if(VmmWork_DequePop(ctxVmm->Work.pDeques + ((iThread + i) % ctxVmm->Work.cThread), pu)) { return TRUE; }
+    }
+    return FALSE;
+}
 
-DWORD VmmWork_MainWorkerLoop_ThreadProc(PVMMWORK_THREAD_CONTEXT ctx)
+DWORD VmmWork_MainWorkerLoop_ThreadProc(_In_ LPVOID lpParameter)
 {
-    PVMMWORK_UNIT pu;
+    BOOL fUnit;
+    VMMWORK_UNIT u;
+    DWORD iThread = (DWORD)(SIZE_T)lpParameter;
     while(ctxVmm->Work.fEnabled) {
-        if((pu = (PVMMWORK_UNIT)ObSet_Pop(ctxVmm->Work.psUnit))) {
-            ((DWORD(*)(LPVOID))pu->pfn)(pu->ctx);
-            if(pu->hEventFinish) {
-                SetEvent(pu->hEventFinish);
+        if(VmmWork_Pop(iThread, &u)) {
+            // chain wakeup of idle threads while there may be more queued work.
+            if(ctxVmm->Work.cThreadIdle) {
+                SetEvent(ctxVmm->Work.hEventWakeup);
             }
-            LocalFree(pu);
+            ((DWORD(*)(LPVOID))u.pfn)(u.ctx);
+            VmmWork_UnitComplete(&u);
         } else {
-            ResetEvent(ctx->hEventWakeup);
-            ObSet_Push(ctxVmm->Work.psThreadAvail, (QWORD)ctx);
-            WaitForSingleObject(ctx->hEventWakeup, INFINITE);
+            // idle: register as idle before re-checking for work to avoid lost wakeups.
+            InterlockedIncrement(&ctxVmm->Work.cThreadIdle);
+            fUnit = VmmWork_Pop(iThread, &u);
+            if(!fUnit && ctxVmm->Work.fEnabled) {
+                WaitForSingleObject(ctxVmm->Work.hEventWakeup, INFINITE);
+            }
+            InterlockedDecrement(&ctxVmm->Work.cThreadIdle);
+            if(fUnit) {
+                ((DWORD(*)(LPVOID))u.pfn)(u.ctx);
+                VmmWork_UnitComplete(&u);
+            }
         }
     }
-    ObSet_Remove(ctxVmm->Work.psThreadAll, (QWORD)ctx);
-    CloseHandle(ctx->hEventWakeup);
-    CloseHandle(ctx->hThread);
-    LocalFree(ctx);
+    InterlockedDecrement(&ctxVmm->Work.cThreadActive);
     return 1;
 }
 
+/*
+* Retrieve the number of worker threads to use - sized to the host.
+*/
+DWORD VmmWork_ThreadCount()
+{
+    DWORD cCpu = 0;
+#ifdef _WIN32
+    SYSTEM_INFO si = { 0 };
+    GetSystemInfo(&si);
+    cCpu = si.dwNumberOfProcessors;
+#endif /* _WIN32 */
+#ifdef LINUX
+    long cCpuLinux = sysconf(_SC_NPROCESSORS_ONLN);
+    cCpu = (cCpuLinux > 0) ? (DWORD)cCpuLinux : 0;
+#endif /* LINUX */
+    return min(VMM_WORK_THREADPOOL_NUM_THREADS_MAX, max(VMM_WORK_THREADPOOL_NUM_THREADS_MIN, 2 * cCpu));
+}
+
 VOID VmmWork_Initialize()
 {
-    PVMMWORK_THREAD_CONTEXT p;
+    DWORD i, cThread;
+    HANDLE hThread;
+    cThread = VmmWork_ThreadCount();
+    if(!(ctxVmm->Work.pDeques = LocalAlloc(LMEM_ZEROINIT, cThread * sizeof(VMMWORK_DEQUE)))) { return; }
+    if(!(ctxVmm->Work.hEventWakeup = CreateEvent(NULL, FALSE, FALSE, NULL))) {
+        LocalFree(ctxVmm->Work.pDeques);
+        ctxVmm->Work.pDeques = NULL;
+        return;
+    }
+    for(i = 0; i < cThread; i++) {
+        InitializeSRWLock(&ctxVmm->Work.pDeques[i].LockSRW);
+    }
+    ctxVmm->Work.cThread = cThread;
     ctxVmm->Work.fEnabled = TRUE;
-    ctxVmm->Work.psUnit = ObSet_New();
-    ctxVmm->Work.psThreadAll = ObSet_New();
-    ctxVmm->Work.psThreadAvail = ObSet_New();
-    while(ObSet_Size(ctxVmm->Work.psThreadAll) < VMM_WORK_THREADPOOL_NUM_THREADS) {
-        if((p = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMWORK_THREAD_CONTEXT)))) {
-            p->hEventWakeup = CreateEvent(NULL, TRUE, FALSE, NULL);
-            p->hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmWork_MainWorkerLoop_ThreadProc, p, 0, NULL);
-            ObSet_Push(ctxVmm->Work.psThreadAll, (QWORD)p);
+    for(i = 0; i < cThread; i++) {
+        InterlockedIncrement(&ctxVmm->Work.cThreadActive);
+        if((hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmWork_MainWorkerLoop_ThreadProc, (LPVOID)(SIZE_T)i, 0, NULL))) {
+            CloseHandle(hThread);
+        } else {
+            InterlockedDecrement(&ctxVmm->Work.cThreadActive);
         }
     }
 }
 
 VOID VmmWork_Close()
 {
-    PVMMWORK_UNIT pu;
-    PVMMWORK_THREAD_CONTEXT pt = NULL;
+    DWORD i;
+    VMMWORK_UNIT u;
     ctxVmm->Work.fEnabled = FALSE;
-    while(ObSet_Size(ctxVmm->Work.psThreadAll)) {
-        while((pt = (PVMMWORK_THREAD_CONTEXT)ObSet_GetNext(ctxVmm->Work.psThreadAll, (QWORD)pt))) {
-            SetEvent(pt->hEventWakeup);
-        }
+    while(ctxVmm->Work.cThreadActive) {
+        SetEvent(ctxVmm->Work.hEventWakeup);
         SwitchToThread();
     }
-    while((pu = (PVMMWORK_UNIT)ObSet_Pop(ctxVmm->Work.psUnit))) {
-        if(pu->hEventFinish) {
-            SetEvent(pu->hEventFinish);
+    for(i = 0; i < ctxVmm->Work.cThread; i++) {
+        while(VmmWork_DequePop(ctxVmm->Work.pDeques + i, &u)) {
+            VmmWork_UnitComplete(&u);
         }
-        LocalFree(pu);
     }
-    Ob_DECREF_NULL(&ctxVmm->Work.psUnit);
-    Ob_DECREF_NULL(&ctxVmm->Work.psThreadAll);
-    Ob_DECREF_NULL(&ctxVmm->Work.psThreadAvail);
+    if(ctxVmm->Work.hEventWakeup) {
+        CloseHandle(ctxVmm->Work.hEventWakeup);
+        ctxVmm->Work.hEventWakeup = NULL;
+    }
+    LocalFree(ctxVmm->Work.pDeques);
+    ctxVmm->Work.pDeques = NULL;
+    ctxVmm->Work.cThread = 0;
 }
 
-VOID VmmWork(_In_ LPTHREAD_START_ROUTINE pfn, _In_opt_ PVOID ctx, _In_opt_ HANDLE hEventFinish)
+/*
+* Schedule a work unit onto the work queue of a worker thread (round-robin).
+* If all queues are full the work unit is run inline on the calling thread -
+* the caller may itself be a worker thread which must not wait on its queue.
+* If the work pool is disabled the work unit is completed without being run.
+* -- pu
+* -- return = TRUE if the work unit was scheduled (or run inline).
+*/
+BOOL VmmWork_Push(_In_ PVMMWORK_UNIT pu)
 {
-    PVMMWORK_UNIT pu;
-    PVMMWORK_THREAD_CONTEXT pt;
-    if((pu = LocalAlloc(0, sizeof(VMMWORK_UNIT)))) {
-        pu->pfn = pfn;
-        pu->ctx = ctx;
-        pu->hEventFinish = hEventFinish;
-        ObSet_Push(ctxVmm->Work.psUnit, (QWORD)pu);
-        if((pt = (PVMMWORK_THREAD_CONTEXT)ObSet_Pop(ctxVmm->Work.psThreadAvail))) {
-            SetEvent(pt->hEventWakeup);
+    DWORD i, iDeque;
+    if(!ctxVmm->Work.fEnabled || !ctxVmm->Work.cThread) {
+        VmmWork_UnitComplete(pu);
+        return FALSE;
+    }
+    iDeque = InterlockedIncrement(&ctxVmm->Work.iDequeNext);
+    for(i = 0; i < ctxVmm->Work.cThread; i++) {
+        if(VmmWork_DequePush(ctxVmm->Work.pDeques + ((iDeque + i) % ctxVmm->Work.cThread), pu)) {
+            if(ctxVmm->Work.cThreadIdle) {
+                SetEvent(ctxVmm->Work.hEventWakeup);
+            }
+            return TRUE;
         }
     }
+    // all queues full -> run inline.
+    ((DWORD(*)(LPVOID))pu->pfn)(pu->ctx);
+    VmmWork_UnitComplete(pu);
+    return TRUE;
+}
+
+BOOL VmmWork(_In_ LPTHREAD_START_ROUTINE pfn, _In_opt_ PVOID ctx, _In_opt_ HANDLE hEventFinish)
+{
+    VMMWORK_UNIT u = { 0 };
+    u.pfn = pfn;
+    u.ctx = ctx;
+    u.hEventFinish = hEventFinish;
+    return VmmWork_Push(&u);
 }
 
 VOID VmmWorkWaitMultiple(_In_opt_ PVOID ctx, _In_ DWORD cWork, ...)
 {
     DWORD i;
     va_list arguments;
-    HANDLE hEventFinish[MAXIMUM_WAIT_OBJECTS] = { 0 };
-    if(cWork > MAXIMUM_WAIT_OBJECTS) { return; }
+    VMMWORK_UNIT u = { 0 };
+    VMMWORK_LATCH Latch = { 0 };
+    if(!cWork) { return; }
+    if(!(Latch.hEventFinish = CreateEvent(NULL, TRUE, FALSE, NULL))) { return; }
+    Latch.cRemaining = cWork;
+    u.ctx = ctx;
+    u.pLatch = &Latch;
     va_start(arguments, cWork);
     for(i = 0; i < cWork; i++) {
-        hEventFinish[i] = CreateEvent(NULL, TRUE, FALSE, NULL);
-        VmmWork(va_arg(arguments, LPTHREAD_START_ROUTINE), ctx, hEventFinish[i]);
+        u.pfn = va_arg(arguments, LPTHREAD_START_ROUTINE);
+        VmmWork_Push(&u);
     }
     va_end(arguments);
-    WaitForMultipleObjects(cWork, hEventFinish, TRUE, INFINITE);
-    for(i = 0; i < cWork; i++) {
-        if(hEventFinish[i]) {
-            CloseHandle(hEventFinish[i]);
+    WaitForSingleObject(Latch.hEventFinish, INFINITE);
+    CloseHandle(Latch.hEventFinish);
+}
+
+typedef struct tdVMMWORK_PARALLELFOR {
+    volatile DWORD cRef;            // caller + scheduled worker units.
+    volatile DWORD iNext;           // next index to claim.
+    DWORD c;
+    VMMWORK_LATCH Latch;            // counts down on each completed index.
+    PVOID ctx;
+    VOID(*pfn)(_In_opt_ PVOID ctx, _In_ DWORD i);
+} VMMWORK_PARALLELFOR, *PVMMWORK_PARALLELFOR;
+
+VOID VmmWork_ParallelFor_Release(_In_ PVMMWORK_PARALLELFOR pf)
+{
+    if(0 == InterlockedDecrement(&pf->cRef)) {
+        CloseHandle(pf->Latch.hEventFinish);
+        LocalFree(pf);
+    }
+}
+
+/*
+* Claim and process indexes until all indexes are claimed. Indexes are claimed
+* by both the calling thread and by worker threads - so completion never
+* depends on the worker pool being available.
+* -- pf
+*/
+VOID VmmWork_ParallelFor_Claim(_In_ PVMMWORK_PARALLELFOR pf)
+{
+    DWORD i;
+    while((i = InterlockedIncrement(&pf->iNext) - 1) < pf->c) {
+        pf->pfn(pf->ctx, i);
+        VmmWork_LatchCountDown(&pf->Latch);
+    }
+}
+
+DWORD VmmWork_ParallelFor_ThreadProc(_In_ PVMMWORK_PARALLELFOR pf)
+{
+    VmmWork_ParallelFor_Claim(pf);
+    VmmWork_ParallelFor_Release(pf);
+    return 1;
+}
+
+VOID VmmWorkParallelFor(_In_ DWORD c, _In_ DWORD cWorkerMax, _In_opt_ PVOID ctx, _In_ VOID(*pfn)(_In_opt_ PVOID ctx, _In_ DWORD i))
+{
+    DWORD i, cWorker;
+    VMMWORK_UNIT u = { 0 };
+    PVMMWORK_PARALLELFOR pf = NULL;
+    cWorker = (c > 1) ? min(c - 1, cWorkerMax) : 0;
+    if(cWorker && (pf = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMWORK_PARALLELFOR)))) {
+        if(!(pf->Latch.hEventFinish = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+            LocalFree(pf);
+            pf = NULL;
+        }
+    }
+    if(!pf) {
+        for(i = 0; i < c; i++) {
+            pfn(ctx, i);
+        }
+        return;
+    }
+    pf->c = c;
+    pf->ctx = ctx;
+    pf->pfn = pfn;
+    pf->Latch.cRemaining = c;
+    pf->cRef = 1 + cWorker;
+    u.pfn = (LPTHREAD_START_ROUTINE)VmmWork_ParallelFor_ThreadProc;
+    u.ctx = pf;
+    for(i = 0; i < cWorker; i++) {
+        if(!VmmWork_Push(&u)) {
+            VmmWork_ParallelFor_Release(pf);
         }
     }
+    VmmWork_ParallelFor_Claim(pf);
+    WaitForSingleObject(pf->Latch.hEventFinish, INFINITE);
+    VmmWork_ParallelFor_Release(pf);
 }
 
 // ----------------------------------------------------------------------------
@@ -1313,25 +3254,18 @@ VOID VmmWorkWaitMultiple(_In_opt_ PVOID ctx, _In_ DWORD cWork, ...)
 // ----------------------------------------------------------------------------
 
 typedef struct tdVMM_PROCESS_ACTION_FOREACH {
-    HANDLE hEventFinish;
     VOID(*pfnAction)(_In_ PVMM_PROCESS pProcess, _In_ PVOID ctx);
     PVOID ctxAction;
-    DWORD cRemainingWork;       // set to dwPIDs count on entry and decremented as-goes - when zero FinishEvent is set.
-    DWORD iPID;                 // set to dwPIDs count on entry and decremented as-goes
     DWORD dwPIDs[];
 } VMM_PROCESS_ACTION_FOREACH, *PVMM_PROCESS_ACTION_FOREACH;
 
-DWORD VmmProcessActionForeachParallel_ThreadProc(PVMM_PROCESS_ACTION_FOREACH ctx)
+VOID VmmProcessActionForeachParallel_Action(_In_ PVMM_PROCESS_ACTION_FOREACH ctx, _In_ DWORD i)
 {
-    PVMM_PROCESS pObProcess = VmmProcessGet(ctx->dwPIDs[InterlockedDecrement(&ctx->iPID)]);
+    PVMM_PROCESS pObProcess = VmmProcessGet(ctx->dwPIDs[i]);
     if(pObProcess) {
         ctx->pfnAction(pObProcess, ctx->ctxAction);
         Ob_DECREF(pObProcess);
     }
-    if(0 == InterlockedDecrement(&ctx->cRemainingWork)) {
-        SetEvent(ctx->hEventFinish);
-    }
-    return 1;
 }
 
 BOOL VmmProcessActionForeachParallel_CriteriaActiveOnly(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx)
@@ -1360,27 +3294,16 @@ VOID VmmProcessActionForeachParallel(_In_opt_ PVOID ctxAction, _In_opt_ BOOL(*pf
     if(!(cProcess = ObSet_Size(pObProcessSelectedSet))) { goto fail; }
     // 2: set up context for worker function
     if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(VMM_PROCESS_ACTION_FOREACH) + cProcess * sizeof(DWORD)))) { goto fail; }
-    if(!(ctx->hEventFinish = CreateEvent(NULL, TRUE, FALSE, NULL))) { goto fail; }
     ctx->pfnAction = pfnAction;
     ctx->ctxAction = ctxAction;
-    ctx->cRemainingWork = cProcess;
-    ctx->iPID = cProcess;
     for(i = 0; i < cProcess; i++) {
         ctx->dwPIDs[i] = (DWORD)ObSet_Pop(pObProcessSelectedSet);
     }
     // 3: parallelize onto worker threads and wait for completion
-    for(i = 0; i < cProcess; i++) {
-        VmmWork((PTHREAD_START_ROUTINE)VmmProcessActionForeachParallel_ThreadProc, ctx, NULL);
-    }
-    WaitForSingleObject(ctx->hEventFinish, INFINITE);
+    VmmWorkParallelFor(cProcess, ctxVmm->Work.cThread, ctx, (VOID(*)(PVOID, DWORD))VmmProcessActionForeachParallel_Action);
 fail:
     Ob_DECREF(pObProcessSelectedSet);
-    if(ctx) {
-        if(ctx->hEventFinish) {
-            CloseHandle(ctx->hEventFinish);
-        }
-        LocalFree(ctx);
-    }
+    LocalFree(ctx);
 }
 
 // ----------------------------------------------------------------------------
@@ -1426,28 +3349,240 @@ VOID VmmWriteScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_ PPMEM_SCATTER pp
         ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, pMEM->qwA, qwPA_PTE, NULL, &qwPagedPA, NULL, 0);
         pMEM->qwA = qwPagedPA ? qwPagedPA : -1;
     }
-    // write to physical addresses
-    VmmWriteScatterPhysical(ppMEMsVirt, cpMEMsVirt);
-    for(i = 0; i < cpMEMsVirt; i++) {
-        ppMEMsVirt[i]->qwA = MEM_SCATTER_STACK_POP(ppMEMsVirt[i]);
+    // write to physical addresses
+    VmmWriteScatterPhysical(ppMEMsVirt, cpMEMsVirt);
+    for(i = 0; i < cpMEMsVirt; i++) {
+        ppMEMsVirt[i]->qwA = MEM_SCATTER_STACK_POP(ppMEMsVirt[i]);
+    }
+    if(fProcessMagicHandle) { Ob_DECREF(pProcess); }
+}
+
+/*
+* Credit a read-ahead stream when a page read ahead by it is used the first
+* time. This is the feedback used to grow or shrink the read-ahead window.
+* -- pOb = PHYS cache entry being read.
+*/
+VOID VmmReadAhead_Used(_In_ PVMMOB_CACHE_MEM pOb)
+{
+    DWORD dwId = pOb->dwReadAheadId;
+    PVMM_READAHEAD_STREAM s;
+    if(!dwId || (dwId != (DWORD)InterlockedCompareExchange((volatile LONG*)&pOb->dwReadAheadId, 0, dwId))) { return; }
+    InterlockedIncrement64(&ctxVmm->stat.cPhysReadAheadUsed);
+    s = &ctxVmm->ReadAhead.Set[(dwId >> 4) & (VMM_READAHEAD_SETS - 1)].S[dwId & (VMM_READAHEAD_STREAMS - 1)];
+    if(s->dwId == dwId) {
+        InterlockedIncrement(&s->cUsed);
+    }
+}
+
+/*
+* Plan read-ahead for a physical read. The demand misses (not yet read pages)
+* are matched against the tracked access streams. A stream is established by
+* a batch of misses with a constant stride, or by a miss which follows up on
+* the last miss of a stream within the max stride. Sequential, reverse and
+* strided access is detected alike. The window of a stream is doubled if most
+* of its read ahead pages are used and halved if most of them are wasted.
+* Streams are kept in sets selected by physical address - each set has its own
+* lock. Cache existence of read-ahead candidates is probed without the lock.
+* -- ppMEMs
+* -- cMEMs
+* -- pqwA = receives the physical addresses to read ahead.
+* -- pdwId = receives the id of the read-ahead stream.
+* -- return = the number of addresses to read ahead.
+*/
+DWORD VmmReadAhead_Plan(_In_reads_(cMEMs) PPMEM_SCATTER ppMEMs, _In_ DWORD cMEMs, _Out_writes_(VMM_READAHEAD_WINDOW_MAX) PQWORD pqwA, _Out_ PDWORD pdwId)
+{
+    BOOL fBatchStride = TRUE;
+    DWORD i, iS, cMiss = 0, cWindow = 0, cA = 0, dwId;
+    QWORD qwA, paFirst = 0, paLast = 0;
+    LONGLONG d, k, iStride, iBatchStride = 0;
+    PVMM_READAHEAD_SET pSet;
+    PVMM_READAHEAD_STREAM s = NULL, sLRU;
+    PMEM_SCATTER pMEM;
+    // 1: analyze the misses of the read.
+    for(i = 0; i < cMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if(pMEM->f || (pMEM->cb != 0x1000) || !MEM_SCATTER_ADDR_ISVALID(pMEM)) { continue; }
+        if(cMiss) {
+            d = (LONGLONG)(pMEM->qwA - paLast);
+            if(cMiss == 1) { iBatchStride = d; }
+            fBatchStride = fBatchStride && d && (d == iBatchStride);
+        } else {
+            paFirst = pMEM->qwA;
+        }
+        paLast = pMEM->qwA;
+        cMiss++;
+    }
+    if(!cMiss) { return 0; }
+    fBatchStride = fBatchStride && (cMiss > 1) && (iBatchStride >= -VMM_READAHEAD_STRIDE_MAX * 0x1000) && (iBatchStride <= VMM_READAHEAD_STRIDE_MAX * 0x1000);
+    pSet = &ctxVmm->ReadAhead.Set[(paFirst >> VMM_READAHEAD_SET_SHIFT) & (VMM_READAHEAD_SETS - 1)];
+    AcquireSRWLockExclusive(&pSet->LockSRW);
+    // 2: find a matching stream.
+    sLRU = &pSet->S[0];
+    for(iS = 0; iS < VMM_READAHEAD_STREAMS; iS++) {
+        s = &pSet->S[iS];
+        if(s->qwTick < sLRU->qwTick) { sLRU = s; }
+        if(!s->dwId) { continue; }
+        d = (LONGLONG)(paFirst - s->paLast);
+        if(s->iStride) {
+            k = d / s->iStride;
+            if(!(d % s->iStride) && (k >= 1) && (k <= s->cWindow + 2)) { break; }
+        } else if(d && (d >= -VMM_READAHEAD_STRIDE_MAX * 0x1000) && (d <= VMM_READAHEAD_STRIDE_MAX * 0x1000)) {
+            // training stream - second miss establishes the stride.
+            s->iStride = d;
+            break;
+        }
+    }
+    if(iS == VMM_READAHEAD_STREAMS) {
+        // 3: no match -> replace the least recently used stream.
+        s = sLRU;
+        s->dwId = (InterlockedIncrement(&ctxVmm->ReadAhead.cGeneration) << 8) | ((DWORD)(pSet - ctxVmm->ReadAhead.Set) << 4) | (DWORD)(s - pSet->S);
+        s->iStride = fBatchStride ? iBatchStride : 0;
+        s->cWindow = max(VMM_READAHEAD_WINDOW_MIN, min(cMiss, VMM_READAHEAD_WINDOW_MAX));
+        s->cIssued = 0;
+        s->cUsed = 0;
+    } else if(fBatchStride && (iBatchStride != s->iStride)) {
+        // stream changed its stride -> restart with a small window.
+        s->iStride = iBatchStride;
+        s->cWindow = VMM_READAHEAD_WINDOW_MIN;
+        s->cIssued = 0;
+        s->cUsed = 0;
+    } else if(s->cIssued >= s->cWindow) {
+        // 4: adjust window depending on how much of the read-ahead was used.
+        if(4 * s->cUsed >= 3 * s->cIssued) {
+            s->cWindow = min(2 * s->cWindow, VMM_READAHEAD_WINDOW_MAX);
+        } else if(4 * s->cUsed < s->cIssued) {
+            s->cWindow = max(VMM_READAHEAD_WINDOW_MIN, s->cWindow / 2);
+        }
+        s->cIssued = 0;
+        s->cUsed = 0;
+    }
+    s->paLast = paLast;
+    s->qwTick = ++pSet->qwTick;
+    if((iStride = s->iStride)) {
+        cWindow = min(s->cWindow, ctxVmm->Cache.PHYS.cMax / 8);
+    }
+    *pdwId = dwId = s->dwId;
+    ReleaseSRWLockExclusive(&pSet->LockSRW);
+    // 5: collect the read-ahead addresses which are not already cached.
+    for(i = 1, qwA = paLast; i <= cWindow; i++) {
+        qwA += iStride;
+        if((qwA >= ctxMain->dev.paMax) || ((iStride < 0) ? (qwA > paLast) : (qwA < paLast))) { break; }
+        if(!VmmCacheExists(VMM_CACHE_TAG_PHYS, qwA)) {
+            pqwA[cA++] = qwA;
+        }
+    }
+    if(cA && (s->dwId == dwId)) {
+        InterlockedAdd((PDWORD)&s->cIssued, cA);
+    }
+    return cA;
+}
+
+/*
+* Retrieve a physical page from the second tier (compressed) cache into the
+* caller supplied buffer and promote it into the first tier PHYS cache.
+* -- pa
+* -- pbPage
+* -- return
+*/
+_Success_(return)
+BOOL VmmCache_PromoteFromCache2(_In_ QWORD pa, _Out_writes_(0x1000) PBYTE pbPage)
+{
+    DWORD dwEpoch;
+    PVMMOB_CACHE_MEM pObReservedMEM;
+    if(!VmmCache2_Take(&ctxVmm->Cache.PHYS, pa, pbPage, &dwEpoch)) { return FALSE; }
+    if((pObReservedMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
+        pObReservedMEM->h.f = TRUE;
+        pObReservedMEM->h.qwA = pa;
+        pObReservedMEM->dwEpoch = dwEpoch;
+        memcpy(pObReservedMEM->h.pb, pbPage, 0x1000);
+        VmmCache_ReserveReturnEx(pObReservedMEM, TRUE);
+    }
+    return TRUE;
+}
+
+/*
+* Put a successfully read physical page into the PHYS cache.
+* -- pMEM
+*/
+VOID VmmCache_PutPhysical(_In_ PMEM_SCATTER pMEM)
+{
+    PVMMOB_CACHE_MEM pObReservedMEM;
+    if((pObReservedMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
+        pObReservedMEM->h.f = TRUE;
+        pObReservedMEM->h.qwA = pMEM->qwA;
+        memcpy(pObReservedMEM->h.pb, pMEM->pb, 0x1000);
+        VmmCacheReserveReturn(pObReservedMEM);
+    }
+}
+
+/*
+* Read a run of physically contiguous pages with contiguous buffers with a
+* single contiguous device read. Pages of a successful read are set (f) and
+* are not read again by the subsequent scatter read. A failed contiguous read
+* does not tell which of its pages failed - the run is not re-probed but falls
+* back directly to the per-page scatter read which feeds the pages that fail
+* into the negative (PHYS_FAILED) cache.
+* -- ppMEMs
+* -- cMEMs
+*/
+VOID VmmReadScatterPhysical_DeviceRun(_Inout_updates_(cMEMs) PPMEM_SCATTER ppMEMs, _In_ DWORD cMEMs)
+{
+    DWORD i;
+    if(cMEMs < VMM_READ_COALESCE_MIN_PAGES) { return; }
+    if(LcRead(ctxMain->hLC, ppMEMs[0]->qwA, cMEMs << 12, ppMEMs[0]->pb)) {
+        for(i = 0; i < cMEMs; i++) {
+            ppMEMs[i]->f = TRUE;
+        }
+        InterlockedAdd64(&ctxVmm->stat.cPhysReadCoalesced, cMEMs);
+    }
+}
+
+/*
+* Read physical memory from the device. Runs of physically contiguous pages
+* with contiguous buffers (such as virtual reads backed by large pages or by
+* physically contiguous 4kB pages) are read with single contiguous device
+* reads. Remaining pages and pages which failed to read contiguously are read
+* with a scatter read; already read pages (f) are skipped by the device.
+* -- ppMEMs
+* -- cMEMs
+*/
+VOID VmmReadScatterPhysical_Device(_Inout_updates_(cMEMs) PPMEM_SCATTER ppMEMs, _In_ DWORD cMEMs)
+{
+    DWORD i, j;
+    PMEM_SCATTER pMEM, pMEMPrev;
+    for(i = 0; i < cMEMs; i = j) {
+        pMEM = ppMEMs[i];
+        j = i + 1;
+        if(pMEM->f || (pMEM->cb != 0x1000) || (pMEM->qwA & 0xfff) || !MEM_SCATTER_ADDR_ISVALID(pMEM)) { continue; }
+        for(; (j < cMEMs) && (j - i < VMM_READ_COALESCE_MAX_PAGES); j++) {
+            pMEMPrev = ppMEMs[j - 1];
+            pMEM = ppMEMs[j];
+            if(pMEM->f || (pMEM->cb != 0x1000) || (pMEM->qwA != pMEMPrev->qwA + 0x1000) || (pMEM->pb != pMEMPrev->pb + 0x1000)) { break; }
+        }
+        VmmReadScatterPhysical_DeviceRun(ppMEMs + i, j - i);
     }
-    if(fProcessMagicHandle) { Ob_DECREF(pProcess); }
+    LcReadScatter(ctxMain->hLC, cMEMs, ppMEMs);
 }
 
 VOID VmmReadScatterPhysical(_Inout_ PPMEM_SCATTER ppMEMsPhys, _In_ DWORD cpMEMsPhys, _In_ QWORD flags)
 {
-    QWORD tp;   // 0 = normal, 1 = already read, 2 = cache hit, 3 = speculative read
-    BOOL fCache, fCacheRecent;
+    QWORD tp;   // 0 = normal, 1 = already read, 2 = cache hit, 3 = already finished, 4 = known fail, 5 = in-flight wait
+    BOOL fCache, fInflight, fWait;
+    DWORD dwMaxAge, iSlot;
     PMEM_SCATTER pMEM;
-    DWORD i, c, cSpeculative;
-    PVMMOB_CACHE_MEM pObCacheEntry, pObReservedMEM;
-    PMEM_SCATTER ppMEMsSpeculative[0x18];
-    PVMMOB_CACHE_MEM ppObCacheSpeculative[0x18];
+    DWORD i, c, cReadAhead = 0, dwReadAheadId = 0, cWait = 0;
+    DWORD piWaitStack[VMM_READ_INFLIGHT_WAIT_STACK];
+    PDWORD piWait = (cpMEMsPhys <= VMM_READ_INFLIGHT_WAIT_STACK) ? piWaitStack : NULL;
+    QWORD pqwReadAhead[VMM_READAHEAD_WINDOW_MAX];
+    PVMMOB_CACHE_MEM pObCacheEntry;
+    PPMEM_SCATTER ppMEMsAll = NULL;
+    PPVMMOB_CACHE_MEM ppObReadAhead = NULL;
     fCache = !(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags));
-    fCacheRecent = fCache && (VMM_FLAG_CACHE_RECENT_ONLY & flags);
+    fInflight = fCache && !(flags & (VMM_FLAG_FORCECACHE_READ | VMM_FLAG_NOCACHEPUT));
+    dwMaxAge = VMM_CACHE_MAXAGE(flags);
     // 1: cache read
     if(fCache) {
-        c = 0, cSpeculative = 0;
+        c = 0;
         for(i = 0; i < cpMEMsPhys; i++) {
             pMEM = ppMEMsPhys[i];
             if(pMEM->f) {
@@ -1457,72 +3592,149 @@ VOID VmmReadScatterPhysical(_Inout_ PPMEM_SCATTER ppMEMsPhys, _In_ DWORD cpMEMsP
                 continue;
             }
             // retrieve from cache (if found)
-            if((pMEM->cb == 0x1000) && (pObCacheEntry = VmmCacheGetEx(VMM_CACHE_TAG_PHYS, pMEM->qwA, fCacheRecent))) {
+            if((pMEM->cb == 0x1000) && (pObCacheEntry = VmmCacheGetEx(VMM_CACHE_TAG_PHYS, pMEM->qwA, dwMaxAge))) {
                 // in cache - copy data into requester and set as completed!
                 MEM_SCATTER_STACK_PUSH(pMEM, 2);    // 2: cache read
                 pMEM->f = TRUE;
                 memcpy(pMEM->pb, pObCacheEntry->pb, 0x1000);
+                VmmReadAhead_Used(pObCacheEntry);
                 Ob_DECREF(pObCacheEntry);
                 InterlockedIncrement64(&ctxVmm->stat.cPhysCacheHit);
                 c++;
                 continue;
             }
-            MEM_SCATTER_STACK_PUSH(pMEM, 1);        // 1: normal read
-            // add to potential speculative read map if read is small enough...
-            if(cSpeculative < 0x18) {
-                ppMEMsSpeculative[cSpeculative++] = pMEM;
+            // retrieve from second tier (compressed) cache and promote (if found)
+            if((pMEM->cb == 0x1000) && dwMaxAge && VmmCache_PromoteFromCache2(pMEM->qwA, pMEM->pb)) {
+                MEM_SCATTER_STACK_PUSH(pMEM, 2);    // 2: cache read
+                pMEM->f = TRUE;
+                c++;
+                continue;
+            }
+            // known to fail (negative cache) -> hide address from the device read
+            if(VmmCacheFail_Exists(pMEM->qwA)) {
+                MEM_SCATTER_STACK_PUSH(pMEM, pMEM->qwA);
+                MEM_SCATTER_STACK_PUSH(pMEM, 4);    // 4: known fail
+                pMEM->qwA = MEM_SCATTER_ADDR_INVALID;
+                InterlockedIncrement64(&ctxVmm->stat.cPhysReadFailCacheHit);
+                c++;
+                continue;
+            }
+            // being read by another thread -> hide address and wait after the read
+            iSlot = VMM_CACHE_INFLIGHT_NONE;
+            if(fInflight && (pMEM->cb == 0x1000) && (piWait || (piWait = LocalAlloc(0, cpMEMsPhys * sizeof(DWORD))))) {
+                iSlot = VmmCacheInflight_Begin(VMM_CACHE_TAG_PHYS, pMEM->qwA, &fWait);
+                if(fWait) {
+                    MEM_SCATTER_STACK_PUSH(pMEM, pMEM->qwA);
+                    MEM_SCATTER_STACK_PUSH(pMEM, iSlot);
+                    MEM_SCATTER_STACK_PUSH(pMEM, 5);    // 5: in-flight wait
+                    pMEM->qwA = MEM_SCATTER_ADDR_INVALID;
+                    piWait[cWait++] = i;
+                    continue;
+                }
             }
+            MEM_SCATTER_STACK_PUSH(pMEM, iSlot);
+            MEM_SCATTER_STACK_PUSH(pMEM, 1);        // 1: normal read
         }
         // all found in cache _OR_ only cached reads allowed -> restore mem stack and return!
         if((c == cpMEMsPhys) || (VMM_FLAG_FORCECACHE_READ & flags)) {
             for(i = 0; i < cpMEMsPhys; i++) {
-                MEM_SCATTER_STACK_POP(ppMEMsPhys[i]);
+                pMEM = ppMEMsPhys[i];
+                tp = MEM_SCATTER_STACK_POP(pMEM);
+                if(tp == 1) {
+                    MEM_SCATTER_STACK_POP(pMEM);
+                } else if(tp == 4) {
+                    pMEM->qwA = MEM_SCATTER_STACK_POP(pMEM);
+                    InterlockedIncrement64(&ctxVmm->stat.cPhysReadFail);
+                    if((flags & VMM_FLAG_ZEROPAD_ON_FAIL) && (pMEM->qwA < ctxMain->dev.paMax)) {
+                        ZeroMemory(pMEM->pb, pMEM->cb);
+                        pMEM->f = TRUE;
+                    }
+                }
             }
             return;
         }
     }
-    // 2: speculative future read if negligible performance loss
-    if(fCache && cSpeculative && (cSpeculative < 0x18) && !(flags & VMMDLL_FLAG_NO_PREDICTIVE_READ)) {
-        for(i = 0; i < cpMEMsPhys; i++) {
-            pMEM = ppMEMsPhys[i];
-            if(1 != MEM_SCATTER_STACK_PEEK(pMEM, 1)) {
-                MEM_SCATTER_STACK_POP(pMEM);
-            }
-        }
-        while(cSpeculative < 0x18) {
-            if((ppObCacheSpeculative[cSpeculative] = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
-                pMEM = ppMEMsSpeculative[cSpeculative] = &ppObCacheSpeculative[cSpeculative]->h;
-                MEM_SCATTER_STACK_PUSH(pMEM, 4);
-                pMEM->f = FALSE;
-                pMEM->qwA = ((QWORD)ppMEMsSpeculative[cSpeculative - 1]->qwA & ~0xfff) + 0x1000;
-                cSpeculative++;
+    // 2: read-ahead into the cache if the misses continue a detected access
+    //    stream - the read-ahead pages are read in the same device batch.
+    if(fCache && !(flags & (VMMDLL_FLAG_NO_PREDICTIVE_READ | VMM_FLAG_NOCACHEPUT)) && (cReadAhead = VmmReadAhead_Plan(ppMEMsPhys, cpMEMsPhys, pqwReadAhead, &dwReadAheadId))) {
+        if((ppMEMsAll = LocalAlloc(0, (cpMEMsPhys + cReadAhead) * sizeof(PMEM_SCATTER) + cReadAhead * sizeof(PVMMOB_CACHE_MEM)))) {
+            ppObReadAhead = (PPVMMOB_CACHE_MEM)(ppMEMsAll + cpMEMsPhys + cReadAhead);
+            memcpy(ppMEMsAll, ppMEMsPhys, cpMEMsPhys * sizeof(PMEM_SCATTER));
+            for(i = 0, c = 0; i < cReadAhead; i++) {
+                if(VmmCacheFail_Exists(pqwReadAhead[i])) { continue; }
+                if(!(ppObReadAhead[c] = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { break; }
+                ppObReadAhead[c]->h.qwA = pqwReadAhead[i];
+                ppMEMsAll[cpMEMsPhys + c] = &ppObReadAhead[c]->h;
+                c++;
             }
+            cReadAhead = c;
+            InterlockedAdd64(&ctxVmm->stat.cPhysReadAhead, cReadAhead);
+        } else {
+            cReadAhead = 0;
         }
-        ppMEMsPhys = ppMEMsSpeculative;
-        cpMEMsPhys = cSpeculative;
     }
     // 3: read!
-    LcReadScatter(ctxMain->hLC, cpMEMsPhys, ppMEMsPhys);
+    if(cReadAhead) {
+        VmmReadScatterPhysical_Device(ppMEMsAll, cpMEMsPhys + cReadAhead);
+    } else {
+        VmmReadScatterPhysical_Device(ppMEMsPhys, cpMEMsPhys);
+    }
     // 4: cache put
     if(fCache) {
         for(i = 0; i < cpMEMsPhys; i++) {
             pMEM = ppMEMsPhys[i];
-            tp = MEM_SCATTER_STACK_POP(pMEM);
+            tp = MEM_SCATTER_STACK_PEEK(pMEM, 1);
+            if(tp == 5) { continue; }                                       // 5 = in-flight wait (below)
+            MEM_SCATTER_STACK_POP(pMEM);
+            if(tp == 4) {                                                   // 4 = known fail
+                pMEM->qwA = MEM_SCATTER_STACK_POP(pMEM);
+                continue;
+            }
+            if(tp != 1) { continue; }                                       // 1 = normal read
+            iSlot = (DWORD)MEM_SCATTER_STACK_POP(pMEM);
             if(!(VMM_FLAG_NOCACHEPUT & flags)) {
-                if(tp == 4) {   // 4 == speculative & backed by cache reserved
-                    VmmCacheReserveReturn(ppObCacheSpeculative[i]);
-                }
-                if((tp == 1) && pMEM->f) { // 1 = normal read
-                    if((pObReservedMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
-                        pObReservedMEM->h.f = TRUE;
-                        pObReservedMEM->h.qwA = pMEM->qwA;
-                        memcpy(pObReservedMEM->h.pb, pMEM->pb, 0x1000);
-                        VmmCacheReserveReturn(pObReservedMEM);
-                    }
+                if(pMEM->f) {
+                    VmmCache_PutPhysical(pMEM);
+                } else if(MEM_SCATTER_ADDR_ISVALID(pMEM)) {
+                    VmmCacheFail_Add(pMEM->qwA);
                 }
             }
+            VmmCacheInflight_End(iSlot);
+        }
+        for(i = 0; i < cReadAhead; i++) {
+            if(!ppObReadAhead[i]->h.f) {
+                VmmCacheFail_Add(ppObReadAhead[i]->h.qwA);
+            }
+            ppObReadAhead[i]->dwReadAheadId = dwReadAheadId;
+            VmmCacheReserveReturn(ppObReadAhead[i]);
+        }
+    }
+    LocalFree(ppMEMsAll);
+    // 4.1: pages read by other threads - retrieve from cache or read on fail.
+    //      NB! all in-flight reads owned by this thread must be ended first.
+    for(i = 0; i < cWait; i++) {
+        pMEM = ppMEMsPhys[piWait[i]];
+        MEM_SCATTER_STACK_POP(pMEM);
+        VmmCacheInflight_Wait((DWORD)MEM_SCATTER_STACK_POP(pMEM));
+        pMEM->qwA = MEM_SCATTER_STACK_POP(pMEM);
+        if((pObCacheEntry = VmmCacheGetEx(VMM_CACHE_TAG_PHYS, pMEM->qwA, dwMaxAge))) {
+            pMEM->f = TRUE;
+            memcpy(pMEM->pb, pObCacheEntry->pb, 0x1000);
+            Ob_DECREF(pObCacheEntry);
+            InterlockedIncrement64(&ctxVmm->stat.cCacheMissCoalesced);
+            continue;
+        }
+        if(VmmCacheFail_Exists(pMEM->qwA)) { continue; }
+        LcReadScatter(ctxMain->hLC, 1, &pMEM);
+        if(pMEM->f) {
+            VmmCache_PutPhysical(pMEM);
+        } else {
+            VmmCacheFail_Add(pMEM->qwA);
         }
     }
+    if(piWait != piWaitStack) {
+        LocalFree(piWait);
+    }
     // 5: statistics and read fail zero fixups (if required)
     for(i = 0; i < cpMEMsPhys; i++) {
         pMEM = ppMEMsPhys[i];
@@ -1540,38 +3752,63 @@ VOID VmmReadScatterPhysical(_Inout_ PPMEM_SCATTER ppMEMsPhys, _In_ DWORD cpMEMsP
     }
 }
 
-VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _In_ QWORD flags)
+/*
+* Prefetch the page tables required to translate the not already translated
+* addresses of a virtual scatter batch - level by level for the whole batch -
+* instead of walking (and possibly reading) each address separately.
+* -- pProcess
+* -- ppMEMsVirt
+* -- cpMEMsVirt
+*/
+VOID VmmReadScatterVirtual_TlbPrefetch(_In_ PVMM_PROCESS pProcess, _In_reads_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt)
+{
+    DWORD i, cva = 0;
+    QWORD pa, va, vaLast = 0;
+    PQWORD pva;
+    if(!(pva = LocalAlloc(0, cpMEMsVirt * sizeof(QWORD)))) { return; }
+    for(i = 0; i < cpMEMsVirt; i++) {
+        if(ppMEMsVirt[i]->f || (ppMEMsVirt[i]->qwA == 0) || (ppMEMsVirt[i]->qwA == -1)) { continue; }
+        va = ppMEMsVirt[i]->qwA & ~0xfffULL;
+        if((va == vaLast) || VmmVirt2Phys_TlbLookup(pProcess, va, &pa)) { continue; }
+        pva[cva++] = vaLast = va;
+    }
+    if(cva > 1) {
+        ctxVmm->fnMemoryModel.pfnTlbPrefetchVirt2Phys(pProcess, cva, pva);
+    }
+    LocalFree(pva);
+}
+
+/*
+* Translate the virtual addresses of a virtual scatter batch into physical
+* scatter entries (paged memory is read directly). This is the loop body shared
+* by the generic and the memory model specialized translate functions below;
+* with tp being a compile time constant the software tlb lookup and the page
+* table walk are resolved without function table dispatch per page. Pages that
+* follow a page translated through a large page (2MB/4MB/1GB) are translated
+* arithmetically from the large page without any tlb lookup.
+* If the memory model supports it paged memory is collected at the top of the
+* ppMEMsPhys buffer and resolved in one batch (pfnPagedReadScatter) once all
+* pages are translated - allowing for batched reads of compressed memory.
+* -- tp = memory model or VMM_MEMORYMODEL_NA for generic dispatch.
+* -- pProcess
+* -- ppMEMsVirt
+* -- cpMEMsVirt
+* -- ppMEMsPhys = receives pointers to the physical scatter entries.
+* -- pMEMsPhys = backing storage for the physical scatter entries.
+* -- flags = VMM_FLAG_*
+* -- return = number of physical scatter entries in ppMEMsPhys.
+*/
+static __forceinline DWORD VmmReadScatterVirtual_TranslateTp(_In_ VMM_MEMORYMODEL_TP tp, _In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags)
 {
-    // NB! the buffers pIoPA / ppMEMsPhys are used for both:
-    //     - physical memory (grows from 0 upwards)
-    //     - paged memory (grows from top downwards).
     BOOL fVirt2Phys;
-    DWORD i = 0, iVA, iPA;
-    QWORD qwPA, qwPagedPA = 0;
-    BYTE pbBufferSmall[0x20 * (sizeof(MEM_SCATTER) + sizeof(PMEM_SCATTER))];
-    PBYTE pbBufferMEMs, pbBufferLarge = NULL;
+    BYTE iShift;
+    DWORD iVA, iPA, iPaged, cPaged = 0;
+    QWORD qwPA, qwPagedPA = 0, vaLarge = 0, paLarge = 0, qwLargeMask = 0;
     PMEM_SCATTER pIoPA, pIoVA;
-    PPMEM_SCATTER ppMEMsPhys = NULL;
     BOOL fPaging = !(VMM_FLAG_NOPAGING & (flags | ctxVmm->flags));
+    BOOL fPagingScatter = fPaging && ctxVmm->fnMemoryModel.pfnPagedReadScatter;
     BOOL fAltAddrPte = VMM_FLAG_ALTADDR_VA_PTE & flags;
     BOOL fZeropadOnFail = VMM_FLAG_ZEROPAD_ON_FAIL & (flags | ctxVmm->flags);
-    BOOL fProcessMagicHandle = ((SIZE_T)pProcess >= PROCESS_MAGIC_HANDLE_THRESHOLD);
-    // 0: 'magic' process handle
-    if(fProcessMagicHandle && !(pProcess = VmmProcessGet((DWORD)(0-(SIZE_T)pProcess)))) { return; }
-    // 1: allocate / set up buffers (if needed)
-    if(cpMEMsVirt < 0x20) {
-        ZeroMemory(pbBufferSmall, sizeof(pbBufferSmall));
-        ppMEMsPhys = (PPMEM_SCATTER)pbBufferSmall;
-        pbBufferMEMs = pbBufferSmall + cpMEMsVirt * sizeof(PMEM_SCATTER);
-    } else {
-        if(!(pbBufferLarge = LocalAlloc(LMEM_ZEROINIT, cpMEMsVirt * (sizeof(MEM_SCATTER) + sizeof(PMEM_SCATTER))))) {
-            if(fProcessMagicHandle) { Ob_DECREF(pProcess); }
-            return;
-        }
-        ppMEMsPhys = (PPMEM_SCATTER)pbBufferLarge;
-        pbBufferMEMs = pbBufferLarge + cpMEMsVirt * sizeof(PMEM_SCATTER);
-    }
-    // 2: translate virt2phys
     for(iVA = 0, iPA = 0; iVA < cpMEMsVirt; iVA++) {
         pIoVA = ppMEMsVirt[iVA];
         // MEMORY READ ALREADY COMPLETED
@@ -1583,8 +3820,27 @@ VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVir
         }
         // PHYSICAL MEMORY
         qwPA = 0;
-        fVirt2Phys = !fAltAddrPte && VmmVirt2Phys(pProcess, pIoVA->qwA, &qwPA);
+        if(qwLargeMask && ((pIoVA->qwA & ~qwLargeMask) == vaLarge)) {
+            // same large page as a previous translation in this batch
+            qwPA = paLarge + (pIoVA->qwA & qwLargeMask);
+            fVirt2Phys = TRUE;
+        } else {
+            iShift = 0;
+            fVirt2Phys = !fAltAddrPte && VmmVirt2Phys_Tp(tp, pProcess, pIoVA->qwA, &qwPA, &iShift);
+            if(fVirt2Phys && (iShift > 12) && (iShift < 64)) {
+                qwLargeMask = (1ULL << iShift) - 1;
+                vaLarge = pIoVA->qwA & ~qwLargeMask;
+                paLarge = qwPA & ~qwLargeMask;
+            }
+        }
         // PAGED MEMORY
+        if(!fVirt2Phys && fPagingScatter && (pIoVA->cb == 0x1000)) {
+            // defer to batch paged read below - pte is passed on the stack.
+            MEM_SCATTER_STACK_PUSH(pIoVA, (fAltAddrPte ? pIoVA->qwA : qwPA));
+            ppMEMsPhys[cpMEMsVirt - 1 - cPaged] = pIoVA;
+            cPaged++;
+            continue;
+        }
         if(!fVirt2Phys && fPaging && (pIoVA->cb == 0x1000) && ctxVmm->fnMemoryModel.pfnPagedRead) {
             if(ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, (fAltAddrPte ? 0 : pIoVA->qwA), (fAltAddrPte ? pIoVA->qwA : qwPA), pIoVA->pb, &qwPagedPA, NULL, flags)) {
                 pIoVA->f = TRUE;
@@ -1602,7 +3858,7 @@ VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVir
             continue;
         }
         // PHYS MEMORY
-        pIoPA = ppMEMsPhys[iPA] = (PMEM_SCATTER)pbBufferMEMs + iPA;
+        pIoPA = ppMEMsPhys[iPA] = pMEMsPhys + iPA;
         iPA++;
         pIoPA->version = MEM_SCATTER_VERSION;
         pIoPA->qwA = qwPA;
@@ -1611,6 +3867,88 @@ VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVir
         pIoPA->f = FALSE;
         MEM_SCATTER_STACK_PUSH(pIoPA, (QWORD)pIoVA);
     }
+    // PAGED MEMORY (BATCH)
+    // NB! physical entries are added from below the paged entries (iPA <= iPaged).
+    if(cPaged) {
+        ctxVmm->fnMemoryModel.pfnPagedReadScatter(pProcess, cPaged, ppMEMsPhys + cpMEMsVirt - cPaged, flags);
+        for(iPaged = cpMEMsVirt - cPaged; iPaged < cpMEMsVirt; iPaged++) {
+            pIoVA = ppMEMsPhys[iPaged];
+            qwPA = MEM_SCATTER_STACK_POP(pIoVA);
+            if(pIoVA->f) { continue; }
+            if(!qwPA) {
+                if(fZeropadOnFail) {
+                    ZeroMemory(pIoVA->pb, pIoVA->cb);
+                }
+                continue;
+            }
+            pIoPA = ppMEMsPhys[iPA] = pMEMsPhys + iPA;
+            iPA++;
+            pIoPA->version = MEM_SCATTER_VERSION;
+            pIoPA->qwA = qwPA;
+            pIoPA->cb = 0x1000;
+            pIoPA->pb = pIoVA->pb;
+            pIoPA->f = FALSE;
+            MEM_SCATTER_STACK_PUSH(pIoPA, (QWORD)pIoVA);
+        }
+    }
+    return iPA;
+}
+
+DWORD VmmReadScatterVirtual_TranslateX64(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags)
+{
+    return VmmReadScatterVirtual_TranslateTp(VMM_MEMORYMODEL_X64, pProcess, ppMEMsVirt, cpMEMsVirt, ppMEMsPhys, pMEMsPhys, flags);
+}
+
+DWORD VmmReadScatterVirtual_TranslateX86PAE(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags)
+{
+    return VmmReadScatterVirtual_TranslateTp(VMM_MEMORYMODEL_X86PAE, pProcess, ppMEMsVirt, cpMEMsVirt, ppMEMsPhys, pMEMsPhys, flags);
+}
+
+DWORD VmmReadScatterVirtual_TranslateX86(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags)
+{
+    return VmmReadScatterVirtual_TranslateTp(VMM_MEMORYMODEL_X86, pProcess, ppMEMsVirt, cpMEMsVirt, ppMEMsPhys, pMEMsPhys, flags);
+}
+
+DWORD VmmReadScatterVirtual_Translate(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags)
+{
+    return VmmReadScatterVirtual_TranslateTp(VMM_MEMORYMODEL_NA, pProcess, ppMEMsVirt, cpMEMsVirt, ppMEMsPhys, pMEMsPhys, flags);
+}
+
+VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _In_ QWORD flags)
+{
+    // NB! the buffers pIoPA / ppMEMsPhys are used for both:
+    //     - physical memory (grows from 0 upwards)
+    //     - paged memory (grows from top downwards).
+    DWORD iPA;
+    BYTE pbBufferSmall[0x20 * (sizeof(MEM_SCATTER) + sizeof(PMEM_SCATTER))];
+    PBYTE pbBufferMEMs, pbBufferLarge = NULL;
+    PPMEM_SCATTER ppMEMsPhys = NULL;
+    BOOL fAltAddrPte = VMM_FLAG_ALTADDR_VA_PTE & flags;
+    BOOL fProcessMagicHandle = ((SIZE_T)pProcess >= PROCESS_MAGIC_HANDLE_THRESHOLD);
+    // 0: 'magic' process handle
+    if(fProcessMagicHandle && !(pProcess = VmmProcessGet((DWORD)(0-(SIZE_T)pProcess)))) { return; }
+    // 1: allocate / set up buffers (if needed)
+    if(cpMEMsVirt < 0x20) {
+        ZeroMemory(pbBufferSmall, sizeof(pbBufferSmall));
+        ppMEMsPhys = (PPMEM_SCATTER)pbBufferSmall;
+        pbBufferMEMs = pbBufferSmall + cpMEMsVirt * sizeof(PMEM_SCATTER);
+    } else {
+        if(!(pbBufferLarge = LocalAlloc(LMEM_ZEROINIT, cpMEMsVirt * (sizeof(MEM_SCATTER) + sizeof(PMEM_SCATTER))))) {
+            if(fProcessMagicHandle) { Ob_DECREF(pProcess); }
+            return;
+        }
+        ppMEMsPhys = (PPMEM_SCATTER)pbBufferLarge;
+        pbBufferMEMs = pbBufferLarge + cpMEMsVirt * sizeof(PMEM_SCATTER);
+    }
+    // 2: prefetch page tables for the batch (if supported) and translate virt2phys
+    if(!fAltAddrPte && (cpMEMsVirt > 1) && ctxVmm->fnMemoryModel.pfnTlbPrefetchVirt2Phys && ctxVmm->Cache.TLB.fActive) {
+        VmmReadScatterVirtual_TlbPrefetch(pProcess, ppMEMsVirt, cpMEMsVirt);
+    }
+    if(ctxVmm->fnMemoryModel.pfnReadScatterVirtualTranslate) {
+        iPA = ctxVmm->fnMemoryModel.pfnReadScatterVirtualTranslate(pProcess, ppMEMsVirt, cpMEMsVirt, ppMEMsPhys, (PMEM_SCATTER)pbBufferMEMs, flags);
+    } else {
+        iPA = VmmReadScatterVirtual_Translate(pProcess, ppMEMsVirt, cpMEMsVirt, ppMEMsPhys, (PMEM_SCATTER)pbBufferMEMs, flags);
+    }
     // 3: read and check result
     if(iPA) {
         VmmReadScatterPhysical(ppMEMsPhys, iPA, flags);
@@ -1636,6 +3974,231 @@ VOID VmmVirt2PhysGetInformation(_Inout_ PVMM_PROCESS pProcess, _Inout_ PVMM_VIRT
     ctxVmm->fnMemoryModel.pfnVirt2PhysGetInformation(pProcess, pVirt2PhysInfo);
 }
 
+typedef struct tdVMM_PHYS2VIRT_INDEX_BUILD_CONTEXT {
+    DWORD dwPIDKernel;
+    POB_MAP pmExtent;               // ((PID << 32) | part) -> PVMMOB_MAP_EXTENT
+    POB_SET psPID;
+} VMM_PHYS2VIRT_INDEX_BUILD_CONTEXT, *PVMM_PHYS2VIRT_INDEX_BUILD_CONTEXT;
+
+VOID VmmPhys2VirtIndex_CallbackCleanup(PVMMOB_PHYS2VIRT_INDEX pOb)
+{
+    Ob_DECREF(pOb->psPID);
+    LocalFree(pOb->piPfnHead);
+    LocalFree(pOb->pEntry);
+}
+
+/*
+* Translate the address space of a single process into extents (parallel
+* action). On x64 kernel PML4 entries shared with the kernel DTB are skipped;
+* they're indexed once - by the kernel DTB process.
+* -- pProcess
+* -- ctxIn
+*/
+VOID VmmPhys2VirtIndex_Build_Action(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctxIn)
+{
+    QWORD iSlot, va;
+    PVMMOB_MAP_EXTENT pObExtent;
+    PVMM_PHYS2VIRT_INDEX_BUILD_CONTEXT ctx = (PVMM_PHYS2VIRT_INDEX_BUILD_CONTEXT)ctxIn;
+    if(!ctx || !ctxVmm->Work.fEnabled) { return; }
+    if(!ctx->dwPIDKernel || (pProcess->dwPID == ctx->dwPIDKernel) || pProcess->fUserOnly) {
+        if((pObExtent = VmmVirt2PhysRange(pProcess, 0, (QWORD)-1))) {
+            ObMap_Push(ctx->pmExtent, (QWORD)pProcess->dwPID << 32, pObExtent);
+            Ob_DECREF(pObExtent);
+        }
+    } else {
+        if((pObExtent = VmmVirt2PhysRange(pProcess, 0, 0x0000800000000000))) {
+            ObMap_Push(ctx->pmExtent, (QWORD)pProcess->dwPID << 32, pObExtent);
+            Ob_DECREF(pObExtent);
+        }
+        for(iSlot = 0; iSlot < 0x100; iSlot++) {
+            va = 0xffff800000000000 | (iSlot << 39);
+            if(VmmVirt2Phys_IsKernelShared(pProcess, va)) { continue; }
+            if((pObExtent = VmmVirt2PhysRange(pProcess, va, 1ULL << 39))) {
+                if(pObExtent->cMap) {
+                    ObMap_Push(ctx->pmExtent, ((QWORD)pProcess->dwPID << 32) | (1 + iSlot), pObExtent);
+                }
+                Ob_DECREF(pObExtent);
+            }
+        }
+    }
+    ObSet_Push(ctx->psPID, pProcess->dwPID);
+}
+
+/*
+* Build the reverse physical to virtual index from the page tables of all
+* active processes. The per-process page table walks are done in parallel, the
+* resulting hardware backed extents are then chained per pfn hash. The number
+* of hash chains is sized to the number of entries - not to physical memory.
+* -- return
+*/
+PVMMOB_PHYS2VIRT_INDEX VmmPhys2VirtIndex_Build()
+{
+    QWORD pfn, cPfn, cEntry = 0, cHead, qwKey, o, cb;
+    PVMM_MAP_EXTENTENTRY peX;
+    PVMM_PHYS2VIRT_INDEXENTRY pe;
+    PVMMOB_MAP_EXTENT pObExtent;
+    PVMM_PROCESS pObSystemProcess;
+    PVMMOB_PHYS2VIRT_INDEX pObIndex = NULL;
+    VMM_PHYS2VIRT_INDEX_BUILD_CONTEXT ctx = { 0 };
+    DWORD i;
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return NULL; }
+    cPfn = (ctxMain->dev.paMax >> 12) + 1;
+    if(cPfn > 0xffffffff) { return NULL; }
+    if(!(ctx.pmExtent = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) { goto fail; }
+    if(!(ctx.psPID = ObSet_New())) { goto fail; }
+    if((ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) && ctxVmm->kernel.paDTB && (pObSystemProcess = VmmProcessGet(4))) {
+        if((pObSystemProcess->paDTB == ctxVmm->kernel.paDTB) && !pObSystemProcess->fUserOnly) {
+            ctx.dwPIDKernel = pObSystemProcess->dwPID;
+        }
+        Ob_DECREF(pObSystemProcess);
+    }
+    // 1: translate the address spaces of all processes into extents (in parallel)
+    VmmTlbSpiderAll();
+    VmmProcessActionForeachParallel(&ctx, VmmProcessActionForeachParallel_CriteriaActiveOnly, VmmPhys2VirtIndex_Build_Action);
+    if(!ctxVmm->Work.fEnabled) { goto fail; }
+    // 2: allocate index
+    pObExtent = NULL;
+    while((pObExtent = ObMap_GetNext(ctx.pmExtent, pObExtent))) {
+        for(i = 0; i < pObExtent->cMap; i++) {
+            peX = pObExtent->pMap + i;
+            if((peX->tp == VMM_PTE_TP_HARDWARE) && (peX->pa <= ctxMain->dev.paMax)) {
+                cEntry += min(peX->cb, ctxMain->dev.paMax + 1 - peX->pa) >> 12;
+            }
+        }
+    }
+    cEntry = min(cEntry, VMM_PHYS2VIRT_INDEX_ENTRIES_MAX);
+    for(cHead = 1; (cHead < cEntry) && (cHead < cPfn); cHead <<= 1);
+    if(!(pObIndex = Ob_Alloc(OB_TAG_PHYS2VIRT_INDEX, LMEM_ZEROINIT, sizeof(VMMOB_PHYS2VIRT_INDEX), (OB_CLEANUP_CB)VmmPhys2VirtIndex_CallbackCleanup, NULL))) { goto fail; }
+    if(!(pObIndex->piPfnHead = LocalAlloc(LMEM_ZEROINIT, cHead * sizeof(DWORD)))) { goto fail; }
+    if(!(pObIndex->pEntry = LocalAlloc(0, max(1, cEntry) * sizeof(VMM_PHYS2VIRT_INDEXENTRY)))) { goto fail; }
+    pObIndex->dwHeadMask = (DWORD)(cHead - 1);
+    pObIndex->dwPIDKernel = ctx.dwPIDKernel;
+    pObIndex->psPID = Ob_INCREF(ctx.psPID);
+    // 3: chain each indexed page into its pfn
+    while((pObExtent = ObMap_PopWithKey(ctx.pmExtent, &qwKey))) {
+        for(i = 0; (i < pObExtent->cMap) && (pObIndex->cEntry < cEntry); i++) {
+            peX = pObExtent->pMap + i;
+            if((peX->tp != VMM_PTE_TP_HARDWARE) || (peX->pa > ctxMain->dev.paMax)) { continue; }
+            cb = min(peX->cb, ctxMain->dev.paMax + 1 - peX->pa);
+            for(o = 0; (o < cb) && (pObIndex->cEntry < cEntry); o += 0x1000) {
+                pfn = (peX->pa + o) >> 12;
+                pe = pObIndex->pEntry + pObIndex->cEntry;
+                pe->va = (peX->va + o) & ~0xfffULL;
+                pe->dwPID = (DWORD)(qwKey >> 32);
+                pe->pfn = (DWORD)pfn;
+                pe->iNext = pObIndex->piPfnHead[pfn & pObIndex->dwHeadMask];
+                pObIndex->piPfnHead[pfn & pObIndex->dwHeadMask] = ++pObIndex->cEntry;
+            }
+        }
+        Ob_DECREF(pObExtent);
+    }
+    Ob_DECREF(ctx.pmExtent);
+    Ob_DECREF(ctx.psPID);
+    return pObIndex;
+fail:
+    Ob_DECREF(pObIndex);
+    Ob_DECREF(ctx.pmExtent);
+    Ob_DECREF(ctx.psPID);
+    return NULL;
+}
+
+DWORD VmmPhys2VirtIndex_Build_ThreadProc(_In_opt_ LPVOID lpThreadParameter)
+{
+    PVMMOB_PHYS2VIRT_INDEX pObIndex;
+    DWORD dwGeneration = ctxVmm->Phys2VirtIndex.dwGeneration;
+    if(ctxVmm->Phys2VirtIndex.fEnabled && (pObIndex = VmmPhys2VirtIndex_Build())) {
+        pObIndex->dwGeneration = dwGeneration;
+        if(ctxVmm->Phys2VirtIndex.fEnabled) {
+            ObContainer_SetOb(ctxVmm->Phys2VirtIndex.pObC, pObIndex);
+        }
+        Ob_DECREF(pObIndex);
+    }
+    ctxVmm->Phys2VirtIndex.fBuilding = 0;
+    return 1;
+}
+
+/*
+* Start a background build of the index unless a build is already running or
+* the last build was started less than VMM_PHYS2VIRT_INDEX_REBUILD_MIN_MS ago.
+*/
+VOID VmmPhys2VirtIndex_BuildAsync()
+{
+    QWORD qwTick;
+    if(!ctxVmm->Phys2VirtIndex.fEnabled) { return; }
+    if(InterlockedCompareExchange((volatile LONG*)&ctxVmm->Phys2VirtIndex.fBuilding, 1, 0)) { return; }
+    qwTick = GetTickCount64();
+    if(ctxVmm->Phys2VirtIndex.qwTickBuild && (qwTick - ctxVmm->Phys2VirtIndex.qwTickBuild < VMM_PHYS2VIRT_INDEX_REBUILD_MIN_MS)) {
+        ctxVmm->Phys2VirtIndex.fBuilding = 0;
+        return;
+    }
+    ctxVmm->Phys2VirtIndex.qwTickBuild = qwTick;
+    if(!VmmWork((LPTHREAD_START_ROUTINE)VmmPhys2VirtIndex_Build_ThreadProc, NULL, 0)) {
+        ctxVmm->Phys2VirtIndex.fBuilding = 0;
+    }
+}
+
+VOID VmmPhys2VirtIndex_Refresh()
+{
+    InterlockedIncrement(&ctxVmm->Phys2VirtIndex.dwGeneration);
+}
+
+PVMMOB_PHYS2VIRT_INDEX VmmPhys2VirtIndex_Get()
+{
+    PVMMOB_PHYS2VIRT_INDEX pObIndex;
+    if(!ctxVmm->Phys2VirtIndex.fEnabled) { return NULL; }
+    pObIndex = ObContainer_GetOb(ctxVmm->Phys2VirtIndex.pObC);
+    if(pObIndex && (pObIndex->dwGeneration == ctxVmm->Phys2VirtIndex.dwGeneration)) {
+        return pObIndex;
+    }
+    Ob_DECREF(pObIndex);
+    VmmPhys2VirtIndex_BuildAsync();
+    return NULL;
+}
+
+/*
+* Retrieve the virtual addresses of a process mapping the target physical
+* address from the reverse index. The lowest addresses are kept - the same
+* result as a walk of the process page tables.
+* -- pProcess
+* -- pP2V
+* -- return = FALSE if no current (non-stale) index exists or if the process isn't indexed.
+*/
+_Success_(return)
+BOOL VmmPhys2VirtIndex_GetInformation(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMOB_PHYS2VIRT_INFORMATION pP2V)
+{
+    QWORD va, pfn;
+    DWORD i, j, iEntry;
+    BOOL fKernelShared;
+    PVMM_PHYS2VIRT_INDEXENTRY pe;
+    PVMMOB_PHYS2VIRT_INDEX pObIndex;
+    if(!(pObIndex = VmmPhys2VirtIndex_Get())) { return FALSE; }
+    if(!ObSet_Exists(pObIndex->psPID, pProcess->dwPID)) {
+        Ob_DECREF(pObIndex);
+        return FALSE;
+    }
+    pfn = pP2V->paTarget >> 12;
+    fKernelShared = pObIndex->dwPIDKernel && (pObIndex->dwPIDKernel != pProcess->dwPID) && !pProcess->fUserOnly;
+    iEntry = (pfn <= 0xffffffff) ? pObIndex->piPfnHead[pfn & pObIndex->dwHeadMask] : 0;
+    while(iEntry) {
+        pe = pObIndex->pEntry + iEntry - 1;
+        iEntry = pe->iNext;
+        if(pe->pfn != pfn) { continue; }
+        if(pe->dwPID != pProcess->dwPID) {
+            if(!fKernelShared || (pe->dwPID != pObIndex->dwPIDKernel) || !VmmVirt2Phys_IsKernelShared(pProcess, pe->va)) { continue; }
+        }
+        va = pe->va | (pP2V->paTarget & 0xfff);
+        for(i = 0; (i < pP2V->cvaList) && (pP2V->pvaList[i] < va); i++);
+        if(i == VMM_PHYS2VIRT_INFORMATION_MAX_PROCESS_RESULT) { continue; }
+        for(j = min(pP2V->cvaList, VMM_PHYS2VIRT_INFORMATION_MAX_PROCESS_RESULT - 1); j > i; j--) {
+            pP2V->pvaList[j] = pP2V->pvaList[j - 1];
+        }
+        pP2V->pvaList[i] = va;
+        pP2V->cvaList = min(pP2V->cvaList + 1, VMM_PHYS2VIRT_INFORMATION_MAX_PROCESS_RESULT);
+    }
+    Ob_DECREF(pObIndex);
+    return TRUE;
+}
+
 /*
 * Retrieve information of the physical2virtual address translation for the
 * supplied process. This function may take time on larger address spaces -
@@ -1667,7 +4230,9 @@ PVMMOB_PHYS2VIRT_INFORMATION VmmPhys2VirtGetInformation(_In_ PVMM_PROCESS pProce
             pObP2V = Ob_Alloc('PAVA', LMEM_ZEROINIT, sizeof(VMMOB_PHYS2VIRT_INFORMATION), NULL, NULL);
             pObP2V->paTarget = paTarget;
             pObP2V->dwPID = pProcess->dwPID;
-            if(ctxVmm->fnMemoryModel.pfnPhys2VirtGetInformation) {
+            if(VmmPhys2VirtIndex_GetInformation(pProcess, pObP2V)) {
+                ObContainer_SetOb(pProcess->Plugin.pObCPhys2Virt, pObP2V);
+            } else if(ctxVmm->fnMemoryModel.pfnPhys2VirtGetInformation) {
                 ctxVmm->fnMemoryModel.pfnPhys2VirtGetInformation(pProcess, pObP2V);
                 ObContainer_SetOb(pProcess->Plugin.pObCPhys2Virt, pObP2V);
             }
@@ -1710,8 +4275,10 @@ VOID VmmClose()
     VmmCacheClose(VMM_CACHE_TAG_PHYS);
     VmmCacheClose(VMM_CACHE_TAG_TLB);
     VmmCacheClose(VMM_CACHE_TAG_PAGING);
+    VmmCacheInflight_Close();
     Ob_DECREF_NULL(&ctxVmm->Cache.PAGING_FAILED);
     Ob_DECREF_NULL(&ctxVmm->Cache.pmPrototypePte);
+    Ob_DECREF_NULL(&ctxVmm->Phys2VirtIndex.pObC);
     Ob_DECREF_NULL(&ctxVmm->pObCMapPhysMem);
     Ob_DECREF_NULL(&ctxVmm->pObCMapEvil);
     Ob_DECREF_NULL(&ctxVmm->pObCMapUser);
@@ -1982,6 +4549,149 @@ BOOL VmmReadPage(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(40
     return cb == 0x1000;
 }
 
+/*
+* Pin a single physical page - retrieve it from the cache or read it from the
+* device into the cache.
+* CALLER DECREF: return
+* -- pa
+* -- flags
+* -- return
+*/
+PVMMOB_CACHE_MEM VmmReadPin_Physical(_In_ QWORD pa, _In_ QWORD flags)
+{
+    BOOL fWait;
+    DWORD iSlot = VMM_CACHE_INFLIGHT_NONE;
+    PMEM_SCATTER pMEM;
+    PVMMOB_CACHE_MEM pObMEM, pObMEMInflight;
+    BOOL fCache = !(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags));
+    DWORD dwMaxAge = VMM_CACHE_MAXAGE(flags);
+    if(fCache && (pObMEM = VmmCacheGetEx(VMM_CACHE_TAG_PHYS, pa, dwMaxAge))) {
+        VmmReadAhead_Used(pObMEM);
+        InterlockedIncrement64(&ctxVmm->stat.cPhysCacheHit);
+        return pObMEM;
+    }
+    if(fCache && VmmCacheFail_Exists(pa)) {
+        InterlockedIncrement64(&ctxVmm->stat.cPhysReadFailCacheHit);
+        InterlockedIncrement64(&ctxVmm->stat.cPhysReadFail);
+        return NULL;
+    }
+    if(!(pObMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { return NULL; }
+    pMEM = &pObMEM->h;
+    pMEM->qwA = pa;
+    // second tier (compressed) cache - same max age rule as VmmReadScatterPhysical.
+    if(fCache && dwMaxAge && VmmCache2_Take(&ctxVmm->Cache.PHYS, pa, pObMEM->pb, &pObMEM->dwEpoch)) {
+        pMEM->f = TRUE;
+        Ob_INCREF(pObMEM);
+        VmmCache_ReserveReturnEx(pObMEM, TRUE);
+        return pObMEM;
+    }
+    if(fCache && (VMM_FLAG_FORCECACHE_READ & flags)) {
+        VmmCacheReserveReturn(pObMEM);
+        return NULL;
+    }
+    // wait for a concurrent read of the same page (if any)
+    if(fCache && !(VMM_FLAG_NOCACHEPUT & flags)) {
+        iSlot = VmmCacheInflight_Begin(VMM_CACHE_TAG_PHYS, pa, &fWait);
+        if(fWait) {
+            VmmCacheInflight_Wait(iSlot);
+            iSlot = VMM_CACHE_INFLIGHT_NONE;
+            if((pObMEMInflight = VmmCacheGetEx(VMM_CACHE_TAG_PHYS, pa, dwMaxAge))) {
+                InterlockedIncrement64(&ctxVmm->stat.cCacheMissCoalesced);
+                VmmCacheReserveReturn(pObMEM);
+                return pObMEMInflight;
+            }
+        }
+    }
+    LcReadScatter(ctxMain->hLC, 1, &pMEM);
+    if(pObMEM->h.f) {
+        InterlockedIncrement64(&ctxVmm->stat.cPhysReadSuccess);
+        if(fCache && !(VMM_FLAG_NOCACHEPUT & flags)) {
+            Ob_INCREF(pObMEM);
+            VmmCacheReserveReturn(pObMEM);
+        }
+        VmmCacheInflight_End(iSlot);
+        return pObMEM;
+    }
+    InterlockedIncrement64(&ctxVmm->stat.cPhysReadFail);
+    if(fCache && !(VMM_FLAG_NOCACHEPUT & flags)) {
+        VmmCacheFail_Add(pa);
+    }
+    VmmCacheInflight_End(iSlot);
+    if((flags & VMM_FLAG_ZEROPAD_ON_FAIL) && (pa < ctxMain->dev.paMax)) {
+        // zero padded page - private to caller, not inserted into the cache.
+        ZeroMemory(pObMEM->pb, 0x1000);
+        pObMEM->h.qwA = MEM_SCATTER_ADDR_INVALID;
+        return pObMEM;
+    }
+    VmmCacheReserveReturn(pObMEM);
+    return NULL;
+}
+
+/*
+* Pin a single page of memory, physical or virtual, for zero-copy read-only
+* access. The page data is available in pb (0x1000 bytes) of the returned
+* object and remains valid and unchanged until the object is DECREF'ed.
+* Pinned pages should be released as soon as possible since they cannot be
+* recycled by the cache while pinned.
+* Virtual memory is read if a process is specified in pProcess.
+* Physical memory is read if NULL is specified in pProcess.
+* NB! the page data must never be written to!
+* CALLER DECREF: return
+* -- pProcess = NULL=='physical memory read', PTR=='virtual memory read'
+* -- qwA = address within the page to pin.
+* -- flags = flags as in VMM_FLAG_*
+* -- return = the pinned page, or NULL on fail.
+*/
+PVMMOB_CACHE_MEM VmmReadPin(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ QWORD flags)
+{
+    QWORD pa = 0, paPaged = 0;
+    PVMMOB_CACHE_MEM pObMEM = NULL;
+    BOOL fProcessMagicHandle = ((SIZE_T)pProcess >= PROCESS_MAGIC_HANDLE_THRESHOLD);
+    qwA &= ~0xfff;
+    if(!pProcess) {
+        return VmmReadPin_Physical(qwA, flags);
+    }
+    if(fProcessMagicHandle && !(pProcess = VmmProcessGet((DWORD)(0 - (SIZE_T)pProcess)))) { return NULL; }
+    if(VmmVirt2Phys(pProcess, qwA, &pa)) {
+        pObMEM = VmmReadPin_Physical(pa, flags);
+        goto finish;
+    }
+    // paged memory - read into a private (non-inserted) cache entry.
+    if(!(VMM_FLAG_NOPAGING & (flags | ctxVmm->flags)) && ctxVmm->fnMemoryModel.pfnPagedRead) {
+        if(!(pObMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { goto finish; }
+        if(ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, qwA, pa, pObMEM->pb, &paPaged, NULL, flags)) {
+            pObMEM->h.f = TRUE;
+            goto finish;
+        }
+        Ob_DECREF_NULL(&pObMEM);
+        if(paPaged) {
+            pObMEM = VmmReadPin_Physical(paPaged, flags);
+            goto finish;
+        }
+    }
+    if(VMM_FLAG_ZEROPAD_ON_FAIL & (flags | ctxVmm->flags)) {
+        if((pObMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
+            ZeroMemory(pObMEM->pb, 0x1000);
+        }
+    }
+finish:
+    if(fProcessMagicHandle) { Ob_DECREF(pProcess); }
+    return pObMEM;
+}
+
+_Success_(return != NULL)
+PBYTE VmmReadPinEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ DWORD cb, _In_ QWORD flags, _Out_writes_(cb) PBYTE pbBuffer, _Out_ PPVMMOB_CACHE_MEM ppObPin)
+{
+    DWORD cbRead;
+    *ppObPin = NULL;
+    if(cb && ((qwA & 0xfff) + cb <= 0x1000)) {
+        if(!(*ppObPin = VmmReadPin(pProcess, qwA, flags))) { return NULL; }
+        return (*ppObPin)->pb + (qwA & 0xfff);
+    }
+    VmmReadEx(pProcess, qwA, pbBuffer, cb, &cbRead, flags);
+    return (cbRead == cb) ? pbBuffer : NULL;
+}
+
 VOID VmmInitializeMemoryModel(_In_ VMM_MEMORYMODEL_TP tp)
 {
     switch(tp) {
@@ -2030,6 +4740,11 @@ BOOL VmmInitialize()
     VmmCacheInitialize(VMM_CACHE_TAG_PAGING);
     if(!ctxVmm->Cache.PAGING.fActive) { goto fail; }
     if(!(ctxVmm->Cache.PAGING_FAILED = ObSet_New())) { goto fail; }
+    VmmCacheInflight_Initialize();
+    VmmCacheSetBudget(ctxMain->cfg.cCacheMB);
+    VmmCache2SetBudget(ctxMain->cfg.cCache2MB);
+    ctxVmm->Cache.fRevalidate = ctxMain->cfg.fCacheRevalidate;
+    ctxVmm->Cache.fDedup = ctxMain->cfg.fCacheDedup;
     // 6: CACHE INIT: Prototype PTE Cache Map
     if(!(ctxVmm->Cache.pmPrototypePte = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) { goto fail; }
     // 7: WORKER THREADS INIT:
@@ -2045,6 +4760,8 @@ BOOL VmmInitialize()
     ctxVmm->pObCInfoDB = ObContainer_New();
     ctxVmm->pObCCachePrefetchEPROCESS = ObContainer_New();
     ctxVmm->pObCCachePrefetchRegistry = ObContainer_New();
+    ctxVmm->Phys2VirtIndex.pObC = ObContainer_New();
+    ctxVmm->Phys2VirtIndex.fEnabled = ctxMain->cfg.fPhys2VirtIndex;
     InitializeCriticalSection(&ctxVmm->LockMaster);
     InitializeCriticalSection(&ctxVmm->LockPlugin);
     InitializeCriticalSection(&ctxVmm->LockUpdateMap);
@@ -43,7 +43,9 @@
 #define VMM_CACHE_TLB_ENTRIES                   0x4000  // -> 64MB of cached data
 #define VMM_CACHE_PHYS_ENTRIES                  0x4000  // -> 64MB of cached data
 
-#define VMM_WORK_THREADPOOL_NUM_THREADS         0x20
+#define VMM_WORK_THREADPOOL_NUM_THREADS_MIN     0x20    // min # of worker threads (long running work units may block workers).
+#define VMM_WORK_THREADPOOL_NUM_THREADS_MAX     0x80
+#define VMM_WORK_DEQUE_SIZE                     0x400   // max # of queued work units per worker thread.
 
 #define VMM_FLAG_NOCACHE                        0x00000001  // do not use the data cache (force reading from memory acquisition device).
 #define VMM_FLAG_ZEROPAD_ON_FAIL                0x00000002  // zero pad failed physical memory reads and report success if read within range of physical memory.
@@ -55,6 +57,7 @@
 #define VMM_FLAG_ALTADDR_VA_PTE                 0x00000080  // alternative address mode - MEM_IO_SCATTER_HEADER.qwA contains PTE instead of VA when calling VmmRead* functions.
 #define VMM_FLAG_NOCACHEPUT                     0x00000100  // do not write back to the data cache upon successful read from memory acquisition device.
 #define VMM_FLAG_CACHE_RECENT_ONLY              0x00000200  // only fetch from the most recent active cache region when reading.
+#define VMM_FLAG_CACHE_STALE_OK                 0x00000800  // allow fetching stale cached data from older (refreshed) cache generations when reading.
 #define VMM_FLAG_PAGING_LOOP_PROTECT_BITS       0x00ff0000  // placeholder bits for paging loop protect counter.
 #define VMM_FLAG_NOVAD                          0x01000000  // do not try to retrieve memory from backing VAD even if otherwise possible.
 
@@ -193,9 +196,17 @@ typedef struct tdVMM_MAP_PTEENTRY {
     DWORD cbuText;
     LPSTR uszText;
     DWORD _Reserved1;
-    DWORD cSoftware;    // # software (non active) PTEs in region
+    DWORD cSoftware;    // # software (non active) PTEs in region (estimate for kernel regions shared with the System process map).
 } VMM_MAP_PTEENTRY, *PVMM_MAP_PTEENTRY;
 
+typedef struct tdVMM_MAP_EXTENTENTRY {
+    QWORD va;
+    QWORD pa;           // physical address if known (hardware/transition/resolved prototype).
+    QWORD cb;
+    VMM_PTE_TP tp;
+    DWORD _Reserved1;
+} VMM_MAP_EXTENTENTRY, *PVMM_MAP_EXTENTENTRY;
+
 typedef enum tdVMM_VADMAP_TP {
     VMM_VADMAP_TP_CORE      = 0,    // core vad map
     VMM_VADMAP_TP_PARTIAL   = 1,    // core + additional info, such as fImage
@@ -546,6 +557,13 @@ typedef struct tdVMMOB_MAP_PTE {
     VMM_MAP_PTEENTRY pMap[];        // map entries.
 } VMMOB_MAP_PTE, *PVMMOB_MAP_PTE;
 
+typedef struct tdVMMOB_MAP_EXTENT {
+    OB ObHdr;
+    DWORD _Reserved1;
+    DWORD cMap;                     // # map entries.
+    VMM_MAP_EXTENTENTRY pMap[];     // map entries - ordered by va.
+} VMMOB_MAP_EXTENT, *PVMMOB_MAP_EXTENT;
+
 typedef struct tdVMMOB_MAP_VAD {
     OB ObHdr;
     BOOL fSpiderPrototypePte;
@@ -708,6 +726,27 @@ typedef struct tdVMMOB_PHYS2VIRT_INFORMATION {
     QWORD pvaList[VMM_PHYS2VIRT_INFORMATION_MAX_PROCESS_RESULT];
 } VMMOB_PHYS2VIRT_INFORMATION, *PVMMOB_PHYS2VIRT_INFORMATION;
 
+#define VMM_PHYS2VIRT_INDEX_ENTRIES_MAX                 0x02000000
+#define VMM_PHYS2VIRT_INDEX_REBUILD_MIN_MS              30000       // min time between index builds.
+
+typedef struct tdVMM_PHYS2VIRT_INDEXENTRY {
+    QWORD va;                       // virtual address of page.
+    DWORD dwPID;
+    DWORD pfn;
+    DWORD iNext;                    // next entry of same pfn hash (1-based index, 0 = end of chain).
+} VMM_PHYS2VIRT_INDEXENTRY, *PVMM_PHYS2VIRT_INDEXENTRY;
+
+typedef struct tdVMMOB_PHYS2VIRT_INDEX {
+    OB ObHdr;
+    DWORD dwPIDKernel;              // x64: PID of kernel DTB process - its entries are shared with processes sharing kernel PML4 entries.
+    DWORD dwGeneration;             // TLB refresh generation the index was built in.
+    DWORD cEntry;
+    DWORD dwHeadMask;               // # of pfn hash chains - 1 (power of two - 1).
+    POB_SET psPID;                  // PIDs of indexed processes.
+    PDWORD piPfnHead;               // pfn hash indexed first entry (1-based index, 0 = no entry).
+    PVMM_PHYS2VIRT_INDEXENTRY pEntry;
+} VMMOB_PHYS2VIRT_INDEX, *PVMMOB_PHYS2VIRT_INDEX;
+
 // 'static' process information that should be kept even in the ase of a total
 // process refresh. Only use for information that may never change or things
 // that may not affect analysis (like cache preload addresses that only may
@@ -735,6 +774,23 @@ typedef struct tdVMMOB_PROCESS_PERSISTENT {
     } Plugin;
 } VMMOB_PROCESS_PERSISTENT, *PVMMOB_PROCESS_PERSISTENT;
 
+// per-process software tlb of successful virtual-to-physical translations.
+// entries are validated by a check value covering the translation itself as
+// well as the process DTB and the TLB cache generation - allowing lock-free
+// lookups and implicit invalidation on TLB refresh / page table writes.
+#define VMM_PROCESS_TLB_ENTRIES         0x100   // 4kB pages, indexed by va >> 12
+#define VMM_PROCESS_TLB_ENTRIES_LARGE   0x40    // large pages, indexed by va >> 21
+
+typedef struct tdVMM_PROCESS_TLB_ENTRY {
+    QWORD qwCheck;                  // hash of va page, qwData, DTB and generation.
+    QWORD qwData;                   // physical page base | page shift (low bits).
+} VMM_PROCESS_TLB_ENTRY, *PVMM_PROCESS_TLB_ENTRY;
+
+typedef struct tdVMM_PROCESS_TLB {
+    VMM_PROCESS_TLB_ENTRY E[VMM_PROCESS_TLB_ENTRIES];
+    VMM_PROCESS_TLB_ENTRY L[VMM_PROCESS_TLB_ENTRIES_LARGE];
+} VMM_PROCESS_TLB, *PVMM_PROCESS_TLB;
+
 typedef struct tdVMM_PROCESS {
     OB ObHdr;
     CRITICAL_SECTION LockUpdate;
@@ -747,6 +803,10 @@ typedef struct tdVMM_PROCESS {
     CHAR szName[16];
     BOOL fUserOnly;
     BOOL fTlbSpiderDone;
+    VMM_PROCESS_TLB Tlb;
+    // x64: state of upper half PML4 entries (kernel) being identical to the
+    // kernel DTB - ((TLB generation + 1) << 1) | fShared - 0 = not evaluated.
+    volatile DWORD dwTlbKernelShared[0x100];
     struct {
         // NB! Map objects are _NEVER_ to be accessed directly from the
         //     process object itself! They may be deallocated on the fly!
@@ -809,48 +869,179 @@ typedef struct tdVMMOB_PROCESS_TABLE {
     POB_CONTAINER pObCNewPROC;      // contains VMM_PROCESS_TABLE
 } VMMOB_PROCESS_TABLE, *PVMMOB_PROCESS_TABLE;
 
-#define VMM_CACHE_REGIONS       3
-#define VMM_CACHE_REGION_MEMS   0x5000
-#define VMM_CACHE_BUCKETS       0x5000
+#define VMM_CACHE_REGIONS       3           // # of refresh generations a cache entry survives.
+#define VMM_CACHE_ENTRIES_MAX   (VMM_CACHE_REGIONS * 0x5000)    // default # of entries per table.
+#define VMM_CACHE_ENTRIES_MIN   (4 * VMM_CACHE_SHARDS)          // min # of entries per table.
+#define VMM_CACHE_SHARDS        0x40        // must be a power of two.
+#define VMM_CACHE_SHARD_BUCKETS 0x400       // must be a power of two.
+#define VMM_CACHE_BUDGET_MB_DEFAULT     ((3 * VMM_CACHE_ENTRIES_MAX) >> 8)
+#define VMM_CACHE_BUDGET_MB_MIN         16
+#define VMM_CACHE_ARENA_SIZE            0x00200000      // 2MB - large/huge page size.
+#define VMM_CACHE_ARENA_PAGES           (VMM_CACHE_ARENA_SIZE >> 12)
+#define VMM_CACHE2_SHARDS               0x40
+#define VMM_CACHE2_SHARD_BUCKETS        0x400
+#define VMM_CACHE2_BUDGET_MB_DEFAULT    256
+#define VMM_CACHE2_BUDGET_MB_MIN        16
+
+#define VMM_CACHE_REVALIDATE_MAX        0x4000          // max # of pages re-validated per refresh.
+#define VMM_CACHE_DEDUP_BUCKETS         0x1000          // must be a power of two.
+#define VMM_CACHE_DEDUP_SEEN            0x4000          // must be a power of two.
+#define VMM_CACHE_DEDUP_STRIPES         0x10            // must be a power of two.
+#define VMM_CACHE_FAIL_EXTENTS_MAX      0x1000          // max # of failed physical ranges remembered.
+#define VMM_CACHE_INFLIGHT_SLOTS        0x100           // must be a power of two.
+#define VMM_CACHE_INFLIGHT_NONE         0xffffffff
+
+#define VMM_READAHEAD_STREAMS           0x10            // streams per set - must be 0x10.
+#define VMM_READAHEAD_SETS              0x10            // stream sets - must be 0x10.
+#define VMM_READAHEAD_SET_SHIFT         24              // stream set is selected by physical address (16MB regions).
+#define VMM_READAHEAD_STRIDE_MAX        0x10            // max detected stride (in pages).
+#define VMM_READAHEAD_WINDOW_MIN        2
+#define VMM_READAHEAD_WINDOW_MAX        0x100
+
+#define VMM_READ_COALESCE_MIN_PAGES     4               // min # of contiguous pages read by a single device read.
+#define VMM_READ_COALESCE_MAX_PAGES     0x400           // max # of contiguous pages read by a single device read.
+#define VMM_READ_INFLIGHT_WAIT_STACK    0x40            // max # of pages of a read tracked for in-flight wait on the stack.
 
 #define VMM_CACHE_TAG_PHYS      'CaPh'
 #define VMM_CACHE_TAG_PAGING    'CaPg'
 #define VMM_CACHE_TAG_TLB       'CaTb'
 
+typedef struct tdVMM_CACHE_ARENA {
+    struct tdVMM_CACHE_ARENA *FLink;
+    struct tdVMM_CACHE_ARENA *BLink;
+    PBYTE pb;                       // VMM_CACHE_ARENA_SIZE bytes of page aligned page data.
+    DWORD cUsed;                    // # of pages handed out.
+    DWORD cFree;                    // # of page indexes in iFree.
+    WORD iFree[VMM_CACHE_ARENA_PAGES];
+} VMM_CACHE_ARENA, *PVMM_CACHE_ARENA;
+
+// physical address range [pa, paEnd) which failed to read.
+typedef struct tdVMM_CACHE_FAIL_EXTENT {
+    QWORD pa;
+    QWORD paEnd;
+} VMM_CACHE_FAIL_EXTENT, *PVMM_CACHE_FAIL_EXTENT;
+
+// device read of a page not yet in the cache - concurrent readers of the same
+// page wait for the read to complete instead of reading the page themselves.
+typedef struct tdVMM_CACHE_INFLIGHT {
+    QWORD qwA;
+    DWORD dwTag;
+    DWORD cRef;                     // owner + waiters (0 = slot is free).
+    BOOL fDone;
+    HANDLE hEvent;                  // manual reset - set when the read is completed.
+} VMM_CACHE_INFLIGHT, *PVMM_CACHE_INFLIGHT;
+
+// shared page data of PHYS cache entries with identical (non-zero) contents.
+typedef struct tdVMM_CACHE_DEDUP_ENTRY {
+    struct tdVMM_CACHE_DEDUP_ENTRY *FLink;
+    QWORD qwHash;
+    volatile LONG cRef;             // # of cache entries sharing the page data.
+    BYTE pb[0x1000];
+} VMM_CACHE_DEDUP_ENTRY, *PVMM_CACHE_DEDUP_ENTRY;
+
+// buckets and seen hashes are striped by the low bits of the hash - each
+// stripe is protected by its own lock.
+typedef struct tdVMM_CACHE_DEDUP {
+    SRWLOCK LockSRW[VMM_CACHE_DEDUP_STRIPES];
+    PVMM_CACHE_DEDUP_ENTRY B[VMM_CACHE_DEDUP_BUCKETS];
+    QWORD qwSeen[VMM_CACHE_DEDUP_SEEN];     // hashes of recently inserted pages.
+} VMM_CACHE_DEDUP, *PVMM_CACHE_DEDUP;
+
 typedef struct tdVMMOB_CACHE_MEM {
     OB Ob;
     // internal cache table values below:
-    DWORD iR;
+    DWORD iS;
     DWORD iB;
-    SLIST_ENTRY SListEmpty;
-    SLIST_ENTRY SListInUse;
+    DWORD dwEpoch;
+    volatile BOOL fAccessed;
+    SLIST_ENTRY SListEmpty;         // entry in empty list or retired list.
     SLIST_ENTRY SListTotal;
     struct tdVMMOB_CACHE_MEM *FLink;
     struct tdVMMOB_CACHE_MEM *BLink;
+    struct tdVMMOB_CACHE_MEM *ClockFLink;
+    struct tdVMMOB_CACHE_MEM *ClockBLink;
+    PVMM_CACHE_ARENA pArena;        // arena of page data (NULL if retired or shared).
+    PVMM_CACHE_DEDUP_ENTRY pDedup;  // shared page data (NULL if not shared or zero page).
+    volatile DWORD dwReadAheadId;   // id of read-ahead stream if not yet used (PHYS only).
     // "user" modifiable values below:
     MEM_SCATTER h;
-    union {
-        BYTE pb[0x1000];
-        DWORD pdw[0x400];
-        QWORD pqw[0x200];
+    union {                         // 0x1000 bytes page data (NULL if retired).
+        PBYTE pb;
+        PDWORD pdw;
+        PQWORD pqw;
     };
 } VMMOB_CACHE_MEM, *PVMMOB_CACHE_MEM, **PPVMMOB_CACHE_MEM;
 
-typedef struct tdVMM_CACHE_REGION {
+typedef struct tdVMM_CACHE_SHARD {
+    SRWLOCK LockSRW;                // exclusive lock - taken on shard modify.
+    volatile DWORD dwSeq;           // seqlock counter - odd while shard is modified.
+    DWORD c;                        // # of entries in shard.
+    PVMMOB_CACHE_MEM pClockHand;    // CLOCK eviction hand (NULL if shard is empty).
+    PVMMOB_CACHE_MEM B[VMM_CACHE_SHARD_BUCKETS];
+} VMM_CACHE_SHARD, *PVMM_CACHE_SHARD;
+
+// second tier cache of compressed pages evicted from the PHYS/TLB caches.
+typedef struct tdVMM_CACHE2_ENTRY {
+    struct tdVMM_CACHE2_ENTRY *FLink;       // bucket chain.
+    struct tdVMM_CACHE2_ENTRY *FifoFLink;   // eviction order (newer).
+    struct tdVMM_CACHE2_ENTRY *FifoBLink;   // eviction order (older).
+    QWORD qwA;
+    DWORD dwEpoch;                  // epoch of the evicted first tier entry.
+    DWORD cb;                       // size of pb.
+    USHORT usFormat;                // OB_COMPRESS_FORMAT_* of pb (OB_COMPRESS_FORMAT_NONE = raw page).
+    BYTE pb[0];
+} VMM_CACHE2_ENTRY, *PVMM_CACHE2_ENTRY;
+
+typedef struct tdVMM_CACHE2_SHARD {
     SRWLOCK LockSRW;
-    SLIST_HEADER ListHeadEmpty;
-    SLIST_HEADER ListHeadInUse;
-    SLIST_HEADER ListHeadTotal;
-    PVMMOB_CACHE_MEM B[VMM_CACHE_BUCKETS];
-} VMM_CACHE_REGION, *PVMM_CACHE_REGION;
+    DWORD c;
+    QWORD cb;                       // # of bytes used by entries in shard.
+    PVMM_CACHE2_ENTRY pFifo;        // oldest entry (NULL if shard is empty).
+    PVMM_CACHE2_ENTRY B[VMM_CACHE2_SHARD_BUCKETS];
+} VMM_CACHE2_SHARD, *PVMM_CACHE2_SHARD;
+
+typedef struct tdVMM_CACHE2_TABLE {
+    BOOL fActive;
+    volatile QWORD cbShardMax;      // max # of bytes per shard.
+    VMM_CACHE2_SHARD S[VMM_CACHE2_SHARDS];
+} VMM_CACHE2_TABLE, *PVMM_CACHE2_TABLE;
+
+typedef struct tdVMM_READAHEAD_STREAM {
+    DWORD dwId;                     // stream id (0 = unused): generation << 8 | set << 4 | index.
+    DWORD cWindow;                  // current read-ahead window (in pages).
+    QWORD paLast;                   // last demand missed physical address.
+    LONGLONG iStride;               // detected stride in bytes (0 = not yet detected).
+    QWORD qwTick;                   // last use (for stream replacement).
+    volatile DWORD cIssued;         // # pages read ahead since last window adjust.
+    volatile DWORD cUsed;           // # read ahead pages used since last window adjust.
+} VMM_READAHEAD_STREAM, *PVMM_READAHEAD_STREAM;
+
+// read-ahead streams of a physical address region (selected by address).
+typedef struct tdVMM_READAHEAD_SET {
+    SRWLOCK LockSRW;
+    QWORD qwTick;
+    VMM_READAHEAD_STREAM S[VMM_READAHEAD_STREAMS];
+} VMM_READAHEAD_SET, *PVMM_READAHEAD_SET;
 
 typedef struct tdVMM_CACHE_TABLE {
     BOOL fActive;
     DWORD tag;
-    DWORD iR;
+    volatile DWORD dwEpoch;         // incremented on each partial clear.
     BOOL fAllActiveRegions;
+    volatile DWORD cMax;            // max # of entries with page data.
+    volatile DWORD cShardMax;       // max # of entries per shard.
+    volatile DWORD cTotal;          // # of entries with page data.
+    volatile LONG cDedup;           // # of pages saved by page data sharing.
+    volatile DWORD iShardEvict;     // round-robin shard index for forced eviction.
     CRITICAL_SECTION Lock;
-    VMM_CACHE_REGION R[VMM_CACHE_REGIONS];
+    SLIST_HEADER ListHeadEmpty;
+    SLIST_HEADER ListHeadRetired;   // entries without page data (after shrink).
+    SLIST_HEADER ListHeadTotal;     // all entries - freed on close only.
+    SRWLOCK LockArena;
+    PVMM_CACHE_ARENA pArena;        // page data arenas - arenas with free pages first.
+    VMM_CACHE_SHARD S[VMM_CACHE_SHARDS];
+    VMM_CACHE2_TABLE C2;            // second tier (compressed) - PHYS/TLB only.
+    PVMM_CACHE_DEDUP pDedup;        // page data sharing index - PHYS only.
 } VMM_CACHE_TABLE, *PVMM_CACHE_TABLE;
 
 typedef struct tdVMM_VIRT2PHYS_INFORMATION {
@@ -861,16 +1052,31 @@ typedef struct tdVMM_VIRT2PHYS_INFORMATION {
     WORD  iPTEs[5]; // Index of PTE in page table
 } VMM_VIRT2PHYS_INFORMATION, *PVMM_VIRT2PHYS_INFORMATION;
 
+typedef struct tdVMM_VIRT2PHYS_RANGE_CONTEXT {
+    PVMM_PROCESS pProcess;
+    QWORD vaFirst;
+    QWORD vaLast;                   // last address of range (inclusive).
+    BOOL fFail;
+    DWORD cMapMax;
+    DWORD cMap;
+    PVMM_MAP_EXTENTENTRY pMap;
+} VMM_VIRT2PHYS_RANGE_CONTEXT, *PVMM_VIRT2PHYS_RANGE_CONTEXT;
+
 typedef struct tdVMM_MEMORYMODEL_FUNCTIONS {
     VOID(*pfnClose)();
-    BOOL(*pfnVirt2Phys)(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa);
+    BOOL(*pfnVirt2Phys)(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa, _Out_opt_ PBYTE pbPageShift);
+    VOID(*pfnVirt2PhysRange)(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx);   // optional
     VOID(*pfnVirt2PhysVadEx)(_In_ QWORD paPT, _Inout_ PVMMOB_MAP_VADEX pVadEx, _In_ BYTE iPML, _Inout_ PDWORD piVadEx);
     VOID(*pfnVirt2PhysGetInformation)(_Inout_ PVMM_PROCESS pProcess, _Inout_ PVMM_VIRT2PHYS_INFORMATION pVirt2PhysInfo);
     VOID(*pfnPhys2VirtGetInformation)(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMOB_PHYS2VIRT_INFORMATION pP2V);
     BOOL(*pfnPteMapInitialize)(_In_ PVMM_PROCESS pProcess);
     VOID(*pfnTlbSpider)(_In_ PVMM_PROCESS pProcess);
+    VOID(*pfnTlbSpiderMultiple)(_In_ DWORD cProcess, _In_reads_(cProcess) PVMM_PROCESS *ppProcess);   // optional
+    VOID(*pfnTlbPrefetchVirt2Phys)(_In_ PVMM_PROCESS pProcess, _In_ DWORD cva, _In_reads_(cva) PQWORD pva);   // optional
     BOOL(*pfnTlbPageTableVerify)(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRefReq);
+    DWORD(*pfnReadScatterVirtualTranslate)(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags);   // optional
     BOOL(*pfnPagedRead)(_In_ PVMM_PROCESS pProcess, _In_opt_ QWORD va, _In_ QWORD pte, _Out_writes_opt_(4096) PBYTE pbPage, _Out_ PQWORD ppa, _Inout_opt_ PVMM_PTE_TP ptp, _In_ QWORD flags);
+    VOID(*pfnPagedReadScatter)(_In_ PVMM_PROCESS pProcess, _In_ DWORD cpMEMs, _Inout_updates_(cpMEMs) PPMEM_SCATTER ppMEMs, _In_ QWORD flags);   // optional
 } VMM_MEMORYMODEL_FUNCTIONS;
 
 #define VMM_EPROCESS_DWORD(pProcess, offset)    (*(PDWORD)(pProcess->win.EPROCESS.pb + offset))
@@ -898,6 +1104,11 @@ typedef struct tdVmmConfig {
     BOOL fWaitInitialize;
     BOOL fUserInteract;
     BOOL fFileInfoHeader;
+    DWORD cCacheMB;                       // command line cache memory budget (0 = default)
+    DWORD cCache2MB;                      // command line compressed cache memory budget (0 = default)
+    BOOL fCacheRevalidate;
+    BOOL fCacheDedup;
+    BOOL fPhys2VirtIndex;
     // strings below
     CHAR szPythonPath[MAX_PATH];
     CHAR szPageFile[10][MAX_PATH];
@@ -907,10 +1118,15 @@ typedef struct tdVmmConfig {
 
 typedef struct tdVMM_STATISTICS {
     QWORD cPhysCacheHit;
+    QWORD cPhysCache2Hit;
     QWORD cPhysReadSuccess;
     QWORD cPhysReadFail;
+    QWORD cPhysReadFailCacheHit;
     QWORD cPhysWrite;
     QWORD cPhysRefreshCache;
+    QWORD cPhysReadAhead;
+    QWORD cPhysReadAheadUsed;
+    QWORD cPhysReadCoalesced;
     struct {
         QWORD cPrototype;
         QWORD cTransition;
@@ -927,9 +1143,17 @@ typedef struct tdVMM_STATISTICS {
     } page;
     QWORD cPageRefreshCache;
     QWORD cTlbCacheHit;
+    QWORD cTlbCache2Hit;
     QWORD cTlbReadSuccess;
     QWORD cTlbReadFail;
     QWORD cTlbRefreshCache;
+    QWORD cTlbVirt2PhysHit;
+    QWORD cTlbVirt2PhysKernelShared;
+    QWORD cCacheRevalidate;
+    QWORD cCacheRevalidateUnchanged;
+    QWORD cCacheMissCoalesced;
+    QWORD cPhysDedupZero;
+    QWORD cPhysDedupShared;
     QWORD cProcessRefreshPartial;
     QWORD cProcessRefreshFull;
 } VMM_STATISTICS, *PVMM_STATISTICS;
@@ -1154,6 +1378,13 @@ typedef struct tdVMM_CONTEXT {
     PVMMWINOBJ_CONTEXT pObjects;
     PVMMWIN_REGISTRY_CONTEXT pRegistry;
     QWORD paPluginPhys2VirtRoot;
+    struct {
+        BOOL fEnabled;              // global reverse physical to virtual index.
+        volatile DWORD fBuilding;
+        volatile DWORD dwGeneration;    // incremented on TLB refresh - older indexes are stale.
+        QWORD qwTickBuild;          // tick of the last build start (rate limit).
+        POB_CONTAINER pObC;         // contains PVMMOB_PHYS2VIRT_INDEX
+    } Phys2VirtIndex;
     VMM_DYNAMIC_LOAD_FUNCTIONS fn;
     struct {
         PVOID FLinkAll;
@@ -1170,6 +1401,9 @@ typedef struct tdVMM_CONTEXT {
     CRITICAL_SECTION LockUpdateModule;  // lock for internal modules
     struct {                            // lightweight SRW locks
         SRWLOCK WinObjDisplay;
+        SRWLOCK CacheBudget;
+        SRWLOCK CacheFail;
+        SRWLOCK CacheInflight;
     } LockSRW;
     POB_CONTAINER pObCMapPhysMem;
     POB_CONTAINER pObCMapEvil;
@@ -1190,14 +1424,36 @@ typedef struct tdVMM_CONTEXT {
         VMM_CACHE_TABLE TLB;
         VMM_CACHE_TABLE PAGING;
         POB_SET PAGING_FAILED;
+        struct {                    // failed physical reads (sorted & merged) - cleared on MEM refresh.
+            volatile DWORD c;
+            VMM_CACHE_FAIL_EXTENT E[VMM_CACHE_FAIL_EXTENTS_MAX];
+        } PHYS_FAILED;
+        VMM_CACHE_INFLIGHT INFLIGHT[VMM_CACHE_INFLIGHT_SLOTS];
         POB_MAP pmPrototypePte;     // map with mm_vad.c managed data
+        DWORD cMB;                  // memory budget of PHYS+TLB+PAGING tables.
+        DWORD cMB2;                 // memory budget of compressed PHYS+TLB tables.
+        BOOL fRevalidate;           // re-validate hot PHYS/TLB pages on refresh.
+        BOOL fDedup;                // share page data of identical PHYS pages.
+        volatile DWORD dwTlbGeneration; // invalidates process software tlbs.
+        VMM_PROCESS_TLB TlbKernel;  // x64: software tlb of kernel addresses shared by all processes.
+        volatile DWORD cEvictForced;
+        QWORD cRebalanceMissPHYS;
+        QWORD cRebalanceMissTLB;
     } Cache;
+    // physical memory read-ahead streams
+    struct {
+        volatile DWORD cGeneration;
+        VMM_READAHEAD_SET Set[VMM_READAHEAD_SETS];
+    } ReadAhead;
     // worker threads
     struct {
         BOOL fEnabled;
-        POB_SET psThreadAll;
-        POB_SET psThreadAvail;
-        POB_SET psUnit;
+        DWORD cThread;
+        volatile DWORD cThreadActive;
+        volatile DWORD cThreadIdle;
+        volatile DWORD iDequeNext;
+        HANDLE hEventWakeup;                // auto-reset: wakes one idle worker.
+        struct tdVMMWORK_DEQUE *pDeques;    // one work queue per worker thread.
     } Work;
     WCHAR _EmptyWCHAR;
     VMMWIN_OBJECT_TYPE_TABLE ObjectTypeTable;
@@ -1441,6 +1697,40 @@ VOID VmmReadEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(cb)
 _Success_(return)
 BOOL VmmReadPage(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(4096) PBYTE pbPage);
 
+/*
+* Pin a single page of memory, physical or virtual, for zero-copy read-only
+* access. The page data is available in pb (0x1000 bytes) of the returned
+* object and remains valid and unchanged until the object is DECREF'ed.
+* Pinned pages should be released as soon as possible since they cannot be
+* recycled by the cache while pinned.
+* Virtual memory is read if a process is specified in pProcess.
+* Physical memory is read if NULL is specified in pProcess.
+* NB! the page data must never be written to!
+* CALLER DECREF: return
+* -- pProcess = NULL=='physical memory read', PTR=='virtual memory read'
+* -- qwA = address within the page to pin.
+* -- flags = flags as in VMM_FLAG_*
+* -- return = the pinned page, or NULL on fail.
+*/
+PVMMOB_CACHE_MEM VmmReadPin(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ QWORD flags);
+
+/*
+* Read a contigious amount of memory without copying it if possible. If the
+* range is contained within a single page the page is pinned and a read-only
+* pointer into the page is returned - otherwise the memory is read into the
+* supplied buffer.
+* CALLER DECREF: *ppObPin
+* -- pProcess = NULL=='physical memory read', PTR=='virtual memory read'
+* -- qwA
+* -- cb
+* -- flags = flags as in VMM_FLAG_*
+* -- pbBuffer = buffer of cb bytes - used if the range cannot be pinned.
+* -- ppObPin = receives the pinned page (NULL if pbBuffer is used).
+* -- return = read-only pointer to the data, NULL if not all bytes are read.
+*/
+_Success_(return != NULL)
+PBYTE VmmReadPinEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ DWORD cb, _In_ QWORD flags, _Out_writes_(cb) PBYTE pbBuffer, _Out_ PPVMMOB_CACHE_MEM ppObPin);
+
 /*
 * Scatter read virtual memory. Non contiguous 4096-byte pages.
 * -- pProcess
@@ -1450,6 +1740,23 @@ BOOL VmmReadPage(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(40
 */
 VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _In_ QWORD flags);
 
+/*
+* Memory model specialized translation loops of VmmReadScatterVirtual. These
+* call the page table walker of the memory model directly instead of through
+* the memory model function table and are selected by the memory model at its
+* initialization (pfnReadScatterVirtualTranslate).
+* -- pProcess
+* -- ppMEMsVirt
+* -- cpMEMsVirt
+* -- ppMEMsPhys = receives pointers to the physical scatter entries.
+* -- pMEMsPhys = backing storage for the physical scatter entries.
+* -- flags = VMM_FLAG_*
+* -- return = number of physical scatter entries in ppMEMsPhys.
+*/
+DWORD VmmReadScatterVirtual_TranslateX64(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags);
+DWORD VmmReadScatterVirtual_TranslateX86PAE(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags);
+DWORD VmmReadScatterVirtual_TranslateX86(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_SCATTER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _Out_writes_(cpMEMsVirt) PPMEM_SCATTER ppMEMsPhys, _Out_writes_(cpMEMsVirt) PMEM_SCATTER pMEMsPhys, _In_ QWORD flags);
+
 /*
 * Scatter read physical memory. Non contiguous 4096-byte pages.
 * -- ppMEMsPhys
@@ -1513,6 +1820,53 @@ BOOL VmmVirt2PhysEx(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_
 _Success_(return)
 BOOL VmmVirt2Phys(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa);
 
+/*
+* Translate a virtual address range into a compact list of extents. Physically
+* contiguous pages and large pages are merged into single extents. Not present
+* pages are reported with their type (transition/prototype/pagefile/..) if the
+* PTE is non-zero; VAD backed pages with zero PTEs and unmapped pages are not
+* reported.
+* CALLER DECREF: return
+* -- pProcess
+* -- va
+* -- cb
+* -- return
+*/
+PVMMOB_MAP_EXTENT VmmVirt2PhysRange(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD cb);
+
+/*
+* Translate multiple virtual addresses of a process to physical addresses. The
+* page tables required are fetched in batches rather than one by one.
+* -- pProcess
+* -- cva
+* -- pva = virtual addresses.
+* -- ppa = physical addresses (0 on fail).
+* -- pfSuccess = optional per-address result.
+* -- return = number of successfully translated addresses.
+*/
+DWORD VmmVirt2PhysBatch(_In_ PVMM_PROCESS pProcess, _In_ DWORD cva, _In_reads_(cva) PQWORD pva, _Out_writes_(cva) PQWORD ppa, _Out_writes_opt_(cva) PBOOL pfSuccess);
+
+/*
+* Append a range to the extent list of a range translation - merging it with
+* the previous extent if contiguous. Used by memory model range walkers.
+* -- ctx
+* -- va
+* -- pa
+* -- cb
+* -- tp
+*/
+VOID VmmVirt2PhysRange_Push(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx, _In_ QWORD va, _In_ QWORD pa, _In_ QWORD cb, _In_ VMM_PTE_TP tp);
+
+/*
+* Append a not present page (given by its PTE) to the extent list of a range
+* translation. The page type is resolved by the memory model paged function.
+* -- ctx
+* -- va
+* -- pte
+* -- cb = byte count within the page starting at va.
+*/
+VOID VmmVirt2PhysRange_PushPte(_Inout_ PVMM_VIRT2PHYS_RANGE_CONTEXT ctx, _In_ QWORD va, _In_ QWORD pte, _In_ QWORD cb);
+
 /*
 * Spider the TLB (page table cache) to load all page table pages into the cache.
 * This is done to speed up various subsequent virtual memory accesses.
@@ -1521,6 +1875,14 @@ BOOL VmmVirt2Phys(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD pp
 */
 VOID VmmTlbSpider(_In_ PVMM_PROCESS pProcess);
 
+/*
+* Spider the TLB (page table cache) of all active processes not yet spidered.
+* Processes (and their page table subtrees) are spidered in parallel and the
+* page table reads are merged into few large reads (if supported by the memory
+* model). Useful before operations touching all processes.
+*/
+VOID VmmTlbSpiderAll();
+
 /*
 * Try verify that a supplied page table in pb is valid by analyzing it.
 * -- pb = 0x1000 bytes containing the page table page.
@@ -1560,6 +1922,24 @@ VOID VmmVirt2PhysGetInformation(_Inout_ PVMM_PROCESS pProcess, _Inout_ PVMM_VIRT
 */
 PVMMOB_PHYS2VIRT_INFORMATION VmmPhys2VirtGetInformation(_In_ PVMM_PROCESS pProcess, _In_ QWORD paTarget);
 
+/*
+* Retrieve the global reverse physical to virtual index. The index maps page
+* frame numbers to chains of (PID, virtual address) of all indexed processes.
+* It's built in the background from the page tables if enabled. An index built
+* before the last TLB refresh is stale and is not returned. If no current index
+* exists a build is started (at most once per VMM_PHYS2VIRT_INDEX_REBUILD_MIN_MS)
+* and NULL is returned - callers should then walk the page tables.
+* CALLER DECREF: return
+* -- return
+*/
+PVMMOB_PHYS2VIRT_INDEX VmmPhys2VirtIndex_Get();
+
+/*
+* Mark the reverse physical to virtual index as stale (on TLB refresh). The
+* index is re-built on demand by the next VmmPhys2VirtIndex_Get.
+*/
+VOID VmmPhys2VirtIndex_Refresh();
+
 
 
 // ----------------------------------------------------------------------------
@@ -1679,11 +2059,14 @@ VOID VmmProcessListPIDs(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PSIZE_T
 * -- pfn
 * -- ctx = optional context to provide to the pfn function.
 * -- hEventFinish = optional event with will be set upon work completion.
+* -- return = TRUE if scheduled (or run inline if all work queues are full),
+*             FALSE if the worker threads are not available (the work is not
+*             run - hEventFinish is still set).
 */
-VOID VmmWork(_In_ LPTHREAD_START_ROUTINE pfn, _In_opt_ PVOID ctx, _In_opt_ HANDLE hEventFinish);
+BOOL VmmWork(_In_ LPTHREAD_START_ROUTINE pfn, _In_opt_ PVOID ctx, _In_opt_ HANDLE hEventFinish);
 
 /*
-* Schedule up to 64 asynchronous work items onto worker threads.
+* Schedule multiple asynchronous work items onto worker threads.
 * Function will wait for all work items to complete before returning.
 * NB! longer running functions must monitor ctxVmm->Work.fEnabled and exit
 *     immediately if required!
@@ -1693,6 +2076,19 @@ VOID VmmWork(_In_ LPTHREAD_START_ROUTINE pfn, _In_opt_ PVOID ctx, _In_opt_ HANDL
 */
 VOID VmmWorkWaitMultiple(_In_opt_ PVOID ctx, _In_ DWORD cWork, ...);
 
+/*
+* Call pfn once for each index [0, c) in parallel on the calling thread and
+* on up to cWorkerMax worker threads. Indexes are claimed by the calling
+* thread as well - the function completes even if no worker is available.
+* Function will wait for all indexes to be processed before returning.
+* NB! pfn must be thread-safe!
+* -- c = number of indexes.
+* -- cWorkerMax = max number of worker threads to use besides the caller.
+* -- ctx = optional context to provide to the pfn function.
+* -- pfn = function to call for each index.
+*/
+VOID VmmWorkParallelFor(_In_ DWORD c, _In_ DWORD cWorkerMax, _In_opt_ PVOID ctx, _In_ VOID(*pfn)(_In_opt_ PVOID ctx, _In_ DWORD i));
+
 /*
 * Perform multi-threaded parallel processing of processes in the process table.
 * This is useful when slow I/O should take place on multiple or all processes
@@ -1726,23 +2122,50 @@ BOOL VmmProcessActionForeachParallel_CriteriaActiveOnly(_In_ PVMM_PROCESS pProce
 BOOL VmmProcessActionForeachParallel_CriteriaActiveUserOnly(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx);
 
 /*
-* Clear the oldest region of all InUse entries and make it the new active region.
+* Start a new refresh generation of the cache. Entries which were read more
+* than VMM_CACHE_REGIONS generations ago become stale; stale entries are not
+* removed but are only returned to readers specifying VMM_FLAG_CACHE_STALE_OK
+* and are the first to be evicted. Recently used PHYS/TLB entries which just
+* became stale may optionally be re-validated against the live memory.
 * -- wTblTag
 */
 VOID VmmCacheClearPartial(_In_ DWORD dwTblTag);
 
 /*
-* Clear the specified cache from all entries.
+* Clear the specified cache from all entries (stale entries included).
 * -- dwTblTag
 */
 VOID VmmCacheClear(_In_ DWORD dwTblTag);
 
+/*
+* Set the memory budget shared by the PHYS, TLB and PAGING caches. The budget
+* may be changed at runtime - the tables are grown or shrunk accordingly.
+* One third of the budget is given to the PAGING cache while the remainder is
+* shared between the PHYS and TLB caches and is rebalanced automatically
+* depending on which of the caches currently misses the most.
+* -- cMB = the budget in MB, 0 = default.
+*/
+VOID VmmCacheSetBudget(_In_ DWORD cMB);
+
+/*
+* Set the memory budget of the second tier (compressed) caches which keep pages
+* evicted from the PHYS and TLB caches. The budget is split evenly between the
+* PHYS and TLB compressed caches and may be changed at runtime.
+* -- cMB = the budget in MB, 0 = default.
+*/
+VOID VmmCache2SetBudget(_In_ DWORD cMB);
+
 /*
 * Invalidate cache entries belonging to a specific physical address.
 * -- pa
 */
 VOID VmmCacheInvalidate(_In_ QWORD pa);
 
+/*
+* Clear the negative cache of physical pages which failed to read.
+*/
+VOID VmmCacheFailClear();
+
 /*
 * Prefetch a set of addresses contained in pPrefetchPages into the cache. This
 * is useful when reading data from somewhat known addresses over higher latency
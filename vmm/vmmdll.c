@@ -101,6 +101,18 @@ BOOL VmmDll_ConfigIntialize(_In_ DWORD argc, _In_ char* argv[])
             ctxMain->cfg.fDisableBackgroundRefresh = TRUE;
             i++;
             continue;
+        } else if(0 == _stricmp(argv[i], "-cache-revalidate")) {
+            ctxMain->cfg.fCacheRevalidate = TRUE;
+            i++;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-cache-dedup")) {
+            ctxMain->cfg.fCacheDedup = TRUE;
+            i++;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-phys2virt-index")) {
+            ctxMain->cfg.fPhys2VirtIndex = TRUE;
+            i++;
+            continue;
         } else if(0 == _stricmp(argv[i], "-waitinitialize")) {
             ctxMain->cfg.fWaitInitialize = TRUE;
             i++;
@@ -120,6 +132,14 @@ BOOL VmmDll_ConfigIntialize(_In_ DWORD argc, _In_ char* argv[])
             ctxMain->dev.paMax = Util_GetNumericA(argv[i + 1]);
             i += 2;
             continue;
+        } else if(0 == _stricmp(argv[i], "-cachemb")) {
+            ctxMain->cfg.cCacheMB = (DWORD)Util_GetNumericA(argv[i + 1]);
+            i += 2;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-cache2mb")) {
+            ctxMain->cfg.cCache2MB = (DWORD)Util_GetNumericA(argv[i + 1]);
+            i += 2;
+            continue;
         } else if((0 == _stricmp(argv[i], "-device")) || (0 == strcmp(argv[i], "-z"))) {
             strcpy_s(ctxMain->dev.szDevice, MAX_PATH, argv[i + 1]);
             i += 2;
@@ -226,6 +246,19 @@ VOID VmmDll_PrintHelp()
         "   -cr3 : base address of kernel/process page table (PML4) / CR3 CPU register. \n" \
         "   -max : memory max address, valid range: 0x0 .. 0xffffffffffffffff           \n" \
         "          default: auto-detect (max supported by device / target system).      \n" \
+        "   -cachemb : memory budget (in MB) of the physical memory, page table and     \n" \
+        "          paged memory caches. The budget may also be changed at runtime.      \n" \
+        "          default: 720   Example: -cachemb 4096                                \n" \
+        "   -cache2mb : memory budget (in MB) of the compressed second tier caches of   \n" \
+        "          pages evicted from the physical memory and page table caches.        \n" \
+        "          default: 256   Example: -cache2mb 2048                               \n" \
+        "   -cache-revalidate : re-validate recently used cache pages in one batched    \n" \
+        "          read on cache refresh instead of re-reading them one by one on the   \n" \
+        "          next access. Only applies to volatile memory (live systems).         \n" \
+        "   -cache-dedup : share the memory of cached physical pages with identical     \n" \
+        "          contents (hashed). Zero pages are always shared.                     \n" \
+        "   -phys2virt-index : maintain a global reverse physical to virtual address    \n" \
+        "          index (built in the background) for fast phys2virt lookups.          \n" \
         "   -memmap-str : specify a physical memory map in parameter agrument text.     \n" \
         "   -memmap : specify a physical memory map given in a file or specify 'auto'.  \n" \
         "          example: -memmap c:\\temp\\my_custom_memory_map.txt                  \n" \
@@ -525,6 +558,21 @@ BOOL VMMDLL_ConfigGet(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
         case VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL:
             *pqwValue = Statistics_CallGetEnabled() ? 1 : 0;
             return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_MB:
+            *pqwValue = ctxVmm->Cache.cMB;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE2_MB:
+            *pqwValue = ctxVmm->Cache.cMB2;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_REVALIDATE:
+            *pqwValue = ctxVmm->Cache.fRevalidate ? 1 : 0;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_DEDUP:
+            *pqwValue = ctxVmm->Cache.fDedup ? 1 : 0;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_PHYS2VIRT_INDEX:
+            *pqwValue = ctxVmm->Phys2VirtIndex.fEnabled ? 1 : 0;
+            return TRUE;
         case VMMDLL_OPT_WIN_VERSION_MAJOR:
             *pqwValue = ctxVmm->kernel.dwVersionMajor;
             return TRUE;
@@ -644,6 +692,28 @@ BOOL VMMDLL_ConfigSet(_In_ ULONG64 fOption, _In_ ULONG64 qwValue)
         case VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL:
             Statistics_CallSetEnabled(qwValue ? TRUE : FALSE);
             return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_MB:
+            VmmCacheSetBudget((DWORD)min(qwValue, 0xffffffff));
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE2_MB:
+            VmmCache2SetBudget((DWORD)min(qwValue, 0xffffffff));
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_REVALIDATE:
+            ctxVmm->Cache.fRevalidate = qwValue ? TRUE : FALSE;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_DEDUP:
+            ctxVmm->Cache.fDedup = qwValue ? TRUE : FALSE;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_PHYS2VIRT_INDEX:
+            ctxVmm->Phys2VirtIndex.fEnabled = qwValue ? TRUE : FALSE;
+            if(ctxVmm->Phys2VirtIndex.fEnabled) {
+                VmmPhys2VirtIndex_Refresh();
+                ctxVmm->Phys2VirtIndex.qwTickBuild = 0;
+                Ob_DECREF(VmmPhys2VirtIndex_Get());     // start build
+            } else {
+                ObContainer_SetOb(ctxVmm->Phys2VirtIndex.pObC, NULL);
+            }
+            return TRUE;
         case VMMDLL_OPT_FORENSIC_MODE:
             return FcInitialize((DWORD)qwValue, FALSE);
         default:
@@ -955,6 +1025,40 @@ BOOL VMMDLL_MemReadEx(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE
         VMMDLL_MemReadEx_Impl(dwPID, qwA, pb, cb, pcbReadOpt, flags))
 }
 
+_Success_(return != NULL)
+PBYTE VMMDLL_MemReadPin_Impl(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_ ULONG64 flags, _Out_ PHANDLE phPin)
+{
+    PVMM_PROCESS pObProcess = NULL;
+    PVMMOB_CACHE_MEM pObMEM;
+    *phPin = NULL;
+    if(dwPID != -1) {
+        pObProcess = VmmProcessGet(dwPID);
+        if(!pObProcess) { return NULL; }
+    }
+    pObMEM = VmmReadPin(pObProcess, qwA, flags);
+    Ob_DECREF(pObProcess);
+    if(!pObMEM) { return NULL; }
+    *phPin = (HANDLE)pObMEM;
+    return pObMEM->pb;
+}
+
+_Success_(return != NULL)
+PBYTE VMMDLL_MemReadPin(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_ ULONG64 flags, _Out_ PHANDLE phPin)
+{
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_MemReadPin,
+        PBYTE,
+        NULL,
+        VMMDLL_MemReadPin_Impl(dwPID, qwA, flags, phPin))
+}
+
+VOID VMMDLL_MemReadPinRelease(_In_opt_ HANDLE hPin)
+{
+    // NB! safe also after close - page data is released on close and the
+    // last reference only frees the detached pin itself.
+    Ob_DECREF((PVMMOB_CACHE_MEM)hPin);
+}
+
 _Success_(return)
 BOOL VMMDLL_MemRead(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
 {
@@ -1041,6 +1145,62 @@ BOOL VMMDLL_MemVirt2Phys(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqw
         VMMDLL_MemVirt2Phys_Impl(dwPID, qwVA, pqwPA))
 }
 
+_Success_(return)
+BOOL VMMDLL_MemVirt2PhysBatch_Impl(_In_ DWORD dwPID, _In_ DWORD cVA, _In_reads_(cVA) PULONG64 pqwVA, _Out_writes_(cVA) PULONG64 pqwPA, _Out_writes_opt_(cVA) PBOOL pfSuccess)
+{
+    DWORD cSuccess;
+    PVMM_PROCESS pObProcess = NULL;
+    if(!cVA) { return FALSE; }
+    if(!(pObProcess = VmmProcessGet(dwPID))) {
+        ZeroMemory(pqwPA, cVA * sizeof(ULONG64));
+        if(pfSuccess) { ZeroMemory(pfSuccess, cVA * sizeof(BOOL)); }
+        return FALSE;
+    }
+    cSuccess = VmmVirt2PhysBatch(pObProcess, cVA, pqwVA, pqwPA, pfSuccess);
+    Ob_DECREF(pObProcess);
+    return cSuccess ? TRUE : FALSE;
+}
+
+_Success_(return)
+BOOL VMMDLL_MemVirt2PhysBatch(_In_ DWORD dwPID, _In_ DWORD cVA, _In_reads_(cVA) PULONG64 pqwVA, _Out_writes_(cVA) PULONG64 pqwPA, _Out_writes_opt_(cVA) PBOOL pfSuccess)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_MemVirt2PhysBatch,
+        VMMDLL_MemVirt2PhysBatch_Impl(dwPID, cVA, pqwVA, pqwPA, pfSuccess))
+}
+
+_Success_(return)
+BOOL VMMDLL_MemVirt2PhysRange_Impl(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _In_ ULONG64 cb, _Out_writes_opt_(*pcExtents) PVMMDLL_MEM_EXTENT pExtents, _Inout_ PDWORD pcExtents)
+{
+    BOOL fResult = FALSE;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMMOB_MAP_EXTENT pObMap = NULL;
+    if(sizeof(VMM_MAP_EXTENTENTRY) != sizeof(VMMDLL_MEM_EXTENT)) { goto fail; }
+    if(!(pObProcess = VmmProcessGet(dwPID))) { goto fail; }
+    if(!(pObMap = VmmVirt2PhysRange(pObProcess, qwVA, cb))) { goto fail; }
+    if(pExtents) {
+        if(*pcExtents < pObMap->cMap) {
+            *pcExtents = pObMap->cMap;
+            goto fail;
+        }
+        memcpy(pExtents, pObMap->pMap, pObMap->cMap * sizeof(VMMDLL_MEM_EXTENT));
+    }
+    *pcExtents = pObMap->cMap;
+    fResult = TRUE;
+fail:
+    Ob_DECREF(pObProcess);
+    Ob_DECREF(pObMap);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_MemVirt2PhysRange(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _In_ ULONG64 cb, _Out_writes_opt_(*pcExtents) PVMMDLL_MEM_EXTENT pExtents, _Inout_ PDWORD pcExtents)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_MemVirt2PhysRange,
+        VMMDLL_MemVirt2PhysRange_Impl(dwPID, qwVA, cb, pExtents, pcExtents))
+}
+
 //-----------------------------------------------------------------------------
 // VMM PROCESS FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
@@ -107,6 +107,7 @@ BOOL VmmProcRefresh_MEM()
     VmmCacheClearPartial(VMM_CACHE_TAG_PAGING);
     InterlockedIncrement64(&ctxVmm->stat.cPageRefreshCache);
     ObSet_Clear(ctxVmm->Cache.PAGING_FAILED);
+    VmmCacheFailClear();
     LeaveCriticalSection(&ctxVmm->LockMaster);
     return TRUE;
 }
@@ -118,6 +119,7 @@ BOOL VmmProcRefresh_TLB()
     ctxVmm->tcRefreshTLB++;
     VmmCacheClearPartial(VMM_CACHE_TAG_TLB);
     InterlockedIncrement64(&ctxVmm->stat.cTlbRefreshCache);
+    VmmPhys2VirtIndex_Refresh();
     LeaveCriticalSection(&ctxVmm->LockMaster);
     return TRUE;
 }
@@ -2010,39 +2010,37 @@ VOID VmmWinHandle_CloseObCallback(_In_ PVMMOB_MAP_HANDLE pOb)
 VOID VmmWinHandle_InitializeCore_SpiderTables(_In_ PVMMWIN_INITIALIZE_HANDLE_CONTEXT ctx, _In_ QWORD vaTable, _In_ BOOL fLevel2)
 {
     QWORD i, va = 0;
-    union {
-        BYTE pb[0x1000];
-        DWORD pdw[0x400];
-        QWORD pqw[0x200];
-    } u;
-    if(!VmmRead(ctx->pSystemProcess, vaTable, u.pb, 0x1000)) { return; }
+    PVMMOB_CACHE_MEM pObPage;
+    if(!(pObPage = VmmReadPin(ctx->pSystemProcess, vaTable, 0))) { return; }
     if(ctxVmm->f32) {
         for(i = 0; i < 0x400; i++) {
-            va = u.pdw[i];
-            if(!VMM_KADDR32_PAGE(va)) { return; }
+            va = pObPage->pdw[i];
+            if(!VMM_KADDR32_PAGE(va)) { goto finish; }
             if(fLevel2) {
                 VmmWinHandle_InitializeCore_SpiderTables(ctx, va, FALSE);
-                if(ctx->cTables == ctx->cTablesMax) { return; }
+                if(ctx->cTables == ctx->cTablesMax) { goto finish; }
             } else {
                 ctx->pvaTables[ctx->cTables] = va;
                 ctx->cTables++;
-                if(ctx->cTables == ctx->cTablesMax) { return; }
+                if(ctx->cTables == ctx->cTablesMax) { goto finish; }
             }
         }
     } else {
         for(i = 0; i < 0x200; i++) {
-            va = u.pqw[i];
-            if(!VMM_KADDR64_PAGE(va)) { return; }
+            va = pObPage->pqw[i];
+            if(!VMM_KADDR64_PAGE(va)) { goto finish; }
             if(fLevel2) {
                 VmmWinHandle_InitializeCore_SpiderTables(ctx, va, FALSE);
-                if(ctx->cTables == ctx->cTablesMax) { return; }
+                if(ctx->cTables == ctx->cTablesMax) { goto finish; }
             } else {
                 ctx->pvaTables[ctx->cTables] = va;
                 ctx->cTables++;
-                if(ctx->cTables == ctx->cTablesMax) { return; }
+                if(ctx->cTables == ctx->cTablesMax) { goto finish; }
             }
         }
     }
+finish:
+    Ob_DECREF(pObPage);
 }
 
 /*
@@ -2054,22 +2052,19 @@ DWORD VmmWinHandle_InitializeCore_CountHandles(_In_ PVMMWIN_INITIALIZE_HANDLE_CO
 {
     QWORD va;
     DWORD iTable, i, cHandles = 0;
-    union {
-        BYTE pb[0x1000];
-        DWORD pdw[0x400];
-        QWORD pqw[0x200];
-    } u;
+    PVMMOB_CACHE_MEM pObPage = NULL;
     VmmCachePrefetchPages4(ctx->pSystemProcess, ctx->cTables, ctx->pvaTables, 0x1000, 0);
     for(iTable = 0; iTable < ctx->cTables; iTable++) {
-        if(!VmmRead(ctx->pSystemProcess, ctx->pvaTables[iTable], u.pb, 0x1000)) { continue; }
+        Ob_DECREF_NULL(&pObPage);
+        if(!(pObPage = VmmReadPin(ctx->pSystemProcess, ctx->pvaTables[iTable], 0))) { continue; }
         if(ctxVmm->f32) {
             for(i = 1; i < 512; i++) {
-                if(!VMM_KADDR32(u.pdw[i << 1])) { continue; }
+                if(!VMM_KADDR32(pObPage->pdw[i << 1])) { continue; }
                 cHandles++;
             }
         } else {
             for(i = 1; i < 256; i++) {
-                va = u.pqw[i << 1];
+                va = pObPage->pqw[i << 1];
                 if(ctxVmm->kernel.dwVersionBuild >= 9200) {     // Win8 or later
                     va = 0xffff000000000000 | (va >> 16);
                 }
@@ -2078,6 +2073,7 @@ DWORD VmmWinHandle_InitializeCore_CountHandles(_In_ PVMMWIN_INITIALIZE_HANDLE_CO
             }
         }
     }
+    Ob_DECREF(pObPage);
     return cHandles;
 }
 
@@ -2093,20 +2089,16 @@ VOID VmmWinHandle_InitializeCore_ReadHandleTable(_In_ PVMMWIN_INITIALIZE_HANDLE_
     DWORD i;
     QWORD va;
     PVMM_MAP_HANDLEENTRY pe;
-    union {
-        BYTE pb[0x1000];
-        DWORD pdw[0x400];
-        QWORD pqw[0x200];
-    } u;
-    if(!VmmRead(ctx->pSystemProcess, vaHandleTable, u.pb, 0x1000)) { return; }
+    PVMMOB_CACHE_MEM pObPage;
+    if(!(pObPage = VmmReadPin(ctx->pSystemProcess, vaHandleTable, 0))) { return; }
     if(ctxVmm->f32) {
         for(i = 1; i < 512; i++) {
             if(ctx->iMap == ctx->pHandleMap->cMap) { break; }
-            va = u.pdw[i << 1] & ~3;
+            va = pObPage->pdw[i << 1] & ~3;
             if(!VMM_KADDR32(va)) { continue; }
             pe = ctx->pHandleMap->pMap + ctx->iMap;
             pe->vaObject = (va & ~7) + 0x18ULL;
-            pe->dwGrantedAccess = u.pdw[(i << 1) + 1] & 0x00ffffff;
+            pe->dwGrantedAccess = pObPage->pdw[(i << 1) + 1] & 0x00ffffff;
             pe->dwHandle = dwBaseHandleId + (i << 2);
             pe->dwPID = ctx->pProcess->dwPID;
             ctx->iMap++;
@@ -2114,7 +2106,7 @@ VOID VmmWinHandle_InitializeCore_ReadHandleTable(_In_ PVMMWIN_INITIALIZE_HANDLE_
     } else {
         for(i = 1; i < 256; i++) {
             if(ctx->iMap == ctx->pHandleMap->cMap) { break; }
-            va = u.pqw[i << 1];
+            va = pObPage->pqw[i << 1];
             if(ctxVmm->kernel.dwVersionBuild >= 9600) {         // Win8.1 or later
                 va = 0xffff000000000000 | (va >> 16);
             } else if(ctxVmm->kernel.dwVersionBuild >= 9200) {  // Win8 or later
@@ -2124,12 +2116,13 @@ VOID VmmWinHandle_InitializeCore_ReadHandleTable(_In_ PVMMWIN_INITIALIZE_HANDLE_
             if(!(va & 0x000007ffffffff00)) { continue; }        // free handle
             pe = ctx->pHandleMap->pMap + ctx->iMap;
             pe->vaObject = (va & ~7) + 0x30;
-            pe->dwGrantedAccess = (DWORD)u.pqw[(i << 1) + 1] & 0x00ffffff;
+            pe->dwGrantedAccess = (DWORD)pObPage->pqw[(i << 1) + 1] & 0x00ffffff;
             pe->dwHandle = dwBaseHandleId + (i << 2);
             pe->dwPID = ctx->pProcess->dwPID;
             ctx->iMap++;
         }
     }
+    Ob_DECREF(pObPage);
 }
 
 typedef struct tdVMMWIN_OBJECT_HEADER32 {
@@ -3928,10 +3921,10 @@ VOID VmmWin_ListTraversePrefetch(
     _In_opt_ POB_CONTAINER pPrefetchAddressContainer
 ) {
     QWORD vaData;
-    DWORD cbReadData;
-    PBYTE pbData = NULL;
+    PBYTE pb, pbData = NULL;
     QWORD vaFLink, vaBLink;
     POB_SET pObSet_vaAll = NULL, pObSet_vaTry1 = NULL, pObSet_vaTry2 = NULL, pObSet_vaValid = NULL;
+    PVMMOB_CACHE_MEM pObPin = NULL;
     BOOL fValidEntry, fValidFLink, fValidBLink, fTry1;
     // 1: Prefetch any addresses stored in optional address container
     pObSet_vaAll = ObContainer_GetOb(pPrefetchAddressContainer);
@@ -3951,6 +3944,7 @@ VOID VmmWin_ListTraversePrefetch(
     // 3: Initial list walk
     fTry1 = TRUE;
     while(TRUE) {
+        Ob_DECREF_NULL(&pObPin);
         if(fTry1) {
             vaData = ObSet_Pop(pObSet_vaTry1);
             if(!vaData && (0 == ObSet_Size(pObSet_vaTry2))) { break; }
@@ -3959,8 +3953,7 @@ VOID VmmWin_ListTraversePrefetch(
                 fTry1 = FALSE;
                 continue;
             }
-            VmmReadEx(pProcess, vaData, pbData, cbData, &cbReadData, VMM_FLAG_FORCECACHE_READ);
-            if(cbReadData != cbData) {
+            if(!(pb = VmmReadPinEx(pProcess, vaData, cbData, VMM_FLAG_FORCECACHE_READ, pbData, &pObPin))) {
                 ObSet_Push(pObSet_vaTry2, vaData);
                 continue;
             }
@@ -3968,13 +3961,13 @@ VOID VmmWin_ListTraversePrefetch(
             vaData = ObSet_Pop(pObSet_vaTry2);
             if(!vaData && (0 == ObSet_Size(pObSet_vaTry1))) { break; }
             if(!vaData) { fTry1 = TRUE; continue; }
-            if(!VmmRead(pProcess, vaData, pbData, cbData)) { continue; }
+            if(!(pb = VmmReadPinEx(pProcess, vaData, cbData, 0, pbData, &pObPin))) { continue; }
         }
-        vaFLink = f32 ? *(PDWORD)(pbData + oListStart + 0) : *(PQWORD)(pbData + oListStart + 0);
-        vaBLink = f32 ? *(PDWORD)(pbData + oListStart + 4) : *(PQWORD)(pbData + oListStart + 8);
+        vaFLink = f32 ? *(PDWORD)(pb + oListStart + 0) : *(PQWORD)(pb + oListStart + 0);
+        vaBLink = f32 ? *(PDWORD)(pb + oListStart + 4) : *(PQWORD)(pb + oListStart + 8);
         if(pfnCallback_Pre) {
             fValidEntry = FALSE; fValidFLink = FALSE; fValidBLink = FALSE;
-            pfnCallback_Pre(pProcess, ctx, vaData, pbData, cbData, vaFLink, vaBLink, pObSet_vaAll, &fValidEntry, &fValidFLink, &fValidBLink);
+            pfnCallback_Pre(pProcess, ctx, vaData, pb, cbData, vaFLink, vaBLink, pObSet_vaAll, &fValidEntry, &fValidFLink, &fValidBLink);
         } else {
             if(f32) {
                 fValidFLink = !(vaFLink & 0x03);
@@ -4005,9 +3998,10 @@ VOID VmmWin_ListTraversePrefetch(
     //    processing of the list items.
     if(pfnCallback_Post) {
         while((vaData = ObSet_Pop(pObSet_vaValid))) {
-            if(VmmRead(pProcess, vaData, pbData, cbData)) {
-                pfnCallback_Post(pProcess, ctx, vaData, pbData, cbData);
+            if((pb = VmmReadPinEx(pProcess, vaData, cbData, 0, pbData, &pObPin))) {
+                pfnCallback_Post(pProcess, ctx, vaData, pb, cbData);
             }
+            Ob_DECREF_NULL(&pObPin);
         }
     }
     // 6: Store/Update the optional container with the newly prefetch addresses (if possible and desirable).
@@ -4020,5 +4014,6 @@ fail:
     Ob_DECREF_NULL(&pObSet_vaTry1);
     Ob_DECREF_NULL(&pObSet_vaTry2);
     Ob_DECREF_NULL(&pObSet_vaValid);
+    Ob_DECREF(pObPin);
     LocalFree(pbData);
 }
@@ -86,6 +86,26 @@ PyObject* VmmPyc_MemRead(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args)
     return pyBytes;
 }
 
+// (ULONG64, (ULONG64)) -> PBYTE
+PyObject* VmmPyc_MemReadPin(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args)
+{
+    PyObject *pyBytes;
+    PBYTE pb;
+    HANDLE hPin = NULL;
+    ULONG64 qwA, flags = 0;
+    if(!PyArg_ParseTuple(args, "K|K", &qwA, &flags)) {
+        return PyErr_Format(PyExc_RuntimeError, "%s: Illegal argument.", szFN);
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    pb = VMMDLL_MemReadPin(dwPID, qwA, flags, &hPin);
+    Py_END_ALLOW_THREADS;
+    if(!pb) { return PyErr_Format(PyExc_RuntimeError, "%s: Failed.", szFN); }
+    // copy directly from the pinned cache page into the python object.
+    pyBytes = PyBytes_FromStringAndSize((const char *)pb, 0x1000);
+    VMMDLL_MemReadPinRelease(hPin);
+    return pyBytes;
+}
+
 // (ULONG64, PBYTE) -> None
 PyObject* VmmPyc_MemWrite(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args)
 {
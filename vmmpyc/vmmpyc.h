@@ -271,6 +271,7 @@ PyObj_RegValue* VmmPycRegValue_InitializeInternal(_In_ LPSTR uszFullPathKeyValue
 
 PyObject* VmmPyc_MemReadScatter(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args);
 PyObject* VmmPyc_MemRead(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args);
+PyObject* VmmPyc_MemReadPin(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args);
 PyObject* VmmPyc_MemWrite(_In_ DWORD dwPID, _In_ LPSTR szFN, PyObject *args);
 
 #endif /* __VMMPYC_H__ */
@@ -15,6 +15,14 @@ VmmPycPhysicalMemory_read(PyObj_PhysicalMemory *self, PyObject *args)
     return VmmPyc_MemRead((DWORD)-1, "PhysicalMemory.read()", args);
 }
 
+// (ULONG64, (ULONG64)) -> PBYTE
+static PyObject *
+VmmPycPhysicalMemory_read_pin(PyObj_PhysicalMemory *self, PyObject *args)
+{
+    if(!self->fValid) { return PyErr_Format(PyExc_RuntimeError, "PhysicalMemory.read_pin(): Not initialized."); }
+    return VmmPyc_MemReadPin((DWORD)-1, "PhysicalMemory.read_pin()", args);
+}
+
 // (ULONG64, DWORD, (ULONG64)) -> PBYTE
 static PyObject *
 VmmPycPhysicalMemory_read_scatter(PyObj_PhysicalMemory *self, PyObject *args)
@@ -68,6 +76,7 @@ BOOL VmmPycPhysicalMemory_InitializeType(PyObject * pModule)
 {
     static PyMethodDef PyMethods[] = {
         {"read", (PyCFunction)VmmPycPhysicalMemory_read, METH_VARARGS, "Read contigious physical memory."},
+        {"read_pin", (PyCFunction)VmmPycPhysicalMemory_read_pin, METH_VARARGS, "Read the physical 4kB memory page containing the address from the pinned memory cache page."},
         {"read_scatter", (PyCFunction)VmmPycPhysicalMemory_read_scatter, METH_VARARGS, "Read scatter physical 4kB memory pages."},
         {"write", (PyCFunction)VmmPycPhysicalMemory_write, METH_VARARGS, "Write contigious physical memory."},
         {NULL, NULL, 0, NULL}
@@ -15,6 +15,14 @@ VmmPycVirtualMemory_read(PyObj_VirtualMemory *self, PyObject *args)
     return VmmPyc_MemRead(self->dwPID, "VirtualMemory.read()", args);
 }
 
+// (ULONG64, (ULONG64)) -> PBYTE
+static PyObject*
+VmmPycVirtualMemory_read_pin(PyObj_VirtualMemory *self, PyObject *args)
+{
+    if(!self->fValid) { return PyErr_Format(PyExc_RuntimeError, "VirtualMemory.read_pin(): Not initialized."); }
+    return VmmPyc_MemReadPin(self->dwPID, "VirtualMemory.read_pin()", args);
+}
+
 // (ULONG64, DWORD, (ULONG64)) -> PBYTE
 static PyObject*
 VmmPycVirtualMemory_read_scatter(PyObj_VirtualMemory *self, PyObject *args)
@@ -48,6 +56,49 @@ VmmPycVirtualMemory_virt2phys(PyObj_VirtualMemory *self, PyObject *args)
     return PyLong_FromUnsignedLongLong(pa);
 }
 
+// ([ULONG64]) -> [ULONG64|None]
+static PyObject*
+VmmPycVirtualMemory_virt2phys_batch(PyObj_VirtualMemory *self, PyObject *args)
+{
+    PyObject *pyListSrc, *pyListItemSrc, *pyListDst;
+    DWORD i, cVA;
+    PULONG64 pqwVA = NULL, pqwPA = NULL;
+    PBOOL pfSuccess = NULL;
+    if(!self->fValid) { return PyErr_Format(PyExc_RuntimeError, "VirtualMemory.virt2phys_batch(): Not initialized."); }
+    if(!PyArg_ParseTuple(args, "O!", &PyList_Type, &pyListSrc)) { // borrowed reference
+        return PyErr_Format(PyExc_RuntimeError, "VirtualMemory.virt2phys_batch(): Illegal argument.");
+    }
+    cVA = (DWORD)PyList_Size(pyListSrc);
+    if(cVA == 0) { return PyList_New(0); }
+    if(!(pqwVA = LocalAlloc(0, cVA * (2 * sizeof(ULONG64) + sizeof(BOOL))))) { return PyErr_NoMemory(); }
+    pqwPA = pqwVA + cVA;
+    pfSuccess = (PBOOL)(pqwPA + cVA);
+    for(i = 0; i < cVA; i++) {
+        pyListItemSrc = PyList_GetItem(pyListSrc, i); // borrowed reference
+        if(!pyListItemSrc || !PyLong_Check(pyListItemSrc)) {
+            LocalFree(pqwVA);
+            return PyErr_Format(PyExc_RuntimeError, "VirtualMemory.virt2phys_batch(): Argument list contains non numeric item.");
+        }
+        pqwVA[i] = PyLong_AsUnsignedLongLong(pyListItemSrc);
+    }
+    Py_BEGIN_ALLOW_THREADS;
+    VMMDLL_MemVirt2PhysBatch(self->dwPID, cVA, pqwVA, pqwPA, pfSuccess);
+    Py_END_ALLOW_THREADS;
+    if(!(pyListDst = PyList_New(0))) {
+        LocalFree(pqwVA);
+        return PyErr_NoMemory();
+    }
+    for(i = 0; i < cVA; i++) {
+        if(pfSuccess[i]) {
+            PyList_Append_DECREF(pyListDst, PyLong_FromUnsignedLongLong(pqwPA[i]));
+        } else {
+            PyList_Append(pyListDst, Py_None);
+        }
+    }
+    LocalFree(pqwVA);
+    return pyListDst;
+}
+
 //-----------------------------------------------------------------------------
 // VmmPycVirtualMemory INITIALIZATION AND CORE FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
@@ -88,7 +139,9 @@ BOOL VmmPycVirtualMemory_InitializeType(PyObject *pModule)
 {
     static PyMethodDef PyMethods[] = {
         {"virt2phys", (PyCFunction)VmmPycVirtualMemory_virt2phys, METH_VARARGS, "Translate virtual address to physical address."},
+        {"virt2phys_batch", (PyCFunction)VmmPycVirtualMemory_virt2phys_batch, METH_VARARGS, "Translate a list of virtual addresses to physical addresses (None on fail)."},
         {"read", (PyCFunction)VmmPycVirtualMemory_read, METH_VARARGS, "Read contigious virtual memory."},
+        {"read_pin", (PyCFunction)VmmPycVirtualMemory_read_pin, METH_VARARGS, "Read the virtual 4kB memory page containing the address from the pinned memory cache page."},
         {"read_scatter", (PyCFunction)VmmPycVirtualMemory_read_scatter, METH_VARARGS, "Read scatter virtual 4kB memory pages."},
         {"write", (PyCFunction)VmmPycVirtualMemory_write, METH_VARARGS, "Write contigious virtual memory."},
         {NULL, NULL, 0, NULL}
@@ -302,6 +302,11 @@ namespace vmmsharp
         public static ulong OPT_CONFIG_VMM_VERSION_REVISION =    0x2000000B00000000;  // R
         public static ulong OPT_CONFIG_STATISTICS_FUNCTIONCALL = 0x2000000C00000000; // RW - enable function call statistics (.status/statistics_fncall file)
         public static ulong OPT_CONFIG_IS_PAGING_ENABLED =       0x2000000D00000000;  // RW - 1/0
+        public static ulong OPT_CONFIG_CACHE_MB =                0x2000000E00000000;  // RW - memory cache budget (in MB)
+        public static ulong OPT_CONFIG_CACHE2_MB =               0x2000000F00000000;  // RW - compressed memory cache budget (in MB)
+        public static ulong OPT_CONFIG_CACHE_REVALIDATE =        0x2000001000000000;  // RW - 1/0 - re-validate hot cache pages on refresh (live memory)
+        public static ulong OPT_CONFIG_CACHE_DEDUP =             0x2000001100000000;  // RW - 1/0 - share cached physical pages with identical contents
+        public static ulong OPT_CONFIG_PHYS2VIRT_INDEX =         0x2000001200000000;  // RW - 1/0 - maintain global reverse physical to virtual index
 
         public static ulong OPT_WIN_VERSION_MAJOR =              0x2000010100000000;  // R
         public static ulong OPT_WIN_VERSION_MINOR =              0x2000010200000000;  // R
@@ -456,6 +461,8 @@ namespace vmmsharp
         public static uint FLAG_NOPAGING_IO =               0x0020;  // do not try to retrieve memory from paged out memory if read would incur additional I/O (even if possible).
         public static uint FLAG_NOCACHEPUT =                0x0100;  // do not write back to the data cache upon successful read from memory acquisition device.
         public static uint FLAG_CACHE_RECENT_ONLY =         0x0200;  // only fetch from the most recent active cache region when reading.
+        public static uint FLAG_NO_PREDICTIVE_READ =        0x0400;  // do not perform additional predictive page reads (default on smaller requests).
+        public static uint FLAG_CACHE_STALE_OK =            0x0800;  // allow fetching stale cached data from older (refreshed) cache generations when reading.
 
         public static unsafe MEM_SCATTER[] MemReadScatter(uint pid, uint flags, params ulong[] qwA)
         {
@@ -506,6 +513,16 @@ namespace vmmsharp
             return data;
         }
 
+        // Pin the 4096-byte page containing qwA for zero-copy read-only access.
+        // The returned pointer is valid until hPin is released with MemReadPinRelease.
+        public static IntPtr MemReadPin(uint pid, ulong qwA, out IntPtr hPin, ulong flags = 0)
+        {
+            return vmmi.VMMDLL_MemReadPin(pid, qwA, flags, out hPin);
+        }
+
+        [DllImport("vmm.dll", EntryPoint = "VMMDLL_MemReadPinRelease")]
+        public static extern void MemReadPinRelease(IntPtr hPin);
+
         public static unsafe bool MemPrefetchPages(uint pid, ulong[] qwA)
         {
             byte[] data = new byte[qwA.Length * sizeof(ulong)];
@@ -527,6 +544,27 @@ namespace vmmsharp
         [DllImport("vmm.dll", EntryPoint = "VMMDLL_MemVirt2Phys")]
         public static extern bool MemVirt2Phys(uint dwPID, ulong qwVA, out ulong pqwPA);
 
+        public static unsafe bool MemVirt2PhysBatch(uint dwPID, ulong[] qwVA, out ulong[] qwPA, out bool[] fSuccess)
+        {
+            qwPA = new ulong[qwVA.Length];
+            fSuccess = new bool[qwVA.Length];
+            if (qwVA.Length == 0) { return false; }
+            uint[] f = new uint[qwVA.Length];
+            bool result;
+            fixed (ulong* pqwVA = qwVA, pqwPA = qwPA)
+            {
+                fixed (uint* pf = f)
+                {
+                    result = vmmi.VMMDLL_MemVirt2PhysBatch(dwPID, (uint)qwVA.Length, pqwVA, pqwPA, pf);
+                }
+            }
+            for (int i = 0; i < f.Length; i++)
+            {
+                fSuccess[i] = f[i] != 0;
+            }
+            return result;
+        }
+
 
 
         //---------------------------------------------------------------------
@@ -1911,6 +1949,14 @@ namespace vmmsharp
             uint cpMEMs,
             uint flags);
 
+        [DllImport("vmm.dll", EntryPoint = "VMMDLL_MemVirt2PhysBatch")]
+        internal static extern unsafe bool VMMDLL_MemVirt2PhysBatch(
+            uint dwPID,
+            uint cVA,
+            ulong* pqwVA,
+            ulong* pqwPA,
+            uint* pfSuccess);
+
         [DllImport("vmm.dll", EntryPoint = "VMMDLL_MemReadEx")]
         internal static extern unsafe bool VMMDLL_MemReadEx(
             uint dwPID,
@@ -1920,6 +1966,13 @@ namespace vmmsharp
             out uint pcbReadOpt,
             uint flags);
 
+        [DllImport("vmm.dll", EntryPoint = "VMMDLL_MemReadPin")]
+        internal static extern IntPtr VMMDLL_MemReadPin(
+            uint dwPID,
+            ulong qwA,
+            ulong flags,
+            out IntPtr phPin);
+
         [DllImport("vmm.dll", EntryPoint = "VMMDLL_MemPrefetchPages")]
         internal static extern unsafe bool VMMDLL_MemPrefetchPages(
             uint dwPID,